@@ -0,0 +1,216 @@
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/netstack.h"
+#include "net/rime/rime.h"
+#include "sys/rtimer.h"
+#include "ping-pong-bench.h"
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#define BENCH_CHANNEL 147
+
+#define BENCH_PING 0
+#define BENCH_ECHO 1
+
+/* Latency histogram: < 1 ms, [1, 2) ms, [2, 4) ms, ... , >= 256 ms */
+#define NUM_BINS 10
+/*---------------------------------------------------------------------------*/
+typedef struct bench_msg {
+  uint16_t sequence_number;
+  uint8_t type;         // BENCH_PING or BENCH_ECHO
+  uint8_t size;         // Size of the whole message, padding included
+}
+__attribute__((packed))
+bench_msg_t;
+
+typedef struct latency {
+  uint32_t min_us, max_us, sum_us;
+  uint16_t hist[NUM_BINS];
+} latency_t;
+
+typedef struct bench_stats {
+  uint16_t sent, echoed;
+  latency_t rtt, one_way;
+} bench_stats_t;
+/*---------------------------------------------------------------------------*/
+static const uint8_t sizes[] = { PING_PONG_BENCH_SIZES };
+#define NUM_SIZES (sizeof(sizes) / sizeof(sizes[0]))
+
+static bench_stats_t stats[NUM_SIZES];
+static uint8_t buf[PACKETBUF_SIZE];
+static linkaddr_t peer_addr;
+
+/* Initiator: ping waiting for its echo */
+static uint16_t seqno;
+static uint8_t size_idx;
+static uint8_t waiting;
+static rtimer_clock_t ping_sent;
+/*---------------------------------------------------------------------------*/
+static void recv_bench(struct unicast_conn *c, const linkaddr_t *from);
+static const struct unicast_callbacks bench_callbacks = {
+  .recv     = recv_bench
+};
+static struct unicast_conn bench_uc;
+/*---------------------------------------------------------------------------*/
+PROCESS(bench_process, "Latency Benchmark Process");
+/*---------------------------------------------------------------------------*/
+static uint32_t
+ticks_to_us(rtimer_clock_t ticks)
+{
+  return (uint32_t)((uint64_t)ticks * 1000000 / RTIMER_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+static void
+add_latency(latency_t *l, uint32_t us, uint16_t n)
+{
+  uint8_t bin;
+  uint32_t ms;
+
+  if(n == 0 || us < l->min_us) {
+    l->min_us = us;
+  }
+  if(n == 0 || us > l->max_us) {
+    l->max_us = us;
+  }
+  l->sum_us += us;
+
+  for(bin = 0, ms = us / 1000; ms > 0 && bin < NUM_BINS - 1; bin++) {
+    ms >>= 1;
+  }
+  l->hist[bin]++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+send_msg(uint16_t sn, uint8_t type, uint8_t size)
+{
+  bench_msg_t *m = (bench_msg_t *)buf;
+
+  if(size < sizeof(bench_msg_t)) {
+    size = sizeof(bench_msg_t);
+  }
+  m->sequence_number = sn;
+  m->type = type;
+  m->size = size;
+  packetbuf_copyfrom(buf, size);
+  unicast_send(&bench_uc, &peer_addr);
+}
+/*---------------------------------------------------------------------------*/
+static void
+recv_bench(struct unicast_conn *c, const linkaddr_t *from)
+{
+  rtimer_clock_t now = RTIMER_NOW();
+  bench_msg_t m;
+  bench_stats_t *s;
+  uint32_t rtt_us;
+
+  if(packetbuf_datalen() < sizeof(bench_msg_t)) {
+    return;
+  }
+  memcpy(&m, packetbuf_dataptr(), sizeof(bench_msg_t));
+
+  if(m.type == BENCH_PING) {
+    /* Echo right away */
+    send_msg(m.sequence_number, BENCH_ECHO, m.size);
+    return;
+  }
+
+  /* Late echoes were already counted as lost */
+  if(!waiting || m.sequence_number != seqno) {
+    return;
+  }
+  waiting = 0;
+  s = &stats[size_idx];
+  rtt_us = ticks_to_us((rtimer_clock_t)(now - ping_sent));
+  add_latency(&s->rtt, rtt_us, s->echoed);
+  add_latency(&s->one_way, rtt_us / 2, s->echoed);
+  s->echoed++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_ms(uint32_t us)
+{
+  printf(" %lu.%02lu", (unsigned long)(us / 1000), (unsigned long)(us % 1000 / 10));
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_hist(uint8_t size, const char *name, const latency_t *l)
+{
+  uint8_t i;
+
+  printf("BENCH %3u %-4s", size, name);
+  for(i = 0; i < NUM_BINS; i++) {
+    printf(" %u", l->hist[i]);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+static void
+print_report(void)
+{
+  uint8_t i;
+  bench_stats_t *s;
+
+  printf("BENCH rdc %s, check interval %u ticks, %u pings per size, "
+         "one-way = rtt / 2\n",
+         NETSTACK_RDC.name, NETSTACK_RDC.channel_check_interval(), PING_PONG_BENCH_ROUNDS);
+  printf("BENCH size sent lost  rtt min mean max ms  one-way min mean max ms\n");
+  for(i = 0; i < NUM_SIZES; i++) {
+    s = &stats[i];
+    printf("BENCH %3u %4u %4u ", sizes[i], s->sent, s->sent - s->echoed);
+    if(s->echoed > 0) {
+      print_ms(s->rtt.min_us);
+      print_ms(s->rtt.sum_us / s->echoed);
+      print_ms(s->rtt.max_us);
+      printf(" ");
+      print_ms(s->one_way.min_us);
+      print_ms(s->one_way.sum_us / s->echoed);
+      print_ms(s->one_way.max_us);
+    }
+    printf("\n");
+  }
+  printf("BENCH hist ms    <1 1 2 4 8 16 32 64 128 >=256\n");
+  for(i = 0; i < NUM_SIZES; i++) {
+    print_hist(sizes[i], "rtt", &stats[i].rtt);
+    print_hist(sizes[i], "ow", &stats[i].one_way);
+  }
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(bench_process, ev, data)
+{
+  static struct etimer et;
+  static uint16_t round;
+
+  PROCESS_BEGIN();
+
+  while(1) {
+    memset(stats, 0, sizeof(stats));
+    for(size_idx = 0; size_idx < NUM_SIZES; size_idx++) {
+      for(round = 0; round < PING_PONG_BENCH_ROUNDS; round++) {
+        etimer_set(&et, PING_PONG_BENCH_INTERVAL);
+        seqno++;
+        waiting = 1;
+        stats[size_idx].sent++;
+        ping_sent = RTIMER_NOW();
+        send_msg(seqno, BENCH_PING, sizes[size_idx]);
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
+        waiting = 0;
+      }
+    }
+    print_report();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+void
+ping_pong_bench_start(const linkaddr_t *peer, uint8_t initiator)
+{
+  linkaddr_copy(&peer_addr, peer);
+  unicast_open(&bench_uc, BENCH_CHANNEL, &bench_callbacks);
+  printf("BENCH %s, peer %02X:%02X\n", initiator ? "initiator" : "echo",
+         peer->u8[0], peer->u8[1]);
+  if(initiator) {
+    process_start(&bench_process, NULL);
+  }
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,37 @@
+/*---------------------------------------------------------------------------*/
+#ifndef PING_PONG_BENCH_H_
+#define PING_PONG_BENCH_H_
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "net/linkaddr.h"
+/*---------------------------------------------------------------------------*/
+/* Latency benchmark (APP_PING_PONG_BENCH in project-conf.h).
+ *
+ * The initiator sends PING_PONG_BENCH_ROUNDS pings of each payload size in
+ * PING_PONG_BENCH_SIZES, one every PING_PONG_BENCH_INTERVAL, timestamped with
+ * rtimer right before unicast_send(). The peer echoes each ping from the
+ * receive callback, with the same size: its processing is negligible next to
+ * the MAC latencies. The clocks of the two nodes are not synchronized, so the
+ * one-way latency is estimated as RTT / 2, assuming both directions take as
+ * long. An echo missing at the next ping counts as lost.
+ *
+ * After each pass over the sizes, the initiator prints a compact report
+ * (lines starting with "BENCH"), tagged with the RDC driver it was built with:
+ * rebuild with another NETSTACK_CONF_RDC to compare the drivers.
+ */
+#ifndef PING_PONG_BENCH_SIZES
+#define PING_PONG_BENCH_SIZES 8, 32, 64, 96 // Bytes of application payload
+#endif
+#ifndef PING_PONG_BENCH_ROUNDS
+#define PING_PONG_BENCH_ROUNDS 50 // Pings per payload size and pass
+#endif
+#ifndef PING_PONG_BENCH_INTERVAL
+#define PING_PONG_BENCH_INTERVAL (CLOCK_SECOND / 2) // Above the worst RTT
+#endif
+/*---------------------------------------------------------------------------*/
+/* Open the benchmark connection to peer (on its own Rime channel) and, on the
+ * initiator, start the pings. The peer only echoes. */
+void ping_pong_bench_start(const linkaddr_t *peer, uint8_t initiator);
+/*---------------------------------------------------------------------------*/
+#endif /* PING_PONG_BENCH_H_ */
+/*---------------------------------------------------------------------------*/
@@ -17,5 +17,10 @@
 #define NETSTACK_CONF_RDC nullrdc_driver
 #define NULLRDC_CONF_802154_AUTOACK           0
 /*---------------------------------------------------------------------------*/
+/* 1 to measure the round-trip and one-way latency between nodes 1 and 2 for
+ * several payload sizes instead of the ping-pong (see ping-pong-bench.h).
+ * Change NETSTACK_CONF_RDC above (e.g. contikimac_driver) to compare drivers. */
+#define APP_PING_PONG_BENCH                   0
+/*---------------------------------------------------------------------------*/
 #endif /* PROJECT_CONF_H_ */
 /*---------------------------------------------------------------------------*/
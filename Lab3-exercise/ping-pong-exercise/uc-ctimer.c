@@ -7,6 +7,7 @@
 #include "random.h"
 #include "dev/button-sensor.h"
 #include "dev/leds.h"
+#include "ping-pong-bench.h"
 #include <stdio.h>
 /*---------------------------------------------------------------------------*/
 /* Application Configuration */
@@ -157,7 +158,12 @@ PROCESS_THREAD(unicast_process, ev, data)
   /* TO DO 2:
    * Set the ctimer with callback ct_cb
    */
+#if APP_PING_PONG_BENCH
+  /* Latency benchmark instead of the ping-pong, node 1 sends the pings */
+  ping_pong_bench_start(&receiver, node_id == 1);
+#else
   ctimer_set(&ct, APP_TIMER_DELAY, ct_cb, NULL);
+#endif
 
   while(1) {
     /* Do nothing */
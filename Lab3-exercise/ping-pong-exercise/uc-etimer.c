@@ -7,6 +7,7 @@
 #include "random.h"
 #include "dev/button-sensor.h"
 #include "dev/leds.h"
+#include "ping-pong-bench.h"
 #include <stdio.h>
 /*---------------------------------------------------------------------------*/
 /* Application Configuration */
@@ -147,6 +148,12 @@ PROCESS_THREAD(unicast_process, ev, data)
    * the node turn to increase the ping-pong number and send the message.
    */
 
+#if APP_PING_PONG_BENCH
+  /* Latency benchmark, node 1 sends the pings (leave the etimer unset, so
+   * that the ping-pong does not delay the echoes) */
+  ping_pong_bench_start(&receiver, node_id == 1);
+#endif
+
   while(1) {
     /* Wait for an event */
     PROCESS_WAIT_EVENT();
@@ -6,12 +6,63 @@
 #include "random.h"
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "testbed-ids.h"
 /*---------------------------------------------------------------------------*/
 /* Application Configuration */
 #define BROADCAST_CHANNEL 0xAA
 #define BEACON_INTERVAL   (5 * CLOCK_SECOND)
 #define RANDOM_INTERVAL   (random_rand() % (5 * CLOCK_SECOND))
 /*---------------------------------------------------------------------------*/
+/* Slotted Beacons Configuration
+ * With SLOTTED_BEACONS set, each BEACON_INTERVAL is a round of NUM_SLOTS slots
+ * and every node transmits in the slot given by its testbed ID, instead of at a
+ * random time. Rounds are aligned to the beacons of the node with the lowest ID
+ * (carried in every beacon), so that slots of different nodes do not overlap.
+ * NUM_SLOTS must be larger than the highest testbed ID to be collision-free.
+ */
+#define SLOTTED_BEACONS   0
+#define NUM_SLOTS         160
+#define SLOT_DURATION     (BEACON_INTERVAL / NUM_SLOTS)
+/*---------------------------------------------------------------------------*/
+/* Sweep Configuration
+ * With SWEEP_MODE set, every SWEEP_ROUNDS rounds (an epoch) all nodes move to
+ * the next configuration: the 16 IEEE 802.15.4 channels are cycled for each TX
+ * power in sweep_tx_power. Rounds must be aligned, so SLOTTED_BEACONS is needed.
+ * TX/RX records are tagged with the channel and TX power they were taken with;
+ * with AGGREGATE_STATS, counters are printed and cleared at the end of each epoch.
+ */
+#define SWEEP_MODE          0
+#define SWEEP_ROUNDS        4
+#define SWEEP_FIRST_CHANNEL 11
+#define SWEEP_NUM_CHANNELS  16
+#if SWEEP_MODE
+#if !SLOTTED_BEACONS
+#error "SWEEP_MODE requires SLOTTED_BEACONS"
+#endif
+static const radio_value_t sweep_tx_power[] = {7, 0, -7, -15}; /* dBm */
+#define SWEEP_NUM_POWERS    (sizeof(sweep_tx_power) / sizeof(sweep_tx_power[0]))
+#define TAG_FMT             " CH %u PW %d"
+#define TAG_ARGS            , (unsigned)channel, (int)tx_power
+static radio_value_t channel;
+static radio_value_t tx_power;
+#else
+#define TAG_FMT             ""
+#define TAG_ARGS
+#endif
+/*---------------------------------------------------------------------------*/
+/* Statistics Configuration
+ * With AGGREGATE_STATS set, nodes do not print one line per beacon. They keep
+ * per-neighbour counters in RAM and print them every SUMMARY_INTERVAL instead.
+ * Counters are cumulative since boot, so only the last summary matters; with
+ * SWEEP_MODE they are cleared at each new configuration instead, and the last
+ * summary of each configuration (tagged with it) is the one that matters.
+ */
+#define AGGREGATE_STATS   1
+#define SUMMARY_INTERVAL  (30 * CLOCK_SECOND)
+#define MAX_NEIGHBOURS    48
+/*---------------------------------------------------------------------------*/
 PROCESS(connect_process, "Connectivity Process");
 AUTOSTART_PROCESSES(&connect_process);
 /*---------------------------------------------------------------------------*/
@@ -23,16 +74,112 @@ static const struct broadcast_callbacks bc_callbacks = {
   .sent     = sent_bc,
 };
 /*---------------------------------------------------------------------------*/
+#if AGGREGATE_STATS
+/* Reception statistics of the link from a neighbour to this node */
+struct link_stats {
+  linkaddr_t from;
+  uint16_t rx_count;
+  int32_t rssi_sum;
+  int8_t rssi_min;
+  int8_t rssi_max;
+};
+static struct link_stats links[MAX_NEIGHBOURS];
+static uint8_t num_links;
+static uint16_t tx_count;
+static uint16_t rx_dropped; // Receptions from neighbours that did not fit in the table
+static void print_summary(void);
+static void clear_summary(void);
+#endif
+/*---------------------------------------------------------------------------*/
+/* Per-round statistics, printed at the end of each BEACON_INTERVAL round */
+static uint16_t round_seqn;
+static uint16_t round_tx;
+static uint16_t round_rx;
+/*---------------------------------------------------------------------------*/
+#if SLOTTED_BEACONS
+/* Beacon payload used to align the rounds of all nodes */
+struct beacon_msg {
+  uint16_t round;   // Round in which the beacon was sent
+  uint16_t id;      // Testbed ID of the sender, which gives its slot
+  uint16_t ref_id;  // ID of the node the sender is aligned to
+} __attribute__((packed));
+
+static uint16_t my_id;
+static uint16_t ref_id;            // Lowest ID heard of, directly or through neighbours
+static linkaddr_t sync_parent;     // Neighbour we take the round alignment from
+static process_event_t sync_event; // Posted by recv_bc when the round must be realigned
+static struct beacon_msg sync_beacon;
+static clock_time_t sync_time;
+
+/* Testbed ID of this node, or a made-up one above the testbed range */
+static uint16_t
+lookup_id(void)
+{
+  uint8_t i;
+
+  for(i = 0; i < NUM_TESTBED_IDS; i++) {
+    if(linkaddr_cmp(&testbed_ids[i].addr, &linkaddr_node_addr)) {
+      return testbed_ids[i].id;
+    }
+  }
+  return NUM_SLOTS + ((linkaddr_node_addr.u8[0] << 8 | linkaddr_node_addr.u8[1]) % NUM_SLOTS);
+}
+#endif
+/*---------------------------------------------------------------------------*/
+#if SWEEP_MODE
+/* Switch to the configuration of the epoch the given round belongs to */
+static void
+sweep_update(uint16_t round)
+{
+  uint16_t config = (round / SWEEP_ROUNDS) % (SWEEP_NUM_CHANNELS * SWEEP_NUM_POWERS);
+  radio_value_t new_channel = SWEEP_FIRST_CHANNEL + config % SWEEP_NUM_CHANNELS;
+  radio_value_t new_tx_power = sweep_tx_power[config / SWEEP_NUM_CHANNELS];
+
+  if(new_channel == channel && new_tx_power == tx_power) {
+    return;
+  }
+
+#if AGGREGATE_STATS
+  /* Report what was measured with the previous configuration */
+  if(channel != 0) {
+    print_summary();
+    clear_summary();
+  }
+#endif
+
+  channel = new_channel;
+  tx_power = new_tx_power;
+  NETSTACK_RADIO.set_value(RADIO_PARAM_CHANNEL, channel);
+  NETSTACK_RADIO.set_value(RADIO_PARAM_TXPOWER, tx_power);
+  printf("SWEEP round %u" TAG_FMT "\n", round TAG_ARGS);
+}
+#endif
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(connect_process, ev, data)
 {
   static struct etimer et_interval;
   static struct etimer et_random;
+#if AGGREGATE_STATS && !SWEEP_MODE
+  static struct etimer et_summary;
+#endif
+#if SLOTTED_BEACONS
+  static clock_time_t round_start;
+  static struct beacon_msg beacon;
+  clock_time_t now;
+#endif
 
   PROCESS_BEGIN();
   
   printf("Node Link Layer Address: %X:%X\n",
     linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
 
+#if SLOTTED_BEACONS
+  my_id = lookup_id();
+  ref_id = my_id;
+  sync_event = process_alloc_event();
+  printf("Node ID %u, slot %u of %u\n", my_id, my_id % NUM_SLOTS, NUM_SLOTS);
+#endif
+
   broadcast_open(&bc_conn, BROADCAST_CHANNEL, &bc_callbacks);
 
   /* Wait for other nodes to start */
@@ -41,14 +188,76 @@ PROCESS_THREAD(connect_process, ev, data)
 
   /* Send broadcast beacons to assess connectivity */
   etimer_set(&et_interval, BEACON_INTERVAL);
+#if SLOTTED_BEACONS
+  round_start = clock_time();
+#endif
+#if SWEEP_MODE
+  sweep_update(round_seqn);
+#endif
+#if AGGREGATE_STATS && !SWEEP_MODE
+  etimer_set(&et_summary, SUMMARY_INTERVAL);
+#endif
   while(1) {
+#if SLOTTED_BEACONS
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER || ev == sync_event);
+
+    /* A beacon from a node with a lower reference ID was received:
+     * move the current round so that it started when that node's round did */
+    if(ev == sync_event) {
+      now = clock_time();
+      round_seqn = sync_beacon.round;
+      round_start = sync_time - (sync_beacon.id % NUM_SLOTS) * SLOT_DURATION;
+      etimer_set(&et_interval, round_start + BEACON_INTERVAL - now);
+      if(round_start + (my_id % NUM_SLOTS) * SLOT_DURATION > now) {
+        etimer_set(&et_random, round_start + (my_id % NUM_SLOTS) * SLOT_DURATION - now);
+      }
+      else {
+        /* Our slot of the realigned round is over: drop the beacon pending
+         * at the old alignment, the next round schedules it again */
+        etimer_stop(&et_random);
+      }
+#if SWEEP_MODE
+      sweep_update(round_seqn);
+#endif
+      continue;
+    }
+#else
     PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
-    if(etimer_expired(&et_interval)) {
+#endif
+#if AGGREGATE_STATS && !SWEEP_MODE
+    /* Check the summary timer by identity: et_random stays expired after firing */
+    if(data == &et_summary) {
+      print_summary();
+      etimer_reset(&et_summary);
+      continue;
+    }
+#endif
+    if(data == &et_interval) {
+      printf("ROUND %u TX %u RX %u\n", round_seqn, round_tx, round_rx);
+      round_seqn++;
+      round_tx = 0;
+      round_rx = 0;
+#if SWEEP_MODE
+      sweep_update(round_seqn);
+#endif
+#if SLOTTED_BEACONS
+      round_start += BEACON_INTERVAL;
+      etimer_set(&et_random, (my_id % NUM_SLOTS) * SLOT_DURATION);
+#else
       etimer_set(&et_random, RANDOM_INTERVAL);
-      etimer_reset(&et_interval);
+#endif
+      /* The interval may have been shortened to realign the round: restart it
+       * from its expiration time with the nominal length */
+      etimer_reset_with_new_interval(&et_interval, BEACON_INTERVAL);
     }
-    else if(etimer_expired(&et_random)) {
+    else if(data == &et_random) {
       packetbuf_clear();
+#if SLOTTED_BEACONS
+      beacon.round = round_seqn;
+      beacon.id = my_id;
+      beacon.ref_id = ref_id;
+      packetbuf_copyfrom(&beacon, sizeof(beacon));
+#endif
       broadcast_send(&bc_conn); /* Since we  rely on the identified sender broadcast primitive,
                                  * RIME will add the sender address as an attribute to our payload.
                                  */
@@ -57,23 +266,118 @@ PROCESS_THREAD(connect_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if AGGREGATE_STATS
+static void
+print_summary(void)
+{
+  uint8_t i;
+
+  printf("STAT TX %02x:%02x %u" TAG_FMT "\n",
+    linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1], tx_count TAG_ARGS);
+
+  for(i = 0; i < num_links; i++) {
+    printf("STAT RX %02x:%02x->%02x:%02x %u %ld %d %d" TAG_FMT "\n",
+      links[i].from.u8[0], links[i].from.u8[1],
+      linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+      links[i].rx_count, (long)links[i].rssi_sum,
+      links[i].rssi_min, links[i].rssi_max TAG_ARGS);
+  }
+
+  if(rx_dropped > 0) {
+    printf("STAT DROP %u" TAG_FMT "\n", rx_dropped TAG_ARGS);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+clear_summary(void)
+{
+  num_links = 0;
+  tx_count = 0;
+  rx_dropped = 0;
+}
+/*---------------------------------------------------------------------------*/
+static struct link_stats *
+find_link(const linkaddr_t *from)
+{
+  uint8_t i;
+
+  for(i = 0; i < num_links; i++) {
+    if(linkaddr_cmp(&links[i].from, from)) {
+      return &links[i];
+    }
+  }
+
+  /* New neighbour: add it to the table, if there is room */
+  if(num_links == MAX_NEIGHBOURS) {
+    return NULL;
+  }
+  linkaddr_copy(&links[num_links].from, from);
+  links[num_links].rx_count = 0;
+  links[num_links].rssi_sum = 0;
+  links[num_links].rssi_min = INT8_MAX;
+  links[num_links].rssi_max = INT8_MIN;
+  return &links[num_links++];
+}
+#endif
+/*---------------------------------------------------------------------------*/
 static void
 recv_bc(struct broadcast_conn *c, const linkaddr_t *from)
 {
   radio_value_t rssi;
 
   NETSTACK_RADIO.get_value(RADIO_PARAM_LAST_RSSI, &rssi);
+  round_rx++;
+
+#if SLOTTED_BEACONS
+  struct beacon_msg beacon;
+  if(packetbuf_datalen() == sizeof(beacon)) {
+    memcpy(&beacon, packetbuf_dataptr(), sizeof(beacon));
+
+    /* Align to neighbours that know of a lower ID, and keep following our
+     * sync parent to compensate for clock drift */
+    if(beacon.ref_id < ref_id ||
+       (beacon.ref_id == ref_id && ref_id != my_id && linkaddr_cmp(from, &sync_parent))) {
+      ref_id = beacon.ref_id;
+      linkaddr_copy(&sync_parent, from);
+      sync_beacon = beacon;
+      sync_time = clock_time();
+      process_post(&connect_process, sync_event, NULL);
+    }
+  }
+#endif
 
-  printf("RX %02x:%02x->%02x:%02x, RSSI = %ddBm\n",
+#if AGGREGATE_STATS
+  struct link_stats *l = find_link(from);
+  if(l == NULL) {
+    rx_dropped++;
+    return;
+  }
+  l->rx_count++;
+  l->rssi_sum += rssi;
+  if(rssi < l->rssi_min) {
+    l->rssi_min = rssi;
+  }
+  if(rssi > l->rssi_max) {
+    l->rssi_max = rssi;
+  }
+#else
+  printf("RX %02x:%02x->%02x:%02x, RSSI = %ddBm" TAG_FMT "\n",
     from->u8[0], from->u8[1],
     linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
-    rssi);
+    rssi TAG_ARGS);
+#endif
 }
 /*---------------------------------------------------------------------------*/
 static void
 sent_bc(struct broadcast_conn *c, int status, int num_tx)
 {
-  printf("TX %02x:%02x\n",
-    linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1]);
+  round_tx++;
+
+#if AGGREGATE_STATS
+  tx_count++;
+#else
+  printf("TX %02x:%02x" TAG_FMT "\n",
+    linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1] TAG_ARGS);
+#endif
 }
 /*---------------------------------------------------------------------------*/
@@ -2,92 +2,235 @@ import os
 import sys
 import re
 
+# Optional configuration tag appended to TX/RX records by SWEEP_MODE nodes
+TAG = r"(?:,? CH (?P<ch>\d+) PW (?P<pw>-?\d+))?"
+
+def get_config(m):
+    # Configuration (channel, TX power) of a record, None if the record is not tagged
+    if m.group('ch') is None:
+        return None
+    return (int(m.group('ch')), int(m.group('pw')))
+
+def count_tx(tx, addr, count):
+    tx[addr] = tx.get(addr, 0) + count
+
+def count_rx(rx, addr_from, addr_to, count, total, low, high):
+    # Per-link counters: [# received, RSSI sum, min RSSI, max RSSI]
+    link = rx.setdefault(addr_from, dict()).get(addr_to)
+    if link is None:
+        rx[addr_from][addr_to] = [count, total, low, high]
+    else:
+        link[0] += count
+        link[1] += total
+        link[2] = min(link[2], low)
+        link[3] = max(link[3], high)
+
 def parse_process_file(log_file):
     idsmap = dict()
+    unknown = dict()
+
+    # Counters per configuration: tx[config][addr], rx[config][addr_from][addr_to]
     tx = dict()
     rx = dict()
-    rssi = dict()
-
-    # Regular expressions to parse the file
-    regex_id = re.compile(r".* (?P<node_id>\d+).firefly < b'Rime configured with address (?P<addr>\w\w:\w\w).*\n")
-    regex_tx = re.compile(r".*TX (?P<addr>\w\w:\w\w).*\n")
-    regex_rx = re.compile(r".*RX (?P<addr_from>\w\w:\w\w)->(?P<addr_to>\w\w:\w\w), RSSI = (?P<rssi>-?\d+)dBm.*\n")
 
-    # Open the log file and read it line by line to match Rime short addresses to testbed IDs
-    with open(log_file, 'r') as f:
+    # Cumulative on-node counters (untagged STAT records), only the latest value of each counts.
+    # Tagged STAT records are printed once per sweep epoch and are summed instead.
+    stat_tx = dict()
+    stat_rx = dict()
+    stat_drop = dict()
+
+    # Per-round counters, rounds[round][node_id] = (tx, rx)
+    rounds = dict()
+
+    # Regular expressions to parse the file.
+    # They are anchored on the node output (the part after "< b'") and only tried
+    # on lines that passed a cheap substring check, so the log is read only once.
+    regex_id = re.compile(r" (?P<node_id>\d+)\.firefly < b'Rime configured with address (?P<addr>\w\w:\w\w)")
+    regex_tx = re.compile(r"TX (?P<addr>\w\w:\w\w)" + TAG)
+    regex_rx = re.compile(r"RX (?P<addr_from>\w\w:\w\w)->(?P<addr_to>\w\w:\w\w), RSSI = (?P<rssi>-?\d+)dBm" + TAG)
+    regex_stat_tx = re.compile(r"STAT TX (?P<addr>\w\w:\w\w) (?P<count>\d+)" + TAG)
+    regex_stat_rx = re.compile(r"STAT RX (?P<addr_from>\w\w:\w\w)->(?P<addr_to>\w\w:\w\w) "
+                               r"(?P<count>\d+) (?P<sum>-?\d+) (?P<min>-?\d+) (?P<max>-?\d+)" + TAG)
+    regex_stat_drop = re.compile(r" (?P<node_id>\d+)\.firefly < b'STAT DROP (?P<count>\d+)" + TAG)
+    regex_round = re.compile(r" (?P<node_id>\d+)\.firefly < b'ROUND (?P<round>\d+) TX (?P<tx>\d+) RX (?P<rx>\d+)")
+
+    # Open the log file and read it line by line.
+    # TX/RX counters are kept per Rime address and mapped to testbed IDs at the end,
+    # so the address mapping lines can appear anywhere in the log.
+    with open(log_file, 'r', buffering=1 << 20) as f:
         for line in f:
 
-            # Match Rime short addresses strings and map them to testbed IDs
-            m = regex_id.match(line)
-            if m:
-
-                # Get dictionary of matched groups (map the group names to their captured values)
-                d = m.groupdict()
-
-                # Add to the dictionary
-                idsmap[d['addr']] = d['node_id']
-
-    # Open the log file and read line by line to count TX and RX
-    with open(log_file, 'r') as f:
-        for line in f:
+            # Match per-round statistics
+            if "ROUND " in line:
+                m = regex_round.search(line)
+                if m:
+                    rounds.setdefault(int(m.group('round')), dict())[m.group('node_id')] = (
+                        int(m.group('tx')), int(m.group('rx')))
+                    continue
+
+            # Match aggregated statistics printed by the nodes (AGGREGATE_STATS)
+            pos = line.find("STAT ")
+            if pos >= 0:
+                m = regex_stat_rx.match(line, pos)
+                if m:
+                    config = get_config(m)
+                    values = tuple(map(int, m.group('count', 'sum', 'min', 'max')))
+                    if config is None:
+                        stat_rx[m.group('addr_from', 'addr_to')] = values
+                    else:
+                        count_rx(rx.setdefault(config, dict()), m.group('addr_from'), m.group('addr_to'), *values)
+                    continue
+                m = regex_stat_tx.match(line, pos)
+                if m:
+                    config = get_config(m)
+                    if config is None:
+                        stat_tx[m.group('addr')] = int(m.group('count'))
+                    else:
+                        count_tx(tx.setdefault(config, dict()), m.group('addr'), int(m.group('count')))
+                    continue
+                m = regex_stat_drop.search(line)
+                if m:
+                    key = (m.group('node_id'), get_config(m))
+                    if key[1] is None:
+                        stat_drop[key] = int(m.group('count'))
+                    else:
+                        stat_drop[key] = stat_drop.get(key, 0) + int(m.group('count'))
+                    continue
+
+            # Match reception strings (by far the most frequent record)
+            pos = line.find("RX ")
+            if pos >= 0:
+                m = regex_rx.match(line, pos)
+                if m:
+                    # Increase the count of receptions and collect RSSI for the given link
+                    value = int(m.group('rssi'))
+                    count_rx(rx.setdefault(get_config(m), dict()),
+                             m.group('addr_from'), m.group('addr_to'), 1, value, value, value)
+                    continue # If there is a match, go to the next line
 
             # Match transmissions strings
-            m = regex_tx.match(line)
-            if m:
-
-                # Get dictionary of matched groups
-                d = m.groupdict()
-
-                # Increase the count of transmissions from this address
-                try:
-                    tx_id = idsmap[d['addr']]
-                    tx[tx_id] = tx.get(tx_id, 0) + 1
-                except KeyError:
-                    print(f"ID not found for address {d['addr']}")
-
-                continue # If there is a match, go to the next line
-
-            # Match reception strings
-            m = regex_rx.match(line)
-            if m:
-
-                # Get dictionary of matched groups
-                d = m.groupdict()
-
-                # Increase the count of receptions for the given link
-                key_found = True
-                try:
-                    from_id = idsmap[d['addr_from']]
-                except KeyError:
-                    print(f"ID not found for address {d['addr_from']}")
-                    key_found = False
-                try:
-                    to_id = idsmap[d['addr_to']]
-                except KeyError:
-                    print(f"ID not found for address {d['addr_to']}")
-                    key_found = False
-                
-                if key_found:
-                    rx_update = rx.get(from_id, dict())
-                    rx_update[to_id] = rx_update.get(to_id, 0) + 1
-                    rx[from_id] = rx_update
-
-                    # Collect RSSI measurements for the given link
-                    rssi_update = rssi.get(from_id, dict())
-                    rssi_update[to_id] = rssi_update.get(to_id, 0) + int(d['rssi'])
-                    rssi[from_id] = rssi_update
-
-                continue
-    
+            pos = line.find("TX ")
+            if pos >= 0:
+                m = regex_tx.match(line, pos)
+                if m:
+                    count_tx(tx.setdefault(get_config(m), dict()), m.group('addr'), 1)
+                    continue
+
+            # Match Rime short addresses strings and map them to testbed IDs
+            if "Rime configured" in line:
+                m = regex_id.search(line)
+                if m:
+                    idsmap[m.group('addr')] = m.group('node_id')
+
+    # Merge the latest on-node counters with the per-packet ones
+    for addr, count in stat_tx.items():
+        count_tx(tx.setdefault(None, dict()), addr, count)
+    for (addr_from, addr_to), values in stat_rx.items():
+        count_rx(rx.setdefault(None, dict()), addr_from, addr_to, *values)
+
+    # Map Rime addresses to testbed IDs
+    def to_id(addr):
+        try:
+            return idsmap[addr]
+        except KeyError:
+            unknown[addr] = unknown.get(addr, 0) + 1
+            return None
+
+    results = dict()
+    for config in sorted(tx.keys() | rx.keys(), key=lambda c: (c is not None, c)):
+        tx_by_id = dict()
+        for addr, count in tx.get(config, dict()).items():
+            tx_id = to_id(addr)
+            if tx_id is not None:
+                tx_by_id[tx_id] = tx_by_id.get(tx_id, 0) + count
+
+        rx_by_id = dict()
+        for addr_from, links in rx.get(config, dict()).items():
+            from_id = to_id(addr_from)
+            for addr_to, values in links.items():
+                to_id_ = to_id(addr_to)
+                if from_id is None or to_id_ is None:
+                    continue
+                count_rx(rx_by_id, from_id, to_id_, *values)
+
+        results[config] = (tx_by_id, rx_by_id)
+
+    for addr in unknown:
+        print(f"ID not found for address {addr}")
+    for (node_id, config), count in stat_drop.items():
+        setting = f" on channel {config[0]}, TX power {config[1]}dBm" if config is not None else ""
+        print(f"Node {node_id}: neighbour table full, {count} receptions not counted{setting}")
+
+    return results, rounds
+
+
+def print_rounds(rx, rounds):
+    # In each round, every beacon is expected to reach all the nodes that received
+    # at least one beacon from the same sender during the whole experiment.
+    # The ratio of actual to expected receptions can be compared between runs
+    # with and without SLOTTED_BEACONS.
+    degree = {tx_id: len(rx[tx_id]) for tx_id in rx}
+    prrs = []
+    print("Per-round statistics")
+    for r in sorted(rounds):
+        tx_round = sum(c[0] for c in rounds[r].values())
+        rx_round = sum(c[1] for c in rounds[r].values())
+        expected = sum(c[0] * degree.get(node_id, 0) for node_id, c in rounds[r].items())
+        prr = rx_round / expected * 100 if expected else 0
+        if expected:
+            prrs.append(prr)
+        print(f"ROUND: {r:<5}\tNODES: {len(rounds[r])}\t# PKT SENT: {tx_round}\t# PKT RCVD: {rx_round}\tPRR: {round(prr,2)}%")
+    if prrs:
+        print(f"Average PRR over {len(prrs)} rounds: {round(sum(prrs)/len(prrs),2)}%")
+    print("\n")
+
+
+def print_results(tx, rx):
     # Diplay results
     for tx_id in tx:
         print(f"FROM: {tx_id:<5}\t\t# PKT SENT: {tx[tx_id]}")
-        for rx_id in rx[tx_id]:
-            print(f"\tTO: {rx_id:<5}\t# PKT RCVD: {rx[tx_id][rx_id]}\tPRR: {round(rx[tx_id][rx_id]/tx[tx_id]*100,2)}%\tAverage RSSI: {round(rssi[tx_id][rx_id]/rx[tx_id][rx_id],2)}dBm")
+        for rx_id, (count, total, low, high) in rx.get(tx_id, dict()).items():
+            print(f"\tTO: {rx_id:<5}\t# PKT RCVD: {count}\tPRR: {round(count/tx[tx_id]*100,2)}%\tAverage RSSI: {round(total/count,2)}dBm\tMin/Max RSSI: {low}/{high}dBm")
             # a thing that you can notice is that higher PRR means lower RSSI, same thing vice versa.
         print("\n")
 
 
+def write_matrices(log_file, config, tx, rx):
+    # Write the PRR and average RSSI of every link as a FROM x TO matrix (CSV)
+    ids = sorted(set(tx) | set(rx) | {rx_id for links in rx.values() for rx_id in links}, key=int)
+    fname_common = os.path.splitext(log_file)[0] + f"-ch{config[0]}-pw{config[1]}"
+    with open(f"{fname_common}-prr.csv", 'w') as fprr, open(f"{fname_common}-rssi.csv", 'w') as frssi:
+        fprr.write("from/to," + ",".join(ids) + "\n")
+        frssi.write("from/to," + ",".join(ids) + "\n")
+        for tx_id in ids:
+            links = rx.get(tx_id, dict())
+            prr_row = []
+            rssi_row = []
+            for rx_id in ids:
+                link = links.get(rx_id)
+                if link is None or not tx.get(tx_id):
+                    prr_row.append("0" if tx.get(tx_id) else "")
+                    rssi_row.append("")
+                else:
+                    prr_row.append(f"{link[0]/tx[tx_id]*100:.2f}")
+                    rssi_row.append(f"{link[1]/link[0]:.2f}")
+            fprr.write(f"{tx_id}," + ",".join(prr_row) + "\n")
+            frssi.write(f"{tx_id}," + ",".join(rssi_row) + "\n")
+
+
+def print_configs(log_file, results):
+    # One line per sweep configuration, plus its link matrices as CSV files
+    print("Sweep summary")
+    for config, (tx, rx) in results.items():
+        if config is None:
+            continue
+        prrs = [c[0] / tx[tx_id] * 100 for tx_id in rx if tx.get(tx_id) for c in rx[tx_id].values()]
+        avg_prr = round(sum(prrs) / len(prrs), 2) if prrs else 0
+        print(f"CHANNEL: {config[0]:<3}\tTX POWER: {config[1]:>3}dBm\t# LINKS: {len(prrs)}\tAverage PRR: {avg_prr}%")
+        write_matrices(log_file, config, tx, rx)
+    print("\n")
+
+
 if __name__ == '__main__':
     # Check that the file to be parsed and processed is specified (e.g., python3 connectivity.py job.log)
     if len(sys.argv) < 2:
@@ -101,4 +244,12 @@ if __name__ == '__main__':
         sys.exit(1)
 
     # Parse and process the log file
-    parse_process_file(log_file)
+    results, rounds = parse_process_file(log_file)
+    for config, (tx, rx) in results.items():
+        if config is not None:
+            print(f"########## CHANNEL {config[0]}, TX POWER {config[1]}dBm ##########\n")
+        print_results(tx, rx)
+    if any(config is not None for config in results):
+        print_configs(log_file, results)
+    if rounds and None in results:
+        print_rounds(results[None][1], rounds)
@@ -0,0 +1,43 @@
+/*---------------------------------------------------------------------------*/
+#ifndef TESTBED_IDS_H_
+#define TESTBED_IDS_H_
+/*---------------------------------------------------------------------------*/
+#include "core/net/linkaddr.h"
+/*---------------------------------------------------------------------------*/
+/* Rime address of each Zolertia Firefly in the DEPT island and its testbed ID,
+ * as reported by the "Rime configured with address" line of a testbed job.
+ */
+struct testbed_id {
+  linkaddr_t addr;
+  uint16_t id;
+};
+/*---------------------------------------------------------------------------*/
+static const struct testbed_id testbed_ids[] = {
+  {{{0xf7, 0x9c}},   1}, {{{0xd9, 0x76}},   2}, {{{0xf3, 0x84}},   3}, {{{0xf3, 0xee}},   4},
+  {{{0xd8, 0xf1}},   5}, {{{0xf3, 0x9a}},   6}, {{{0xde, 0x21}},   7}, {{{0xf2, 0xa1}},   8},
+  {{{0xd8, 0xb5}},   9}, {{{0xf2, 0x1e}},  10}, {{{0xd9, 0x5f}},  11}, {{{0xf2, 0x33}},  12},
+  {{{0xde, 0x0c}},  13}, {{{0xf2, 0x0e}},  14}, {{{0xd9, 0x49}},  15}, {{{0xf3, 0xdc}},  16},
+  {{{0xd9, 0x23}},  17}, {{{0xf3, 0x8b}},  18}, {{{0xf3, 0xc2}},  19}, {{{0xf3, 0xb7}},  20},
+  {{{0xde, 0xe4}},  21}, {{{0xf3, 0x88}},  22}, {{{0xf7, 0x9a}},  23}, {{{0xf7, 0xe7}},  24},
+  {{{0xf2, 0x85}},  25}, {{{0xf2, 0x27}},  26}, {{{0xf2, 0x64}},  27}, {{{0xf3, 0xd3}},  28},
+  {{{0xf3, 0x8d}},  29}, {{{0xf7, 0xe1}},  30}, {{{0xde, 0xaf}},  31}, {{{0xf2, 0x91}},  32},
+  {{{0xf2, 0xd7}},  33}, {{{0xf3, 0xa3}},  34}, {{{0xf2, 0xd9}},  35}, {{{0xd9, 0x9f}},  36},
+  {{{0x15, 0xdb}}, 100}, {{{0x15, 0x3d}}, 101}, {{{0x16, 0x5b}}, 102}, {{{0x14, 0xc3}}, 103},
+  {{{0x15, 0x8c}}, 104}, {{{0x15, 0xf3}}, 105}, {{{0x15, 0x13}}, 106}, {{{0x14, 0x97}}, 107},
+  {{{0x15, 0xb4}}, 108}, {{{0x14, 0xde}}, 109}, {{{0x16, 0x36}}, 110}, {{{0x14, 0xf2}}, 111},
+  {{{0x15, 0x5a}}, 113}, {{{0x16, 0x16}}, 114}, {{{0x15, 0xd4}}, 115}, {{{0x15, 0xda}}, 116},
+  {{{0x14, 0xda}}, 117}, {{{0x14, 0xea}}, 118}, {{{0x14, 0x9b}}, 119}, {{{0x14, 0xe6}}, 121},
+  {{{0x16, 0x31}}, 122}, {{{0x14, 0xc9}}, 123}, {{{0x14, 0x99}}, 124}, {{{0x15, 0xbc}}, 125},
+  {{{0x15, 0x7b}}, 126}, {{{0x16, 0xfe}}, 127}, {{{0x15, 0xf2}}, 128}, {{{0x14, 0xe8}}, 129},
+  {{{0x14, 0xa8}}, 130}, {{{0x15, 0x87}}, 131}, {{{0x15, 0xb0}}, 132}, {{{0x15, 0x20}}, 133},
+  {{{0x15, 0x92}}, 134}, {{{0x14, 0xce}}, 135}, {{{0x15, 0x3e}}, 136}, {{{0x15, 0x4c}}, 137},
+  {{{0x16, 0x71}}, 138}, {{{0xf2, 0xeb}}, 139}, {{{0xf2, 0xe1}}, 140}, {{{0xf7, 0xc3}}, 141},
+  {{{0xf3, 0xaf}}, 142}, {{{0xf7, 0xaf}}, 143}, {{{0xf3, 0xf0}}, 144}, {{{0x16, 0x5f}}, 145},
+  {{{0x15, 0xea}}, 146}, {{{0x16, 0x33}}, 147}, {{{0x16, 0x2d}}, 148}, {{{0x15, 0xc4}}, 149},
+  {{{0x15, 0x4f}}, 150}, {{{0x16, 0x28}}, 151}, {{{0x16, 0x99}}, 152}, {{{0x15, 0x95}}, 153},
+  {{{0x16, 0x5c}}, 154},
+};
+#define NUM_TESTBED_IDS (sizeof(testbed_ids) / sizeof(testbed_ids[0]))
+/*---------------------------------------------------------------------------*/
+#endif /* TESTBED_IDS_H_ */
+/*---------------------------------------------------------------------------*/
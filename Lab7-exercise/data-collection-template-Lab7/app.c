@@ -7,7 +7,9 @@
 #include "core/net/linkaddr.h"
 #include "my_collect.h"
 /*---------------------------------------------------------------------------*/
+#ifndef MSG_PERIOD /* Can be overridden in project-conf.h (see sweep.py) */
 #define MSG_PERIOD (30 * CLOCK_SECOND) /* [Lab 7] Non-sink nodes send data packets every ~30 seconds */
+#endif
 #define COLLECT_CHANNEL 0xAA
 #define DATA_FORWARDING 1              /* [Lab 7] Set it to 1 to enable data forwarding!!! */ 
 /*---------------------------------------------------------------------------*/
@@ -40,6 +42,11 @@ PROCESS_THREAD(app_process, ev, data)
 
   PROCESS_BEGIN();
 
+#ifdef APP_CONF_TX_POWER
+  /* TX power in dBm, set by the simulation sweep (see sweep.py) */
+  NETSTACK_RADIO.set_value(RADIO_PARAM_TXPOWER, APP_CONF_TX_POWER);
+#endif
+
   if (linkaddr_cmp(&sink, &linkaddr_node_addr)) {
     /* Sink node: open my_collect connection specifying 
      * that the node is the sink and do nothing,
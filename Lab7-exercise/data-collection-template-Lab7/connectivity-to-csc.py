@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+import os
+import sys
+import math
+import argparse
+import importlib.util
+
+from cooja_csc import DEFAULT_TEMPLATE, dgrm_xml, write_csc
+
+# The connectivity log is parsed by the Lab 5 script, so that every format it
+# understands (per-packet, STAT summaries, sweep configurations) is supported
+CONNECTIVITY_PY = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..",
+                               "Lab5 - The CLOVES testbed", "connectivity-template", "connectivity.py")
+
+sink_id = 1
+SPACING = 10.0 # Distance between motes in the (purely visual) grid layout, in m
+
+
+def load_connectivity():
+    spec = importlib.util.spec_from_file_location("connectivity", CONNECTIVITY_PY)
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def build_csc(log_file, out_file, config=None, min_prr=0.0, template=DEFAULT_TEMPLATE, seed=None):
+    results, _ = load_connectivity().parse_process_file(log_file)
+    if config not in results:
+        print("No connectivity data for configuration {}. Available: {}".format(
+            config, ", ".join(str(c) for c in results)))
+        sys.exit(1)
+    tx, rx = results[config]
+
+    # Testbed IDs become mote IDs, so that node 1 is still the sink (Rime address 01:00)
+    ids = sorted({int(i) for i in tx} | {int(i) for i in rx} |
+                 {int(i) for links in rx.values() for i in links})
+    if sink_id not in ids:
+        print(f"Warning: sink {sink_id} is not part of the measured topology.")
+
+    # One directed edge per measured link, with its PRR and average RSSI
+    edges = []
+    for tx_id in rx:
+        if not tx.get(tx_id):
+            continue
+        for rx_id, (count, total, low, high) in rx[tx_id].items():
+            prr = min(count / tx[tx_id], 1.0)
+            if prr > min_prr:
+                edges.append((int(tx_id), int(rx_id), prr, total / count))
+    edges.sort()
+
+    # Positions are irrelevant for the directed graph medium: use a grid
+    side = math.ceil(math.sqrt(len(ids)))
+    motes = [(i, SPACING * (n % side), SPACING * (n // side)) for n, i in enumerate(ids)]
+
+    write_csc(out_file, motes, dgrm_xml(edges), template=template, seed=seed)
+    print(f"{out_file}: {len(motes)} motes, {len(edges)} links")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Generate a Cooja simulation from a testbed connectivity log.")
+    parser.add_argument('logfile', help="connectivity log (e.g., the Lab 5 job.log)")
+    parser.add_argument('csc', help="simulation to write, best placed in cooja_no_gui/")
+    parser.add_argument('-c', '--channel', type=int,
+                        help="channel of the sweep configuration to use (SWEEP_MODE logs)")
+    parser.add_argument('-p', '--power', type=int,
+                        help="TX power (dBm) of the sweep configuration to use (SWEEP_MODE logs)")
+    parser.add_argument('-m', '--min-prr', type=float, default=0.0,
+                        help="ignore links with a PRR not above this value (0-1)")
+    parser.add_argument('-t', '--template', default=DEFAULT_TEMPLATE,
+                        help="simulation to take mote type, plugins and test script from")
+    parser.add_argument('-s', '--seed', type=int, help="random seed of the simulation")
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    args = parse_args()
+    if not os.path.isfile(args.logfile):
+        print("The logfile argument {} is not a file.".format(args.logfile))
+        sys.exit(1)
+    if (args.channel is None) != (args.power is None):
+        print("Channel and TX power must be given together.")
+        sys.exit(1)
+
+    config = None if args.channel is None else (args.channel, args.power)
+    build_csc(args.logfile, args.csc, config=config, min_prr=args.min_prr,
+              template=args.template, seed=args.seed)
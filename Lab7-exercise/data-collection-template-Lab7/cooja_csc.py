@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Helpers to write Cooja simulation files (.csc) for the data collection app.
+
+New simulations are derived from one of the existing cooja_no_gui/*.csc files:
+the mote type, plugins and test script are kept, while the radio medium, the
+motes, the random seed and the names of the log files written by the test
+script are replaced. Keep the generated files in cooja_no_gui/ so that the
+firmware path ([CONFIG_DIR]/../app.sky) still resolves.
+"""
+import os
+import re
+
+DEFAULT_TEMPLATE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                "cooja_no_gui", "test_nogui.csc")
+
+MOTE_XML = """    <mote>
+      <breakpoints />
+      <interface_config>
+        org.contikios.cooja.interfaces.Position
+        <x>{x}</x>
+        <y>{y}</y>
+        <z>0.0</z>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspClock
+        <deviation>1.0</deviation>
+      </interface_config>
+      <interface_config>
+        org.contikios.cooja.mspmote.interfaces.MspMoteID
+        <id>{id}</id>
+      </interface_config>
+      <motetype_identifier>sky1</motetype_identifier>
+    </mote>
+"""
+
+
+def udgm_xml(tx_range, interference_range, success_tx=1.0, success_rx=1.0):
+    # Unit disk graph medium, as used by the hand-made simulations
+    return f"""    <radiomedium>
+      org.contikios.cooja.radiomediums.UDGM
+      <transmitting_range>{tx_range}</transmitting_range>
+      <interference_range>{interference_range}</interference_range>
+      <success_ratio_tx>{success_tx}</success_ratio_tx>
+      <success_ratio_rx>{success_rx}</success_ratio_rx>
+    </radiomedium>
+"""
+
+
+def dgrm_xml(edges):
+    # Directed graph medium: one edge per (source ID, destination ID, PRR, RSSI)
+    xml = "    <radiomedium>\n      org.contikios.cooja.radiomediums.DirectedGraphMedium\n"
+    for src, dst, ratio, signal in edges:
+        xml += f"""      <edge>
+        <source>{src}</source>
+        <dest>
+          org.contikios.cooja.radiomediums.DGRMDestinationRadio
+          <radio>{dst}</radio>
+          <ratio>{ratio:.3f}</ratio>
+          <signal>{signal:.1f}</signal>
+          <lqi>105</lqi>
+          <delay>0</delay>
+          <channel>-1</channel>
+        </dest>
+      </edge>
+"""
+    return xml + "    </radiomedium>\n"
+
+
+def write_csc(out_file, motes, radiomedium, template=DEFAULT_TEMPLATE, seed=None):
+    """Write a simulation with the given motes [(id, x, y), ...] and radio medium XML."""
+    with open(template, 'r') as f:
+        csc = f.read()
+
+    # Radio medium
+    csc = re.sub(r"    <radiomedium>.*?</radiomedium>\n", lambda m: radiomedium, csc, count=1, flags=re.S)
+    if "DirectedGraphMedium" in radiomedium:
+        csc = csc.replace("skins.UDGMVisualizerSkin", "skins.DGRMVisualizerSkin")
+
+    # Motes: drop the template ones and add the new ones after the mote type
+    csc = re.sub(r"    <mote>\n      <breakpoints />.*?</mote>\n", "", csc, flags=re.S)
+    new_motes = "".join(MOTE_XML.format(id=i, x=x, y=y) for i, x, y in motes)
+    csc = csc.replace("    </motetype>\n", "    </motetype>\n" + new_motes, 1)
+
+    # The TimeLine plugin refers to motes by index, keep only existing ones
+    csc = re.sub(r"      <mote>(\d+)</mote>\n",
+                 lambda m: m.group(0) if int(m.group(1)) < len(motes) else "", csc)
+
+    with open(out_file, 'w') as f:
+        f.write(set_run_options(csc, out_file, seed=seed))
+
+
+def set_run_options(csc, out_file, seed=None, timeout=None):
+    # Random seed, test script timeout (ms of simulated time) and names of the
+    # log files written by the test script, which follow the simulation name
+    if seed is not None:
+        csc = re.sub(r"<randomseed>\d+</randomseed>", f"<randomseed>{seed}</randomseed>", csc)
+    if timeout is not None:
+        csc = re.sub(r"TIMEOUT\(\d+\)", f"TIMEOUT({timeout})", csc)
+    name = os.path.splitext(os.path.basename(out_file))[0]
+    return re.sub(r'new FileWriter\("[^"]*?(_dc)?\.log"\)',
+                  lambda m: f'new FileWriter("{name}{m.group(1) or ""}.log")', csc)
+
+
+def copy_csc(template, out_file, seed=None, timeout=None):
+    """Copy a simulation, changing only its random seed, timeout and log file names."""
+    with open(template, 'r') as f:
+        csc = f.read()
+    with open(out_file, 'w') as f:
+        f.write(set_run_options(csc, out_file, seed=seed, timeout=timeout))
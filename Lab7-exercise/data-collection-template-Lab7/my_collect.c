@@ -8,14 +8,18 @@
 #include "core/net/linkaddr.h"
 #include "my_collect.h"
 /*---------------------------------------------------------------------------*/
+#ifndef BEACON_INTERVAL /* Can be overridden in project-conf.h (see sweep.py) */
 #define BEACON_INTERVAL (CLOCK_SECOND * 60) /* Time the sink should wait before rebuilding the tree from scratch.
                                              * [Lab 7] Try to change this period to analyse
                                              * how it affects the radio-on time (i.e., energy
                                              * consumption) of you solution and ContikiMac.
                                              */ 
+#endif
 #define BEACON_FORWARD_DELAY (random_rand() % CLOCK_SECOND)
 /*---------------------------------------------------------------------------*/
+#ifndef RSSI_THRESHOLD
 #define RSSI_THRESHOLD -95 // Links with RSSI < RSSI_THRESHOLD should be neglected!
+#endif
 /*---------------------------------------------------------------------------*/
 /* Callback function declarations */
 void bc_recv(struct broadcast_conn *conn, const linkaddr_t *sender); 
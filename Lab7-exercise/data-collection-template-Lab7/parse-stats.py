@@ -3,8 +3,10 @@ from __future__ import division
 
 import re
 import sys
+import bisect
 import os.path
 import argparse
+import functools
 from datetime import datetime
 
 sink_id = 1
@@ -22,11 +24,158 @@ addr_id_map = {
 }
 
 
-def parse_file(log_file, testbed=False):
-    # Print some basic information for the user
-    print(f"Logfile: {log_file}")
-    print(f"{'Cooja simulation' if not testbed else 'Testbed experiment'}")
+@functools.lru_cache(maxsize=16)
+def testbed_second(second_str):
+    # strptime is by far the slowest part of parsing a large log: convert each
+    # whole second only once
+    return datetime.strptime(second_str, '%Y-%m-%d %H:%M:%S').timestamp()
+
+
+def testbed_timestamp(time_str):
+    # Testbed timestamps look like "2025-10-28 16:22:11,761": the whole second,
+    # then the fraction of a second with however many digits the log has
+    frac = time_str[20:]
+    return testbed_second(time_str[:19]) + (int(frac) / 10 ** len(frac) if frac else 0)
+
+
+def cooja_timestamp(time_str):
+    # Cooja timestamps are either microseconds ("1234567", headless runs) or
+    # formatted as "[hh:]mm:ss.mmm" (LogListener with formatted time)
+    if ':' not in time_str:
+        return int(time_str) / 1000000
+    seconds = 0
+    for field in time_str.split(':'):
+        seconds = seconds * 60 + float(field)
+    return seconds
+
+
+def percentile(values, p):
+    # Percentile of a sorted list, interpolating between the closest ranks
+    if len(values) == 1:
+        return values[0]
+    k = (len(values) - 1) * p / 100
+    f = int(k)
+    c = min(f + 1, len(values) - 1)
+    return values[f] + (values[c] - values[f]) * (k - f)
+
+
+def print_latency_table(title, groups):
+    # One line per group with the latency distribution in ms
+    print("{:>8} {:>7} {:>9} {:>9} {:>9} {:>9} {:>9}".format(
+        title, "Packets", "Mean", "p50", "p95", "p99", "Max"))
+    for key in sorted(groups):
+        lat = sorted(groups[key])
+        print("{:>8} {:>7} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f} {:>9.2f}".format(
+            key, len(lat), 1000 * sum(lat) / len(lat), 1000 * percentile(lat, 50),
+            1000 * percentile(lat, 95), 1000 * percentile(lat, 99), 1000 * lat[-1]))
+
+
+def latency_records(log):
+    # End-to-end latency of every packet received by the sink, with the beacon
+    # round (sink beacon seqn) during which it was sent and the offset into the round
+    beacons = sorted(log["beacons"])
+    beacon_times = [b[0] for b in beacons]
+    records = []
+    for src in log["lrecv"]:
+        for seqn, trecv in log["lrecv"][src].items():
+            if seqn not in log["lsent"].get(src, {}):
+                continue
+            tsent = log["lsent"][src][seqn]
+            i = bisect.bisect_right(beacon_times, tsent) - 1
+            rnd, offset = (beacons[i][1], tsent - beacons[i][0]) if i >= 0 else (-1, float('nan'))
+            records.append((tsent, src, seqn, log["dhops"][src][seqn], trecv - tsent, rnd, offset))
+    records.sort()
+    return records
+
+
+def convergence_time(log):
+    # Time from the first sink beacon until every node that booted has selected
+    # a parent at least once, None if some node never joined the tree
+    if not log["beacons"]:
+        return None
+    joined = [log["parents"].get(node_id) for node_id in log["nodes"] if node_id != sink_id]
+    if None in joined:
+        return None
+    start = min(log["beacons"])[0]
+    return max(joined) - start if joined else 0.0
+
+
+def collection_stats(log):
+    # Summary of a parsed log, as reported by the simulation sweep
+    tsent = sum(len(s) for s in log["dsent"].values())
+    trecv = sum(len(r) for src, r in log["drecv"].items() if src in log["dsent"])
+    lat = sorted(r[4] for r in latency_records(log))
+    hops = [h for src in log["dhops"] for h in log["dhops"][src].values()]
+    nodes = [node_id for node_id in log["nodes"] if node_id != sink_id]
+    return {
+        "sent": tsent,
+        "received": trecv,
+        "pdr": 100 * trecv / tsent if tsent else None,
+        "lat_mean": 1000 * sum(lat) / len(lat) if lat else None,
+        "lat_p50": 1000 * percentile(lat, 50) if lat else None,
+        "lat_p95": 1000 * percentile(lat, 95) if lat else None,
+        "beacons": log["ctrl"],
+        "depth_mean": sum(hops) / len(hops) if hops else None,
+        "depth_max": max(hops) if hops else None,
+        "joined": sum(1 for node_id in nodes if node_id in log["parents"]),
+        "nodes": len(nodes),
+        "convergence": convergence_time(log),
+    }
+
 
+def analyze_latency(log, flat_name, plot=False):
+    records = latency_records(log)
+    if not records:
+        print("No packet could be matched to its transmission, no latency statistics.\n")
+        return
+    beacon_times = sorted(b[0] for b in log["beacons"])
+
+    # Write CSV file
+    with open(flat_name, 'w') as flat:
+        flat.write("time\tsrc\tseqn\thops\tlatency\tround\tround_offset\n")
+        for r in records:
+            flat.write("{:.6f}\t{}\t{}\t{}\t{:.6f}\t{}\t{:.6f}\n".format(*r))
+
+    # Print latency distributions per node and per hop count
+    per_node = {}
+    per_hops = {}
+    for r in records:
+        per_node.setdefault(r[1], []).append(r[4])
+        per_hops.setdefault(r[3], []).append(r[4])
+    print("########## Latency Statistics (ms) ##########\n")
+    print_latency_table("Node", per_node)
+    print("")
+    print_latency_table("Hops", per_hops)
+    print("")
+    print_latency_table("Overall", {"all": [r[4] for r in records]})
+    print("")
+
+    if plot:
+        # Imported here so that matplotlib is only needed for plots
+        import matplotlib
+        matplotlib.use('Agg')
+        import matplotlib.pyplot as plt
+        t0 = min(records[0][0], beacon_times[0] if beacon_times else records[0][0])
+        fig, ax = plt.subplots(figsize=(12, 5))
+        sc = ax.scatter([r[0] - t0 for r in records], [1000 * r[4] for r in records],
+                        c=[r[3] for r in records], s=8, cmap='viridis')
+        for t in beacon_times:
+            ax.axvline(t - t0, color='grey', linewidth=0.5, linestyle='--')
+        fig.colorbar(sc, ax=ax, label="Hops")
+        ax.set_xlabel("Send time [s] (dashed: sink beacons)")
+        ax.set_ylabel("Latency [ms]")
+        fig.tight_layout()
+        fig.savefig(os.path.splitext(flat_name)[0] + ".png")
+        plt.close(fig)
+
+
+def parse_log(log_file, testbed=False):
+    """Parse a data collection log and write its -recv/-sent CSV files.
+
+    Returns a dict with the nodes that booted, the sent and received packets
+    (timestamps as written in the log and in seconds), their hop counts, the
+    beacons sent by the sink and the time each node first selected a parent.
+    """
     # Create CSV output files
     fpath = os.path.dirname(log_file)
     fname_common = os.path.splitext(os.path.basename(log_file))[0]
@@ -48,6 +197,9 @@ def parse_file(log_file, testbed=False):
                                 r"seqn (?P<seqn>\d+) hops (?P<hops>\d+)'".format(testbed_record_pattern))
         regex_sent = re.compile(r"{}'App: Send seqn (?P<seqn>\d+)'".format(
             testbed_record_pattern))
+        regex_beacon = re.compile(r"{}'my_collect: sending beacon: seqn (?P<seqn>\d+)".format(
+            testbed_record_pattern))
+        regex_parent = re.compile(r"{}'my_collect: new parent".format(testbed_record_pattern))
     else:
         # Regular expressions for COOJA
         record_pattern = r"(?P<time>[\w:.]+)\s+ID:(?P<self_id>\d+)\s+"
@@ -57,15 +209,43 @@ def parse_file(log_file, testbed=False):
                                 r"seqn (?P<seqn>\d+) hops (?P<hops>\d+)".format(record_pattern))
         regex_sent = re.compile(r"{}App: Send seqn (?P<seqn>\d+)".format(
             record_pattern))
+        regex_beacon = re.compile(r"{}my_collect: sending beacon: seqn (?P<seqn>\d+)".format(
+            record_pattern))
+        regex_parent = re.compile(r"{}my_collect: new parent".format(record_pattern))
+    to_seconds = testbed_timestamp if testbed else cooja_timestamp
 
     # Node list and dictionaries for later processing
     nodes = []
     drecv = {}
     dsent = {}
+    # Numeric timestamps (s) and hop counts for latency analysis, beacons sent by the sink
+    lrecv = {}
+    lsent = {}
+    dhops = {}
+    beacons = []
+    # Time of the first parent selection of each node, for the tree convergence time
+    parents = {}
+    # Beacons sent by all nodes (control traffic)
+    ctrl = 0
 
-    # Parse log file and add data to CSV files
-    with open(log_file, 'r') as f:
+    # Parse log file and add data to CSV files.
+    # Only lines carrying one of the records below are handed to the regexes.
+    with open(log_file, 'r', buffering=1 << 20) as f:
         for line in f:
+            if "App: " not in line and "Rime " not in line:
+                # Sink beacons mark the rounds for the latency analysis
+                if "sending beacon" in line:
+                    m = regex_beacon.match(line)
+                    if m:
+                        ctrl += 1
+                        if int(m.group("self_id")) == sink_id:
+                            beacons.append((to_seconds(m.group("time")), int(m.group("seqn"))))
+                elif "new parent" in line:
+                    m = regex_parent.match(line)
+                    if m and int(m.group("self_id")) not in parents:
+                        parents[int(m.group("self_id"))] = to_seconds(m.group("time"))
+                continue
+
             # Node boot
             m = regex_node.match(line)
             if m:
@@ -84,8 +264,7 @@ def parse_file(log_file, testbed=False):
                 # Get dictionary with data
                 d = m.groupdict()
                 if testbed:
-                    ts = datetime.strptime(d["time"], '%Y-%m-%d %H:%M:%S,%f')
-                    ts = ts.timestamp()
+                    ts = testbed_timestamp(d["time"])
                     src_addr = "{}:{}".format(d["src1"], d["src2"])
                     try:
                         src = addr_id_map[src_addr]
@@ -95,8 +274,8 @@ def parse_file(log_file, testbed=False):
 
                 else:
                     ts = d["time"]
-                    # Discard second byte and convert to decimal
-                    src = int(d["src1"], 16)
+                    # Node IDs are stored little endian in the Rime address (IDs above 255 on large topologies)
+                    src = int(d["src1"], 16) + (int(d["src2"], 16) << 8)
                 dest = int(d["self_id"])
                 seqn = int(d["seqn"])
                 hops = int(d["hops"])
@@ -106,6 +285,8 @@ def parse_file(log_file, testbed=False):
                 # Save data in the drecv dictionary for later processing
                 if dest == sink_id:
                     drecv.setdefault(src, {})[seqn] = ts
+                    lrecv.setdefault(src, {})[seqn] = to_seconds(d["time"])
+                    dhops.setdefault(src, {})[seqn] = hops
                 # Continue with the following line
                 continue
 
@@ -114,8 +295,7 @@ def parse_file(log_file, testbed=False):
             if m:
                 d = m.groupdict()
                 if testbed:
-                    ts = datetime.strptime(d["time"], '%Y-%m-%d %H:%M:%S,%f')
-                    ts = ts.timestamp()
+                    ts = testbed_timestamp(d["time"])
                 else:
                     ts = d["time"]
                 src = int(d["self_id"])
@@ -125,6 +305,26 @@ def parse_file(log_file, testbed=False):
                 fsent.write("{}\t{}\t{}\t{}\n".format(ts, dest, src, seqn))
                 # Save data in the dsent dictionary
                 dsent.setdefault(src, {})[seqn] = ts
+                lsent.setdefault(src, {})[seqn] = to_seconds(d["time"])
+
+    frecv.close()
+    fsent.close()
+
+    return {"nodes": nodes, "dsent": dsent, "drecv": drecv, "lsent": lsent, "lrecv": lrecv,
+            "dhops": dhops, "beacons": beacons, "parents": parents, "ctrl": ctrl}
+
+
+def parse_file(log_file, testbed=False, plot=False):
+    # Print some basic information for the user
+    print(f"Logfile: {log_file}")
+    print(f"{'Cooja simulation' if not testbed else 'Testbed experiment'}")
+
+    log = parse_log(log_file, testbed=testbed)
+    nodes = log["nodes"]
+    dsent = log["dsent"]
+    drecv = log["drecv"]
+    fname_common = os.path.splitext(log_file)[0]
+    flat_name = f"{fname_common}-latency.csv"
 
     # Analyze dictionaries and print some stats
     # Overall number of packets sent / received
@@ -176,6 +376,9 @@ def parse_file(log_file, testbed=False):
     print("Overall PDR = {:.2f}%".format(opdr))
     print("Overall PLR = {:.2f}%\n".format(100 - opdr))
 
+    # Latency statistics
+    analyze_latency(log, flat_name, plot=plot)
+
 
 def parse_args():
     parser = argparse.ArgumentParser()
@@ -183,6 +386,8 @@ def parse_args():
                         help="data collection logfile to be parsed and analyzed.")
     parser.add_argument('-t', '--testbed', action='store_true',
                         help="flag for testbed experiments")
+    parser.add_argument('-p', '--plot', action='store_true',
+                        help="plot latency over time (requires matplotlib)")
     return parser.parse_args()
 
 
@@ -200,4 +405,4 @@ if __name__ == '__main__':
         sys.exit(1)
 
     # Parse log file, create CSV files, and print some stats
-    parse_file(args.logfile, testbed=args.testbed)
+    parse_file(args.logfile, testbed=args.testbed, plot=args.plot)
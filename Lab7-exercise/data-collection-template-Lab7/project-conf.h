@@ -14,8 +14,12 @@
     #define RF_CORE_CONF_CHANNEL                 26
     #define RF_BLE_CONF_ENABLED                   0
     /*---------------------------------------------------------------------------*/
+    /* RDC driver, APP_CONF_RDC is set by the simulation sweep (see sweep.py) */
+    #ifndef APP_CONF_RDC
+    #define APP_CONF_RDC                     nullrdc_driver
+    #endif
     #undef NETSTACK_CONF_RDC
-    #define NETSTACK_CONF_RDC                nullrdc_driver
+    #define NETSTACK_CONF_RDC                APP_CONF_RDC
 #else /* Config for the Zolertia Firefly */
     #define IEEE802154_CONF_PANID         0xABCD
     /*---------------------------------------------------------------------------*/
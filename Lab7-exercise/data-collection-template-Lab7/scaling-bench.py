@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""Scaling benchmark of the data collection app on large random topologies.
+
+For every network size, topologies are generated with topology.py (one per
+seed) and simulated headless in Cooja with the current firmware. The runs are
+reduced to one line per size:
+  PDR       packets received by the sink / packets sent
+  Overhead  beacons sent by all nodes per packet delivered to the sink
+  Sink      packets received by the sink per minute
+  Depth     mean and max hop count of the delivered packets
+  Stretch   mean ratio between the hop count of a packet and the shortest
+            path from its source to the sink
+
+Runs that cross the thresholds, or that are worse than a previous results
+file (--baseline) by more than the tolerance, are flagged and make the script
+exit with status 1.
+"""
+import os
+import sys
+import argparse
+from concurrent.futures import ThreadPoolExecutor
+
+import topology
+from sweep import HERE, build_variant, run_simulation, duty_cycle, load_parse_stats, print_table, fmt
+
+COLUMNS = ["nodes", "runs", "pdr", "overhead", "sink_load", "depth_mean", "depth_max", "stretch", "duty_cycle"]
+
+
+def run_size(n, seed, args, parse_stats):
+    # Generate the topology next to the firmware and simulate it
+    name = f"scale-{args.layout}-n{n}-s{seed}"
+    csc = os.path.join(args.workdir, "topologies", name + ".csc")
+    points, dist, _ = topology.generate(args.layout, n, args.range, density=args.density,
+                                        diameter=args.diameter, sink=args.sink, seed=seed)
+    topology.write_topology(csc, points, args.range, seed=seed)
+
+    log_file, dc_file = run_simulation(os.path.join(args.workdir, name), csc, seed, args.duration * 1000,
+                                       args.contiki, args.cooja, memory=args.memory)
+    if not os.path.isfile(log_file):
+        print(f"{name}: simulation produced no log, see cooja.out")
+        return None
+    log = parse_stats.parse_log(log_file)
+    stats = parse_stats.collection_stats(log)
+
+    # Mote IDs start from the sink, the hop distances are indexed from 0
+    ratios = [h / dist[src - topology.sink_id] for src in log["dhops"] if 0 < src - topology.sink_id < n
+              for h in log["dhops"][src].values()]
+    stats["overhead"] = stats["beacons"] / stats["received"] if stats["received"] else None
+    stats["sink_load"] = stats["received"] * 60 / args.duration
+    stats["stretch"] = sum(ratios) / len(ratios) if ratios else None
+    stats["duty_cycle"] = duty_cycle(dc_file, parse_stats.sink_id) if os.path.isfile(dc_file) else None
+    print(f"{name}: done")
+    return stats
+
+
+def summarize(n, runs):
+    # Average the runs of one size over the seeds
+    row = {"nodes": n, "runs": len([s for s in runs if s is not None])}
+    for k in COLUMNS[2:]:
+        data = [s[k] for s in runs if s is not None and s[k] is not None]
+        row[k] = (max(data) if k == "depth_max" else sum(data) / len(data)) if data else None
+    return row
+
+
+def load_baseline(csv_file):
+    baseline = {}
+    with open(csv_file, 'r') as f:
+        header = f.readline().strip().split(',')
+        for line in f:
+            values = dict(zip(header, line.strip().split(',')))
+            baseline[int(values["nodes"])] = {k: float(v) for k, v in values.items() if v and k != "nodes"}
+    return baseline
+
+
+def check(row, args, baseline):
+    # Reasons why a size is considered a regression
+    flags = []
+    if row["runs"] == 0:
+        return ["no run completed"]
+    if row["pdr"] is not None and row["pdr"] < args.min_pdr:
+        flags.append(f"PDR {row['pdr']:.2f}% < {args.min_pdr}%")
+    if args.max_overhead is not None and row["overhead"] is not None and row["overhead"] > args.max_overhead:
+        flags.append(f"overhead {row['overhead']:.2f} > {args.max_overhead}")
+    if row["stretch"] is not None and row["stretch"] > args.max_stretch:
+        flags.append(f"stretch {row['stretch']:.2f} > {args.max_stretch}")
+    ref = baseline.get(row["nodes"])
+    if ref:
+        if row["pdr"] is not None and "pdr" in ref and row["pdr"] < ref["pdr"] - args.pdr_tolerance:
+            flags.append(f"PDR {row['pdr']:.2f}% vs baseline {ref['pdr']:.2f}%")
+        for k in ["overhead", "stretch"]:
+            if row[k] is not None and k in ref and row[k] > ref[k] * (1 + args.tolerance):
+                flags.append(f"{k} {row[k]:.2f} vs baseline {ref[k]:.2f}")
+    return flags
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Benchmark the data collection app on growing random topologies.")
+    parser.add_argument('-n', '--nodes', default="200,400,600,800,1000",
+                        help="comma-separated network sizes")
+    parser.add_argument('-l', '--layout', choices=topology.LAYOUTS, default="rgg")
+    parser.add_argument('-D', '--density', type=float, default=10.0,
+                        help="average number of neighbours of a node")
+    parser.add_argument('-d', '--diameter', type=float,
+                        help="hops from the sink to the farthest corner (instead of the density)")
+    parser.add_argument('-r', '--range', type=float, default=50.0, help="UDGM transmission range in m")
+    parser.add_argument('--sink', choices=["corner", "center"], default="center")
+    parser.add_argument('--seeds', default="1", help="comma-separated seeds (layout and simulation)")
+    parser.add_argument('-t', '--duration', type=int, default=1800, help="simulated time in s")
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help="parallel simulations (default: number of cores)")
+    parser.add_argument('-m', '--memory', default="4g", help="Java heap of each Cooja instance")
+    parser.add_argument('-w', '--workdir', default=os.path.join(HERE, "scaling"),
+                        help="directory for the build, topologies and simulation logs")
+    parser.add_argument('--contiki', default=os.environ.get("CONTIKI", os.path.join(HERE, "..", "..", "contiki")),
+                        help="Contiki path (default: $CONTIKI or ../../contiki)")
+    parser.add_argument('--min-pdr', type=float, default=90.0, help="lowest acceptable PDR (%%)")
+    parser.add_argument('--max-overhead', type=float,
+                        help="highest acceptable number of beacons per delivered packet")
+    parser.add_argument('--max-stretch', type=float, default=1.5, help="highest acceptable path stretch")
+    parser.add_argument('-b', '--baseline', help="results CSV of a previous run to compare with")
+    parser.add_argument('--pdr-tolerance', type=float, default=2.0,
+                        help="acceptable PDR drop with respect to the baseline (%% points)")
+    parser.add_argument('--tolerance', type=float, default=0.1,
+                        help="acceptable relative increase of overhead and stretch with respect to the baseline")
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    args = parse_args()
+    if args.diameter is not None and args.layout != "corridor":
+        args.density = None
+    args.contiki = os.path.abspath(args.contiki)
+    args.workdir = os.path.abspath(args.workdir)
+    args.cooja = os.path.join(args.contiki, "tools", "cooja", "dist", "cooja.jar")
+    if not os.path.isfile(args.cooja):
+        print(f"Cooja not found at {args.cooja}, build it with \"ant jar\" first.")
+        sys.exit(1)
+    baseline = load_baseline(args.baseline) if args.baseline else {}
+
+    # All sizes use the same firmware, the simulations are placed one level below it
+    os.makedirs(os.path.join(args.workdir, "topologies"), exist_ok=True)
+    if not build_variant(args.workdir, (), args.contiki):
+        print(f"Build failed, see {args.workdir}/build.log")
+        sys.exit(1)
+
+    sizes = [int(n) for n in args.nodes.split(',')]
+    seeds = [int(s) for s in args.seeds.split(',')]
+    parse_stats = load_parse_stats()
+    jobs = [(n, seed) for n in sizes for seed in seeds]
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        stats = list(pool.map(lambda job: run_size(job[0], job[1], args, parse_stats), jobs))
+
+    rows = [summarize(n, [s for (size, _), s in zip(jobs, stats) if size == n]) for n in sizes]
+    out_file = os.path.join(args.workdir, "results.csv")
+    with open(out_file, 'w') as f:
+        f.write(",".join(COLUMNS) + "\n")
+        for row in rows:
+            f.write(",".join("" if row[k] is None else str(row[k]) for k in COLUMNS) + "\n")
+
+    print(f"\n########## Scaling Results ({args.layout}, mean over {len(seeds)} seeds) ##########\n")
+    print_table(["Nodes", "Runs", "PDR%", "Overhead", "Sink/min", "Depth", "MaxDepth", "Stretch", "DC%"],
+                [[fmt(row[k]) for k in COLUMNS] for row in rows])
+    print(f"\nResults written to {out_file}")
+
+    regressions = [(row["nodes"], check(row, args, baseline)) for row in rows]
+    regressions = [(n, flags) for n, flags in regressions if flags]
+    if regressions:
+        print("\n----- REGRESSIONS -----")
+        for n, flags in regressions:
+            print(f"{n} nodes: " + ", ".join(flags))
+        sys.exit(1)
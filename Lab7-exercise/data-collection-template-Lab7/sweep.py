@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Run headless Cooja simulations over a grid of firmware parameters.
+
+Each combination of parameter values (a variant) is built in its own copy of
+the project, with the values written into the copied project-conf.h. Every
+variant is then simulated on each of the selected simulations and random
+seeds, in parallel, and the logs are reduced to one results table with the
+PDR, latency, radio duty cycle and tree convergence time of every run.
+
+Example (Cooja must have been built with "ant jar" in tools/cooja):
+    python3 sweep.py -g beacon_interval=30,60,120 -g rdc=nullrdc,contikimac --seeds 1,2,3
+"""
+import os
+import re
+import sys
+import shutil
+import argparse
+import itertools
+import subprocess
+import importlib.util
+from concurrent.futures import ThreadPoolExecutor
+
+from cooja_csc import copy_csc
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# Sweep parameters: name -> (macro written in project-conf.h, value format)
+PARAMS = {
+    "beacon_interval": ("BEACON_INTERVAL", "(CLOCK_SECOND * {})"),   # s
+    "msg_period":      ("MSG_PERIOD", "(CLOCK_SECOND * {})"),        # s
+    "rssi_threshold":  ("RSSI_THRESHOLD", "({})"),                   # dBm
+    "tx_power":        ("APP_CONF_TX_POWER", "({})"),                # dBm
+    "rdc":             ("APP_CONF_RDC", "{}_driver"),                # nullrdc, contikimac, cxmac
+}
+
+# Files copied into every variant build directory
+SOURCES = ["app.c", "my_collect.c", "my_collect.h", "project-conf.h", "Makefile"]
+
+METRICS = ["sent", "received", "pdr", "lat_mean", "lat_p50", "lat_p95", "beacons",
+           "depth_mean", "depth_max", "duty_cycle", "joined", "nodes", "convergence"]
+
+regex_dc = re.compile(r"^(?P<mote>.+?) ON \d+ us (?P<ratio>[\d.,]+) %")
+
+
+def load_parse_stats():
+    spec = importlib.util.spec_from_file_location("parse_stats", os.path.join(HERE, "parse-stats.py"))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+    return module
+
+
+def build_variant(variant_dir, values, contiki):
+    # Copy the sources and prepend the parameter values to project-conf.h,
+    # the firmware only provides defaults for the macros that are not defined
+    os.makedirs(variant_dir, exist_ok=True)
+    for name in SOURCES:
+        shutil.copy(os.path.join(HERE, name), variant_dir)
+    overrides = "".join("#define {} {}\n".format(PARAMS[p][0], PARAMS[p][1].format(v))
+                        for p, v in values)
+    conf = os.path.join(variant_dir, "project-conf.h")
+    with open(conf, 'r') as f:
+        text = f.read()
+    with open(conf, 'w') as f:
+        f.write(text.replace("#define PROJECT_CONF_H_\n", "#define PROJECT_CONF_H_\n" + overrides, 1))
+
+    with open(os.path.join(variant_dir, "build.log"), 'w') as log:
+        ret = subprocess.call(["make", "TARGET=sky", f"CONTIKI={contiki}", "app.sky"],
+                              cwd=variant_dir, stdout=log, stderr=subprocess.STDOUT)
+    return ret == 0
+
+
+def run_simulation(run_dir, csc, seed, timeout, contiki, cooja_jar, memory="512m"):
+    # The simulation is placed one level below the firmware, so that
+    # [CONFIG_DIR]/../app.sky resolves, and the test script logs end up in run_dir
+    os.makedirs(run_dir, exist_ok=True)
+    name = os.path.splitext(os.path.basename(csc))[0]
+    sim = os.path.join(run_dir, name + ".csc")
+    copy_csc(csc, sim, seed=seed, timeout=timeout)
+    with open(os.path.join(run_dir, "cooja.out"), 'w') as out:
+        subprocess.call(["java", f"-mx{memory}", "-jar", cooja_jar, f"-nogui={sim}", f"-contiki={contiki}"],
+                        cwd=run_dir, stdout=out, stderr=subprocess.STDOUT)
+    return os.path.join(run_dir, name + ".log"), os.path.join(run_dir, name + "_dc.log")
+
+
+def duty_cycle(dc_file, sink_id):
+    # Average radio-on ratio (%) of the non-sink motes in the last PowerTracker dump
+    ratios = {}
+    with open(dc_file, 'r') as f:
+        for line in f:
+            m = regex_dc.match(line)
+            if m and m.group('mote') != "AVG":
+                ratios[m.group('mote')] = float(m.group('ratio').replace(',', '.'))
+    ratios = [r for mote, r in ratios.items() if not mote.endswith(f" {sink_id}")]
+    return sum(ratios) / len(ratios) if ratios else None
+
+
+def run_job(job, args, parse_stats):
+    vid, values, csc, seed = job
+    run_dir = os.path.join(args.workdir, f"v{vid}", "{}-s{}".format(
+        os.path.splitext(os.path.basename(csc))[0], seed))
+    log_file, dc_file = run_simulation(run_dir, csc, seed, args.timeout,
+                                       args.contiki, args.cooja)
+    if not os.path.isfile(log_file):
+        print(f"{run_dir}: simulation produced no log, see cooja.out")
+        return None
+    stats = parse_stats.collection_stats(parse_stats.parse_log(log_file))
+    stats["duty_cycle"] = duty_cycle(dc_file, parse_stats.sink_id) if os.path.isfile(dc_file) else None
+    print(f"{run_dir}: done")
+    return stats
+
+
+def fmt(value):
+    if value is None:
+        return "-"
+    return f"{value:.2f}" if isinstance(value, float) else str(value)
+
+
+def print_table(header, rows):
+    widths = [max(len(str(h)), *(len(r[i]) for r in rows)) for i, h in enumerate(header)]
+    print("  ".join(h.rjust(w) for h, w in zip(header, widths)))
+    for r in rows:
+        print("  ".join(c.rjust(w) for c, w in zip(r, widths)))
+
+
+def report(results, names, out_file):
+    # One row per run in the CSV file, runs averaged over the seeds on screen
+    header = names + ["sim", "seed"] + METRICS
+    with open(out_file, 'w') as f:
+        f.write(",".join(header) + "\n")
+        for (values, sim, seed), stats in results:
+            row = [str(v) for _, v in values] + [sim, str(seed)]
+            row += ["" if stats is None or stats[k] is None else str(stats[k]) for k in METRICS]
+            f.write(",".join(row) + "\n")
+
+    groups = {}
+    for (values, sim, seed), stats in results:
+        groups.setdefault((values, sim), []).append(stats)
+    rows = []
+    for (values, sim), runs in groups.items():
+        row = [str(v) for _, v in values] + [sim, str(sum(s is not None for s in runs))]
+        for k in ["pdr", "lat_p50", "lat_p95", "duty_cycle", "convergence"]:
+            data = [s[k] for s in runs if s is not None and s[k] is not None]
+            row.append(fmt(sum(data) / len(data) if data else None))
+        rows.append(row)
+    print("\n########## Sweep Results (mean over seeds) ##########\n")
+    print_table(names + ["sim", "runs", "PDR%", "p50ms", "p95ms", "DC%", "conv_s"], rows)
+    print(f"\nPer-run results written to {out_file}")
+
+
+def parse_grid(items):
+    grid = []
+    for item in items:
+        name, _, values = item.partition('=')
+        if name not in PARAMS or not values:
+            print(f"Invalid parameter {item}, expected NAME=V1,V2,... with NAME in {', '.join(PARAMS)}")
+            sys.exit(1)
+        grid.append((name, values.split(',')))
+    return grid
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Run headless Cooja simulations over a grid of firmware parameters.")
+    parser.add_argument('-g', '--grid', action='append', default=[], metavar="NAME=V1,V2",
+                        help="parameter values to sweep, one of: " + ", ".join(PARAMS))
+    parser.add_argument('-s', '--sim', action='append',
+                        help="simulation to run (default: all in cooja_no_gui/)")
+    parser.add_argument('--seeds', default="123456", help="comma-separated random seeds")
+    parser.add_argument('-d', '--duration', type=int,
+                        help="simulated time in s (default: test script TIMEOUT)")
+    parser.add_argument('-j', '--jobs', type=int, default=os.cpu_count(),
+                        help="parallel builds/simulations (default: number of cores)")
+    parser.add_argument('-w', '--workdir', default=os.path.join(HERE, "sweep"),
+                        help="directory for builds and simulation logs")
+    parser.add_argument('-o', '--output', help="results CSV (default: WORKDIR/results.csv)")
+    parser.add_argument('--contiki', default=os.environ.get("CONTIKI", os.path.join(HERE, "..", "..", "contiki")),
+                        help="Contiki path (default: $CONTIKI or ../../contiki)")
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    args = parse_args()
+    args.contiki = os.path.abspath(args.contiki)
+    args.workdir = os.path.abspath(args.workdir)
+    args.cooja = os.path.join(args.contiki, "tools", "cooja", "dist", "cooja.jar")
+    args.timeout = None if args.duration is None else args.duration * 1000
+    if not os.path.isfile(args.cooja):
+        print(f"Cooja not found at {args.cooja}, build it with \"ant jar\" first.")
+        sys.exit(1)
+
+    grid = parse_grid(args.grid)
+    names = [name for name, _ in grid]
+    variants = [tuple(zip(names, values)) for values in itertools.product(*[v for _, v in grid])]
+    sims = [os.path.abspath(s) for s in args.sim] if args.sim else sorted(
+        os.path.join(HERE, "cooja_no_gui", f) for f in os.listdir(os.path.join(HERE, "cooja_no_gui"))
+        if f.endswith(".csc"))
+    seeds = [int(s) for s in args.seeds.split(',')]
+    parse_stats = load_parse_stats()
+
+    print(f"{len(variants)} variants x {len(sims)} simulations x {len(seeds)} seeds, {args.jobs} jobs")
+    with ThreadPoolExecutor(max_workers=args.jobs) as pool:
+        # Build all variants first, the simulations share the firmware
+        built = list(pool.map(lambda v: build_variant(os.path.join(args.workdir, f"v{v[0]}"), v[1], args.contiki),
+                              enumerate(variants)))
+        for vid, ok in enumerate(built):
+            if not ok:
+                print(f"Build of variant {vid} {variants[vid]} failed, see {args.workdir}/v{vid}/build.log")
+        jobs = [(vid, values, csc, seed) for vid, values in enumerate(variants) if built[vid]
+                for csc in sims for seed in seeds]
+        stats = list(pool.map(lambda job: run_job(job, args, parse_stats), jobs))
+
+    results = [((values, os.path.splitext(os.path.basename(csc))[0], seed), s)
+               for (vid, values, csc, seed), s in zip(jobs, stats)]
+    if not results:
+        print("Nothing to report.")
+        sys.exit(1)
+    report(results, names, args.output or os.path.join(args.workdir, "results.csv"))
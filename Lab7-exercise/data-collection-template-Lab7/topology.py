@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Generate large random topologies for the data collection app.
+
+Three layouts are supported, all with the sink as mote 1:
+  rgg       random geometric graph in a square, sink in a corner or at the center
+  grid      regular grid, sink in a corner or at the center
+  corridor  random positions in a long rectangle, sink at one end
+
+The size of the area follows from the number of nodes and either the density
+(average number of neighbours within the transmission range) or the diameter
+(hops across the area). A corridor takes both, its width then follows.
+Random layouts are regenerated until every node can reach the sink.
+"""
+import sys
+import math
+import random
+import argparse
+from collections import deque
+
+from cooja_csc import DEFAULT_TEMPLATE, udgm_xml, write_csc
+
+sink_id = 1
+MAX_ATTEMPTS = 100
+
+
+def random_positions(n, width, height, sink, rnd):
+    return [sink] + [(rnd.uniform(0, width), rnd.uniform(0, height)) for _ in range(n - 1)]
+
+
+def rgg(n, tx_range, density=None, diameter=None, sink="corner", rnd=random):
+    if diameter is not None:
+        # The farthest corner at diameter ranges from the sink: half a diagonal
+        # away from the center, a whole one from a corner
+        side = diameter * tx_range * (math.sqrt(2) if sink == "center" else 1 / math.sqrt(2))
+    else:
+        side = tx_range * math.sqrt(n * math.pi / density)
+    pos = (0.0, 0.0) if sink == "corner" else (side / 2, side / 2)
+    return lambda: random_positions(n, side, side, pos, rnd)
+
+
+def grid(n, tx_range, density=None, diameter=None, sink="corner", rnd=random):
+    cols = math.ceil(math.sqrt(n))
+    if diameter is not None:
+        spacing = diameter * tx_range / (math.sqrt(2) * max(cols - 1, 1))
+        if sink == "center":
+            spacing *= 2
+    else:
+        # About pi * (range / spacing)^2 grid points fall within the range of a node
+        spacing = tx_range * math.sqrt(math.pi / (density + 1))
+    points = [(spacing * (i % cols), spacing * (i // cols)) for i in range(n)]
+    if sink == "center":
+        center = (spacing * (cols // 2), spacing * (((n - 1) // cols) // 2))
+        points.remove(center)
+        points.insert(0, center)
+    return lambda: points
+
+
+def corridor(n, tx_range, density=None, diameter=None, sink="corner", rnd=random, width=None):
+    area = n * math.pi * tx_range ** 2 / density if density is not None else None
+    if diameter is not None:
+        length = diameter * tx_range
+        width = width or (area / length if area else tx_range)
+    else:
+        width = width or tx_range
+        length = area / width
+    return lambda: random_positions(n, length, width, (0.0, width / 2), rnd)
+
+
+LAYOUTS = {"rgg": rgg, "grid": grid, "corridor": corridor}
+
+
+def neighbours(points, tx_range):
+    # Adjacency lists, using cells as large as the range to avoid comparing all pairs
+    cells = {}
+    for i, (x, y) in enumerate(points):
+        cells.setdefault((int(x // tx_range), int(y // tx_range)), []).append(i)
+    adj = [[] for _ in points]
+    for (cx, cy), members in cells.items():
+        for dx in (-1, 0, 1):
+            for dy in (-1, 0, 1):
+                for j in cells.get((cx + dx, cy + dy), []):
+                    for i in members:
+                        if i != j and math.dist(points[i], points[j]) <= tx_range:
+                            adj[i].append(j)
+    return adj
+
+
+def hop_distances(adj, root=0):
+    # Shortest hop count from the root to every node (BFS), None if unreachable
+    dist = [None] * len(adj)
+    dist[root] = 0
+    queue = deque([root])
+    while queue:
+        i = queue.popleft()
+        for j in adj[i]:
+            if dist[j] is None:
+                dist[j] = dist[i] + 1
+                queue.append(j)
+    return dist
+
+
+def generate(layout, n, tx_range, density=None, diameter=None, sink="corner", seed=None, width=None):
+    """Return the positions of n nodes (sink first) and their hop distance to the sink."""
+    rnd = random.Random(seed)
+    kwargs = {"width": width} if layout == "corridor" else {}
+    place = LAYOUTS[layout](n, tx_range, density=density, diameter=diameter, sink=sink, rnd=rnd, **kwargs)
+    for _ in range(MAX_ATTEMPTS):
+        points = place()
+        adj = neighbours(points, tx_range)
+        dist = hop_distances(adj)
+        if None not in dist:
+            return points, dist, adj
+    raise ValueError(f"no connected {layout} topology of {n} nodes after {MAX_ATTEMPTS} attempts, "
+                     "increase the density")
+
+
+def write_topology(out_file, points, tx_range, template=DEFAULT_TEMPLATE, seed=None):
+    # Mote IDs follow the order of the points, so the sink is mote 1
+    motes = [(i + sink_id, round(x, 2), round(y, 2)) for i, (x, y) in enumerate(points)]
+    write_csc(out_file, motes, udgm_xml(tx_range, 2 * tx_range), template=template, seed=seed)
+
+
+def describe(points, dist, adj):
+    degree = sum(len(a) for a in adj) / len(adj)
+    return f"{len(points)} motes, average degree {degree:.1f}, sink depth max {max(dist)} " \
+           f"mean {sum(dist) / (len(dist) - 1):.2f} hops"
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Generate a large random topology for the data collection app.")
+    parser.add_argument('layout', choices=LAYOUTS)
+    parser.add_argument('nodes', type=int, help="number of motes, including the sink")
+    parser.add_argument('csc', help="simulation to write, best placed in cooja_no_gui/")
+    parser.add_argument('-D', '--density', type=float,
+                        help="average number of neighbours of a node")
+    parser.add_argument('-d', '--diameter', type=float,
+                        help="hops from the sink to the farthest corner")
+    parser.add_argument('-w', '--width', type=float, help="corridor width in m")
+    parser.add_argument('-r', '--range', type=float, default=50.0,
+                        help="UDGM transmission range in m (interference range is twice as much)")
+    parser.add_argument('--sink', choices=["corner", "center"], default="corner")
+    parser.add_argument('-t', '--template', default=DEFAULT_TEMPLATE,
+                        help="simulation to take mote type, plugins and test script from")
+    parser.add_argument('-s', '--seed', type=int, help="seed of the layout and of the simulation")
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    args = parse_args()
+    if args.density is None and args.diameter is None:
+        print("Either the density or the diameter must be given.")
+        sys.exit(1)
+    if args.density is not None and args.diameter is not None and args.layout != "corridor":
+        print("Density and diameter can only be combined for a corridor.")
+        sys.exit(1)
+
+    try:
+        points, dist, adj = generate(args.layout, args.nodes, args.range, density=args.density,
+                                     diameter=args.diameter, sink=args.sink, seed=args.seed,
+                                     width=args.width)
+    except ValueError as e:
+        print(e)
+        sys.exit(1)
+    write_topology(args.csc, points, args.range, template=args.template, seed=args.seed)
+    print(f"{args.csc}: {describe(points, dist, adj)}")
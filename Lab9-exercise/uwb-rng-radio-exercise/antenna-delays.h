@@ -0,0 +1,3 @@
+/* Per-node antenna delays, one {{{addr0, addr1}}, tx, rx} entry per line,
+ * included by rng-support.c. Generated by antenna_calib.py from an all-pairs
+ * ranging log; the nodes not listed use ANTENNA_DELAY. */
@@ -0,0 +1,127 @@
+#!/usr/bin/env python3
+"""Solve per-node antenna delays from ranging logs and the deployment map.
+
+The distance measured between nodes a and b is biased by the error of their
+antenna delays: if node k needs dk more time units than configured (on TX and
+on RX alike), a two-way ranging measures (da + db) * MM_PER_DTU mm too much.
+The median bias of every pair gives one equation da + db = bias, solved in the
+least-squares sense over all the pairs of the logs.
+
+Ranging only observes the sum of the TX and RX delays of a node, which are set
+to the same value. The pairs must also connect the nodes in an odd cycle (e.g.
+three nodes ranging with each other): with a single initiator, or any bipartite
+set of pairs, a delay can move from one side to the other unnoticed and only
+the minimum-norm solution is given.
+
+Logs with several initiators can be collected by running rng-init on each node
+in turn, or all together with APP_TDMA (experiment-tdma.json).
+
+Example:
+    python3 antenna_calib.py log1.txt log2.txt -o antenna-delays.h
+"""
+import re
+import sys
+import argparse
+import numpy as np
+import pandas as pd
+
+from rng_eval import distance
+
+ANTENNA_DELAY = 16455 # Default of rng-support.h
+MM_PER_DTU = 299702547 * 1000 / (499.2e6 * 128) # Speed of light in air over DWT_TIME_UNITS
+
+# Ex.: RANGING OK [11:0c->19:15] 169 mm
+regex_rng = re.compile(r"RANGING OK \[(?P<init>\w\w:\w\w)->(?P<resp>\w\w:\w\w)\] (?P<dist>-?\d+) mm")
+
+
+def load_map(csv_file):
+    # Short address -> (NodeId, coordinates in m)
+    df = pd.read_csv(csv_file)
+    nodes = {}
+    for node_id, coord, addr in zip(df["NodeId"], df["Coordinates"], df["evb1000"]):
+        try:
+            nodes[addr[-5:]] = (node_id, list(map(float, coord.strip("[] ").split(','))))
+        except ValueError:
+            pass
+    return nodes
+
+
+def pair_biases(log_files, nodes):
+    # Measured minus true distance of every measurement, per unordered pair
+    errors = {}
+    for log_file in log_files:
+        with open(log_file, 'r', buffering=1 << 20) as f:
+            for line in f:
+                pos = line.find("RANGING OK")
+                m = regex_rng.match(line, pos) if pos >= 0 else None
+                if not m or m['init'] not in nodes or m['resp'] not in nodes:
+                    continue
+                true_dist = distance(nodes[m['init']][1], nodes[m['resp']][1]) * 1000
+                pair = tuple(sorted((m['init'], m['resp'])))
+                errors.setdefault(pair, []).append(int(m['dist']) - true_dist)
+    return errors
+
+
+def solve(biases):
+    # Least squares on da + db = bias_ab (in DWT_TIME_UNITS)
+    addrs = sorted({a for pair in biases for a in pair})
+    index = {a: i for i, a in enumerate(addrs)}
+    A = np.zeros((len(biases), len(addrs)))
+    b = np.zeros(len(biases))
+    for row, (pair, bias) in enumerate(biases.items()):
+        A[row, index[pair[0]]] = A[row, index[pair[1]]] = 1
+        b[row] = bias / MM_PER_DTU
+    delta, _, rank, _ = np.linalg.lstsq(A, b, rcond=None)
+    return dict(zip(addrs, delta)), rank
+
+
+def write_table(out_file, delays, nodes, log_files):
+    with open(out_file, 'w') as f:
+        f.write("/* Per-node antenna delays, one {{{addr0, addr1}}, tx, rx} entry per line,\n"
+                " * included by rng-support.c. Generated by antenna_calib.py from\n"
+                f" * {', '.join(log_files)}; the nodes not listed use ANTENNA_DELAY. */\n")
+        for addr, delay in sorted(delays.items(), key=lambda x: nodes[x[0]][0]):
+            a0, a1 = addr.split(':')
+            f.write(f"{{{{{{0x{a0}, 0x{a1}}}}}, {delay}, {delay}}}, // Node {nodes[addr][0]}\n")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Solve per-node antenna delays from ranging logs and the deployment map.")
+    parser.add_argument('logs', nargs='+', help="ranging logs (RANGING OK lines)")
+    parser.add_argument('-m', '--map', default="DEPT_evb1000_map.csv", help="deployment map")
+    parser.add_argument('-o', '--output', help="C table to write, e.g. antenna-delays.h")
+    parser.add_argument('-b', '--base', type=int, default=ANTENNA_DELAY,
+                        help="antenna delay the logs were collected with")
+    parser.add_argument('-n', '--min-samples', type=int, default=10,
+                        help="ignore the pairs with fewer measurements")
+    return parser.parse_args()
+
+
+if __name__ == '__main__':
+    args = parse_args()
+    nodes = load_map(args.map)
+    errors = pair_biases(args.logs, nodes)
+    biases = {pair: float(np.median(e)) for pair, e in errors.items() if len(e) >= args.min_samples}
+    if not biases:
+        print(f"No pair with at least {args.min_samples} measurements.")
+        sys.exit(1)
+
+    delta, rank = solve(biases)
+    delays = {addr: int(round(args.base + d)) for addr, d in delta.items()}
+    print(f"{len(biases)} pairs, {len(delta)} nodes")
+    if rank < len(delta):
+        print(f"WARNING: the pairs determine only {rank} of {len(delta)} delays (no odd cycle), "
+              "minimum-norm solution")
+
+    print("\n  Node  Addr   Correction  Delay")
+    for addr, d in sorted(delta.items(), key=lambda x: nodes[x[0]][0]):
+        print(f"{nodes[addr][0]:>6}  {addr}  {d:>+10.1f}  {delays[addr]:>5}")
+    print("\n  Pair          Samples  Bias mm  Residual mm")
+    for (a, b), bias in sorted(biases.items(), key=lambda x: (nodes[x[0][0]][0], nodes[x[0][1]][0])):
+        residual = bias - (delta[a] + delta[b]) * MM_PER_DTU
+        print(f"{nodes[a][0]:>4} - {nodes[b][0]:<4}  {len(errors[(a, b)]):>10}  {bias:>7.0f}  {residual:>11.0f}")
+
+    if args.output:
+        write_table(args.output, delays, nodes, args.logs)
+        print(f"\nTable written to {args.output}, rebuild the firmware to apply it")
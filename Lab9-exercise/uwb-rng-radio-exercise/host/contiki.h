@@ -0,0 +1,135 @@
+/*
+ * Host shim of the Contiki API used by the ranging processes, for the
+ * DW1000 emulator (see dwt-emu.h): protothread processes, etimers, clock,
+ * energest and link-layer addresses, scheduled by the emulator in simulated
+ * time. Only what rng-*.c use, with the semantics of the Contiki kernel.
+ */
+#ifndef CONTIKI_H
+#define CONTIKI_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#ifdef PROJECT_CONF_H
+#include PROJECT_CONF_H
+#endif
+#include "core/net/linkaddr.h"
+/*---------------------------------------------------------------------------*/
+/* Node output goes to the emulator log, prefixed with the time and address */
+int emu_printf(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+#define printf emu_printf
+/*---------------------------------------------------------------------------*/
+typedef uint32_t clock_time_t;
+#define CLOCK_SECOND 1000
+clock_time_t clock_time(void);
+unsigned long clock_seconds(void);
+
+typedef uint32_t rtimer_clock_t;
+#define RTIMER_SECOND 32768
+rtimer_clock_t emu_rtimer_now(void);
+#define RTIMER_NOW() emu_rtimer_now()
+/*---------------------------------------------------------------------------*/
+/* Protothreads (sys/pt.h) with switch-based local continuations */
+struct pt {
+  unsigned short lc;
+};
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_EXITED  2
+#define PT_ENDED   3
+
+typedef unsigned char process_event_t;
+typedef void *process_data_t;
+
+struct process {
+  struct process *next;
+  const char *name;
+  char (*thread)(struct pt *, process_event_t, process_data_t);
+  struct pt pt;
+  unsigned char running, needspoll;
+};
+
+#define PROCESS_EVENT_NONE     0x80
+#define PROCESS_EVENT_INIT     0x81
+#define PROCESS_EVENT_POLL     0x82
+#define PROCESS_EVENT_EXIT     0x83
+#define PROCESS_EVENT_CONTINUE 0x85
+#define PROCESS_EVENT_TIMER    0x88
+
+#define PROCESS_THREAD(name, ev, data) \
+  static char process_thread_##name(struct pt *process_pt, process_event_t ev, process_data_t data)
+#define PROCESS_NAME(name) extern struct process name
+#define PROCESS(name, strname) \
+  PROCESS_THREAD(name, ev, data); \
+  struct process name = { NULL, strname, process_thread_##name, { 0 }, 0, 0 }
+
+#define PROCESS_BEGIN() { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch(process_pt->lc) { case 0:
+#define PROCESS_END() } PT_YIELD_FLAG = 0; process_pt->lc = 0; return PT_ENDED; }
+#define PROCESS_WAIT_EVENT_UNTIL(c) do { \
+    PT_YIELD_FLAG = 0; \
+    process_pt->lc = __LINE__; case __LINE__: \
+    if(PT_YIELD_FLAG == 0 || !(c)) { \
+      return PT_YIELDED; \
+    } \
+  } while(0)
+#define PROCESS_WAIT_EVENT() PROCESS_WAIT_EVENT_UNTIL(1)
+#define PROCESS_YIELD() PROCESS_WAIT_EVENT()
+#define PROCESS_YIELD_UNTIL(c) PROCESS_WAIT_EVENT_UNTIL(c)
+
+/* Child protothreads, run by the process that spawns them until they end */
+#define PT_THREAD(name_args) char name_args
+#define PT_INIT(pt) (pt)->lc = 0
+#define PT_BEGIN(pt) { char PT_YIELD_FLAG = 1; (void)PT_YIELD_FLAG; switch((pt)->lc) { case 0:
+#define PT_END(pt) } PT_YIELD_FLAG = 0; PT_INIT(pt); return PT_ENDED; }
+#define PT_WAIT_UNTIL(pt, c) do { \
+    (pt)->lc = __LINE__; case __LINE__: \
+    if(!(c)) { \
+      return PT_WAITING; \
+    } \
+  } while(0)
+#define PT_WAIT_WHILE(pt, c) PT_WAIT_UNTIL(pt, !(c))
+#define PT_EXIT(pt) do { PT_INIT(pt); return PT_EXITED; } while(0)
+#define PT_SCHEDULE(f) ((f) < PT_EXITED)
+#define PT_SPAWN(pt, child, thread) do { \
+    PT_INIT(child); \
+    PT_WAIT_WHILE(pt, PT_SCHEDULE(thread)); \
+  } while(0)
+#define PROCESS_PT_SPAWN(pt, thread) PT_SPAWN(process_pt, pt, thread)
+
+extern struct process *process_current;
+#define PROCESS_CURRENT() process_current
+void process_poll(struct process *p);
+
+/* Each linked copy of a node firmware registers its processes with the
+ * emulator, under the name of the file that starts them (e.g. "rng-init") */
+void emu_register(const char *file, struct process *const procs[]);
+#define AUTOSTART_PROCESSES(...) \
+  extern struct process *const autostart_processes[]; \
+  static void __attribute__((constructor)) emu_autostart(void) \
+  { \
+    emu_register(__FILE__, autostart_processes); \
+  } \
+  struct process *const autostart_processes[] = { __VA_ARGS__, NULL }
+/*---------------------------------------------------------------------------*/
+struct etimer {
+  clock_time_t start, interval;
+  struct process *p; // NULL once expired or stopped
+  struct etimer *next;
+};
+void etimer_set(struct etimer *et, clock_time_t interval);
+void etimer_reset(struct etimer *et);
+void etimer_restart(struct etimer *et);
+void etimer_stop(struct etimer *et);
+int etimer_expired(struct etimer *et);
+clock_time_t etimer_expiration_time(struct etimer *et);
+/*---------------------------------------------------------------------------*/
+/* Energest: CPU is the time spent running the node processes, see
+ * EMU_CPU_LATENCY in dwt-emu.h; LPM is the rest. In RTIMER_SECOND units. */
+#define ENERGEST_TYPE_CPU      0
+#define ENERGEST_TYPE_LPM      1
+#define ENERGEST_TYPE_TRANSMIT 2
+#define ENERGEST_TYPE_LISTEN   3
+unsigned long energest_type_time(int type);
+void energest_flush(void);
+/*---------------------------------------------------------------------------*/
+#endif /* CONTIKI_H */
@@ -0,0 +1,17 @@
+#ifndef LINKADDR_H_
+#define LINKADDR_H_
+/*---------------------------------------------------------------------------*/
+/* Host shim: 2-byte link-layer addresses, set per node by the emulator */
+#define LINKADDR_SIZE 2
+typedef union {
+  unsigned char u8[LINKADDR_SIZE];
+  unsigned short u16;
+} linkaddr_t;
+
+extern linkaddr_t linkaddr_node_addr;
+extern const linkaddr_t linkaddr_null;
+
+void linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from);
+int linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2);
+/*---------------------------------------------------------------------------*/
+#endif /* LINKADDR_H_ */
@@ -0,0 +1,118 @@
+#ifndef _DECA_DEVICE_API_H_
+#define _DECA_DEVICE_API_H_
+/*---------------------------------------------------------------------------*/
+/* Host shim of the DW1000 driver API (decadriver), implemented by the
+ * emulator in dwt-emu.c: the subset used by the ranging processes, with the
+ * driver signatures and constants */
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#define DWT_SUCCESS (0)
+#define DWT_ERROR   (-1)
+
+#define DWT_TIME_UNITS (1.0 / 499.2e6 / 128.0) // ~15.65e-12 s
+
+#define DWT_PRF_16M 1
+#define DWT_PRF_64M 2
+
+#define DWT_BR_110K 0
+#define DWT_BR_850K 1
+#define DWT_BR_6M8  2
+
+#define DWT_PLEN_4096 0x0C
+#define DWT_PLEN_2048 0x28
+#define DWT_PLEN_1536 0x18
+#define DWT_PLEN_1024 0x08
+#define DWT_PLEN_512  0x34
+#define DWT_PLEN_256  0x24
+#define DWT_PLEN_128  0x14
+#define DWT_PLEN_64   0x04
+
+#define DWT_PAC8  0
+#define DWT_PAC16 1
+#define DWT_PAC32 2
+#define DWT_PAC64 3
+
+#define DWT_PHRMODE_STD 0x0
+#define DWT_PHRMODE_EXT 0x3
+
+#define DWT_START_TX_IMMEDIATE 0
+#define DWT_START_TX_DELAYED   1
+#define DWT_RESPONSE_EXPECTED  2
+
+#define DWT_START_RX_IMMEDIATE 0
+#define DWT_START_RX_DELAYED   1
+
+#define DWT_FF_NOTYPE_EN 0x000
+
+#define DWT_INT_TFRS   0x00000080
+#define DWT_INT_LDED   0x00000400
+#define DWT_INT_RPHE   0x00001000
+#define DWT_INT_RFCG   0x00004000
+#define DWT_INT_RFCE   0x00008000
+#define DWT_INT_RFSL   0x00010000
+#define DWT_INT_RFTO   0x00020000
+#define DWT_INT_RXOVRR 0x00100000
+#define DWT_INT_RXPTO  0x00200000
+#define DWT_INT_SFDT   0x04000000
+#define DWT_INT_ARFE   0x20000000
+
+#define DWT_PRESRV_SLEEP 0x0100
+#define DWT_LOADOPSET    0x0080
+#define DWT_CONFIG       0x0040
+#define DWT_LOADUCODE    0x0800
+#define DWT_WAKE_CS      0x4
+#define DWT_SLP_EN       0x1
+/*---------------------------------------------------------------------------*/
+typedef struct {
+  uint32_t status;      // Initial value of the status register
+  uint16_t datalength;  // Length of the received frame, with the CRC
+  uint8_t fctrl[2];
+  uint8_t rx_flags;
+} dwt_cb_data_t;
+typedef void (*dwt_cb_t)(const dwt_cb_data_t *);
+
+typedef struct {
+  uint16_t maxNoise;
+  uint16_t firstPathAmp1;
+  uint16_t stdNoise;
+  uint16_t firstPathAmp2;
+  uint16_t firstPathAmp3;
+  uint16_t maxGrowthCIR;
+  uint16_t rxPreamCount;
+  uint16_t firstPath;
+} dwt_rxdiag_t;
+/*---------------------------------------------------------------------------*/
+#define dwt_write32bitreg(addr, value) dwt_write32bitoffsetreg(addr, 0, value)
+#define dwt_read32bitreg(addr) dwt_read32bitoffsetreg(addr, 0)
+void dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32_t regval);
+uint32_t dwt_read32bitoffsetreg(int regFileID, int regOffset);
+void dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8_t regval);
+
+void dwt_readtxtimestamp(uint8_t *timestamp);
+void dwt_readrxtimestamp(uint8_t *timestamp);
+uint32_t dwt_readsystimestamphi32(void);
+int32_t dwt_readcarrierintegrator(void);
+void dwt_readdiagnostics(dwt_rxdiag_t *diagnostics);
+
+void dwt_setrxantennadelay(uint16_t antennaDly);
+void dwt_settxantennadelay(uint16_t antennaDly);
+void dwt_enableframefilter(uint16_t bitmask);
+void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr);
+void dwt_setinterrupt(uint32_t bitmask, uint8_t enable);
+
+int dwt_writetxdata(uint16_t txFrameLength, uint8_t *txFrameBytes, uint16_t txBufferOffset);
+void dwt_writetxfctrl(uint16_t txFrameLength, uint16_t txBufferOffset, int ranging);
+void dwt_setdelayedtrxtime(uint32_t starttime);
+void dwt_setrxaftertxdelay(uint32_t rxDelayTime);
+void dwt_setrxtimeout(uint16_t time);
+int dwt_starttx(uint8_t mode);
+int dwt_rxenable(int mode);
+void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset);
+void dwt_forcetrxoff(void);
+void dwt_rxreset(void);
+
+void dwt_configuresleep(uint16_t mode, uint8_t wake);
+void dwt_entersleep(void);
+int dwt_spicswakeup(uint8_t *buff, uint16_t length);
+/*---------------------------------------------------------------------------*/
+#endif /* _DECA_DEVICE_API_H_ */
@@ -0,0 +1,29 @@
+#ifndef _DECA_REGS_H_
+#define _DECA_REGS_H_
+/*---------------------------------------------------------------------------*/
+/* Host shim of the DW1000 registers emulated by dwt-emu.c */
+#define SYS_STATUS_ID        0x0F
+#define SYS_STATUS_TXFRS     0x00000080UL  // Transmit frame sent
+#define SYS_STATUS_RXPHE     0x00001000UL  // Receiver PHY header error
+#define SYS_STATUS_RXFCG     0x00004000UL  // Receiver FCS good
+#define SYS_STATUS_RXFCE     0x00008000UL  // Receiver FCS error
+#define SYS_STATUS_RXRFSL    0x00010000UL  // Receiver Reed Solomon frame sync loss
+#define SYS_STATUS_RXRFTO    0x00020000UL  // Receive frame wait timeout
+#define SYS_STATUS_LDEERR    0x00040000UL  // Leading edge detection error
+#define SYS_STATUS_RXPTO     0x00200000UL  // Preamble detection timeout
+#define SYS_STATUS_RXSFDTO   0x04000000UL  // Receive SFD timeout
+#define SYS_STATUS_AFFREJ    0x20000000UL  // Automatic frame filtering rejection
+#define SYS_STATUS_ALL_RX_TO (SYS_STATUS_RXRFTO | SYS_STATUS_RXPTO)
+#define SYS_STATUS_ALL_RX_ERR (SYS_STATUS_RXPHE | SYS_STATUS_RXFCE | SYS_STATUS_RXRFSL | SYS_STATUS_RXSFDTO | \
+                               SYS_STATUS_AFFREJ | SYS_STATUS_LDEERR)
+#define SYS_STATUS_ALL_RX_GOOD SYS_STATUS_RXFCG
+#define SYS_STATUS_ALL_TX    SYS_STATUS_TXFRS
+
+#define RX_FINFO_ID          0x10
+#define RX_FINFO_RXFL_MASK_1023 0x000003FFUL
+
+#define PMSC_ID              0x36
+#define PMSC_CTRL0_OFFSET    0x00
+#define PMSC_CTRL0_TXCLKS_125M 0x20
+/*---------------------------------------------------------------------------*/
+#endif /* _DECA_REGS_H_ */
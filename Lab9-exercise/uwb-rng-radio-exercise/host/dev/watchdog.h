@@ -0,0 +1,6 @@
+#ifndef WATCHDOG_H_
+#define WATCHDOG_H_
+/* Host shim: only called from busy-wait loops, which the emulator cannot
+ * run (APP_RADIO_IRQ 0), it aborts the simulation */
+void watchdog_periodic(void);
+#endif /* WATCHDOG_H_ */
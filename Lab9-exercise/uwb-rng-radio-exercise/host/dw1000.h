@@ -0,0 +1,13 @@
+#ifndef DW1000_H_
+#define DW1000_H_
+/*---------------------------------------------------------------------------*/
+/* Host shim of the Contiki DW1000 driver header */
+#include "contiki.h"
+#include "deca_device_api.h"
+#include "deca_regs.h"
+/*---------------------------------------------------------------------------*/
+#ifndef IEEE802154_PANID
+#define IEEE802154_PANID 0xABCD
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* DW1000_H_ */
@@ -0,0 +1,1012 @@
+/*
+ * DW1000 and UWB channel emulator, with the Contiki shims of this directory
+ * (see dwt-emu.h)
+ */
+#include "dw1000.h"
+#include "lib/random.h"
+#include "dev/watchdog.h"
+#include "rng-support.h"
+#include "dwt-emu.h"
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#undef printf // Redirected to emu_printf() for the firmware only
+/*---------------------------------------------------------------------------*/
+#if !APP_RADIO_IRQ
+#error The emulator needs APP_RADIO_IRQ: a busy-waiting node never lets the others run
+#endif
+/*---------------------------------------------------------------------------*/
+/* PHY timing, from the radio configuration of project-conf.h */
+#if DW1000_CONF_PRF == DWT_PRF_64M
+#define SYMBOL_US (1.01763)  // Preamble symbol
+#define RX_POWER_A (121.74)  // Received power correction, see read_rx_diag()
+#else
+#define SYMBOL_US (0.99359)
+#define RX_POWER_A (113.77)
+#endif
+#if DW1000_CONF_DATA_RATE == DWT_BR_110K
+#define BIT_US (8.2051)
+#define PHR_BIT_US (8.2051)
+#define SFD_SYMBOLS (64)
+#else
+#define BIT_US (DW1000_CONF_DATA_RATE == DWT_BR_850K ? 1.0256 : 0.12821)
+#define PHR_BIT_US (1.0256)  // The PHR is sent at 850 kbps at 6.8 Mbps
+#define SFD_SYMBOLS (8)
+#endif
+#if DW1000_CONF_CHANNEL == 1
+#define CARRIER_MHZ (3494.4)
+#elif DW1000_CONF_CHANNEL == 3
+#define CARRIER_MHZ (4492.8)
+#elif DW1000_CONF_CHANNEL == 5 || DW1000_CONF_CHANNEL == 7
+#define CARRIER_MHZ (6489.6)
+#else
+#define CARRIER_MHZ (3993.6)
+#endif
+#define TX_STARTUP_US (10)   // Immediate TX, from the command to the preamble
+#define RX_DETECT_US (32)    // Preamble the receiver must hear before the SFD to acquire a frame
+#define TX_DBM (-14.3)       // Transmit power, -41.3 dBm/MHz over 500 MHz
+#define FP_LOSS_DB (1.0)     // First path below the total received power (LOS)
+#define CIR_NOISE (50)       // Standard deviation of the CIR noise, accumulator units
+#define CI_NOISE_PPM (0.02)  // Error of the carrier integrator
+#define TS_MASK (DWT_VALUES - 1)
+/*---------------------------------------------------------------------------*/
+#define MAX_ROLES (4 * EMU_MAX_NODES)
+#define MAX_FRAMES 32        // Frames kept for the collision checks
+#define MAX_EVENTS 256
+
+enum { RADIO_IDLE, RADIO_TX, RADIO_RX, RADIO_SLEEP };
+enum { EV_BOOT, EV_TX_END, EV_FRAME_END, EV_RX_TIMEOUT };
+
+struct role {
+  const char *file;
+  struct process *const *procs;
+  uint8_t used;
+};
+
+struct node {
+  struct process *const *procs;
+  linkaddr_t addr;
+  double x, y;
+  double drift;            // Clock offset, fraction
+  uint64_t phase;          // Radio clock at time 0
+  double ant_err;          // True antenna delay minus ANTENNA_DELAY, in DWT_TIME_UNITS
+  uint64_t boot;
+  uint64_t now;            // Time seen by the current run of the processes
+  uint64_t busy;           // End of the last run
+  uint64_t cpu;            // Time spent running
+  struct etimer *timers;
+  /* Radio */
+  uint8_t state;
+  uint32_t session;        // Incremented at each change of the radio state
+  uint32_t status;
+  uint32_t int_mask;
+  dwt_cb_t cb_tx_done, cb_rx_ok, cb_rx_to, cb_rx_err;
+  uint16_t tx_ant, rx_ant; // Configured antenna delays
+  uint32_t dx_time;
+  uint16_t rx_timeout;
+  uint8_t rx_after_tx;     // Receiver on at the end of the transmission
+  uint32_t tx_frame;       // Frame being transmitted
+  uint64_t rx_since;       // Receiver on since
+  uint8_t tx_buf[128];
+  uint16_t tx_len;
+  uint8_t rx_buf[128];
+  uint16_t rx_len;         // With the CRC
+  uint64_t tx_ts, rx_ts;
+  int32_t rx_ci;
+  dwt_rxdiag_t rx_diag;
+  /* Output */
+  char line[256];
+  int line_len;
+};
+
+struct frame {
+  uint32_t id;             // 0 for none or cancelled
+  int sender;
+  uint64_t start, rmarker, end; // At the sender antenna
+  uint8_t cut;             // Transmission aborted
+  uint8_t data[128];
+  uint16_t len;            // Without the CRC
+};
+
+struct event {
+  uint64_t time;
+  uint8_t type;
+  uint8_t node;
+  uint32_t arg;            // Radio session or frame id
+};
+/*---------------------------------------------------------------------------*/
+static emu_channel_t channel;
+static emu_log_t log_line;
+static emu_stats_t stats;
+static struct role roles[MAX_ROLES];
+static int num_roles;
+static struct node nodes[EMU_MAX_NODES];
+static int num_nodes;
+static struct frame frames[MAX_FRAMES];
+static uint32_t last_frame_id;
+static struct event events[MAX_EVENTS];
+static int num_events;
+static uint64_t now;
+static struct node *cur; // Node whose code is running, NULL for the emulator
+
+linkaddr_t linkaddr_node_addr;
+const linkaddr_t linkaddr_null = { { 0, 0 } };
+struct process *process_current;
+/*---------------------------------------------------------------------------*/
+static double
+gauss(double std)
+{
+  double u1 = (rand() + 1.0) / (RAND_MAX + 2.0), u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+  return std * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+us_to_dtu(double us)
+{
+  return (uint64_t)llround(us * EMU_SECOND / 1e6);
+}
+/*---------------------------------------------------------------------------*/
+static uint16_t
+preamble_symbols(void)
+{
+  switch(DW1000_CONF_PLEN) {
+  case DWT_PLEN_64: return 64;
+  case DWT_PLEN_256: return 256;
+  case DWT_PLEN_512: return 512;
+  case DWT_PLEN_1024: return 1024;
+  case DWT_PLEN_1536: return 1536;
+  case DWT_PLEN_2048: return 2048;
+  case DWT_PLEN_4096: return 4096;
+  default: return 128;
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* From the start of the preamble to the RMARKER (start of the PHR) */
+static uint64_t
+frame_lead(void)
+{
+  return us_to_dtu((preamble_symbols() + SFD_SYMBOLS) * SYMBOL_US);
+}
+/*---------------------------------------------------------------------------*/
+/* From the RMARKER to the end of the frame: PHR, then data with the
+ * Reed-Solomon parity (48 bits per block of up to 330 bits) */
+static uint64_t
+frame_tail(uint16_t len)
+{
+  uint32_t bits = len * 8;
+
+  return us_to_dtu(21 * PHR_BIT_US + (bits + (bits + 329) / 330 * 48) * BIT_US);
+}
+/*---------------------------------------------------------------------------*/
+double
+emu_distance(int a, int b)
+{
+  return hypot(nodes[a].x - nodes[b].x, nodes[a].y - nodes[b].y);
+}
+/*---------------------------------------------------------------------------*/
+static double
+tof(int a, int b)
+{
+  return emu_distance(a, b) / SPEED_OF_LIGHT * EMU_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+static int
+in_range(int a, int b)
+{
+  return channel.range_m <= 0 || emu_distance(a, b) <= channel.range_m;
+}
+/*---------------------------------------------------------------------------*/
+/* Radio clock of node n at time t */
+static uint64_t
+radio_time(const struct node *n, uint64_t t)
+{
+  return (n->phase + t + (int64_t)llround((double)t * n->drift)) & TS_MASK;
+}
+/*---------------------------------------------------------------------------*/
+/* Time at which the radio clock of n has advanced by ticks from time t */
+static uint64_t
+after_ticks(const struct node *n, uint64_t t, double ticks)
+{
+  return t + (uint64_t)llround(ticks / (1 + n->drift));
+}
+/*---------------------------------------------------------------------------*/
+static void
+push_event(uint64_t time, uint8_t type, int node, uint32_t arg)
+{
+  if(num_events == MAX_EVENTS) {
+    fprintf(stderr, "dwt-emu: event queue full\n");
+    exit(1);
+  }
+  events[num_events].time = time;
+  events[num_events].type = type;
+  events[num_events].node = node;
+  events[num_events].arg = arg;
+  num_events++;
+}
+/*---------------------------------------------------------------------------*/
+static void
+select_node(struct node *n)
+{
+  cur = n;
+  linkaddr_node_addr = n->addr;
+}
+/*---------------------------------------------------------------------------*/
+static void
+call_process(struct process *p, process_event_t ev, process_data_t data)
+{
+  char ret;
+
+  if(p == NULL || !p->running) {
+    return;
+  }
+  process_current = p;
+  ret = p->thread(&p->pt, ev, data);
+  if(ret == PT_EXITED || ret == PT_ENDED) {
+    p->running = 0;
+  }
+  process_current = NULL;
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+etimer_due(const struct node *n, const struct etimer *et)
+{
+  uint64_t ticks = (uint64_t)et->start + et->interval;
+
+  return n->boot + (ticks * EMU_SECOND + CLOCK_SECOND - 1) / CLOCK_SECOND;
+}
+/*---------------------------------------------------------------------------*/
+/* Run the processes of node n after an event at time t, until they all wait:
+ * they see the time of the event plus the reaction time of the firmware */
+static void
+run_node(struct node *n, uint64_t t, uint8_t boot)
+{
+  struct process *const *p;
+  struct etimer *et, **prev;
+  struct process *to;
+  int again;
+
+  select_node(n);
+  n->now = (t > n->busy ? t : n->busy) + EMU_US(channel.latency_us);
+  if(boot) {
+    for(p = n->procs; *p; p++) {
+      (*p)->running = 1;
+      (*p)->pt.lc = 0;
+      call_process(*p, PROCESS_EVENT_INIT, NULL);
+    }
+  }
+  do {
+    again = 0;
+    for(p = n->procs; *p; p++) {
+      if((*p)->needspoll) {
+        (*p)->needspoll = 0;
+        call_process(*p, PROCESS_EVENT_POLL, NULL);
+        again = 1;
+      }
+    }
+    for(prev = &n->timers; (et = *prev) != NULL; prev = &et->next) {
+      if(etimer_due(n, et) <= n->now) {
+        /* As the etimer process: expired before the event is delivered */
+        *prev = et->next;
+        to = et->p;
+        et->p = NULL;
+        call_process(to, PROCESS_EVENT_TIMER, et);
+        again = 1;
+        break; // The list may have changed
+      }
+    }
+  } while(again);
+  n->busy = n->now;
+  n->cpu += EMU_US(channel.latency_us);
+  cur = NULL;
+}
+/*---------------------------------------------------------------------------*/
+/* Radio event of node n at time t: set the status flags and, if the
+ * interrupt is enabled, call the driver callback as dwt_isr() does */
+static void
+radio_irq(struct node *n, uint64_t t, uint32_t flags, dwt_cb_t cb)
+{
+  dwt_cb_data_t cb_data;
+
+  select_node(n);
+  n->now = t;
+  n->status |= flags;
+  if(cb != NULL && (n->int_mask & flags)) {
+    cb_data.status = n->status;
+    cb_data.datalength = (flags & SYS_STATUS_RXFCG) ? n->rx_len : 0;
+    cb_data.fctrl[0] = n->rx_buf[0];
+    cb_data.fctrl[1] = n->rx_buf[1];
+    cb_data.rx_flags = 0;
+    n->status &= ~flags;
+    cb(&cb_data);
+  }
+  run_node(n, t, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_on(struct node *n, uint64_t t)
+{
+  n->state = RADIO_RX;
+  n->session++;
+  n->rx_since = t;
+  if(n->rx_timeout) {
+    push_event(after_ticks(n, t, (double)n->rx_timeout * UUS_TO_DWT_TIME), EV_RX_TIMEOUT, n - nodes, n->session);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+radio_off(struct node *n)
+{
+  struct frame *f = &frames[n->tx_frame % MAX_FRAMES];
+
+  if(n->state == RADIO_TX && f->id == n->tx_frame) {
+    if(n->now < f->start) {
+      f->id = 0; // Not on the air yet
+    }
+    else if(n->now < f->end) {
+      f->cut = 1;
+    }
+  }
+  if(n->state != RADIO_SLEEP) {
+    n->state = RADIO_IDLE;
+  }
+  n->session++;
+}
+/*---------------------------------------------------------------------------*/
+static int
+collided(const struct frame *f, int r)
+{
+  double tf = tof(f->sender, r), tg;
+  const struct frame *g;
+  int i;
+
+  for(i = 0; i < MAX_FRAMES; i++) {
+    g = &frames[i];
+    if(g == f || g->id == 0 || g->sender == r || !in_range(g->sender, r)) {
+      continue;
+    }
+    tg = tof(g->sender, r);
+    if(g->start + tg < f->end + tf && f->start + tf < g->end + tg) {
+      return 1;
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/* Channel diagnostics of a LOS frame received from dist_m away: free space
+ * path loss, then the register values that give these powers back with the
+ * formulas of the user manual (4.7) */
+static void
+rx_diagnostics(dwt_rxdiag_t *d, double dist_m)
+{
+  double fspl = 20 * log10(dist_m < 0.1 ? 0.1 : dist_m) + 20 * log10(CARRIER_MHZ * 1e6) - 147.55;
+  double rx_dbm = TX_DBM - fspl, n = preamble_symbols();
+  double cir = pow(10, (rx_dbm + RX_POWER_A) / 10) * n * n / 131072;
+  double fp = sqrt(pow(10, (rx_dbm - FP_LOSS_DB + RX_POWER_A) / 10) * n * n / 3);
+
+  memset(d, 0, sizeof(*d));
+  d->stdNoise = CIR_NOISE;
+  d->maxNoise = 4 * CIR_NOISE;
+  d->firstPathAmp1 = d->firstPathAmp2 = d->firstPathAmp3 = fp > 65535 ? 65535 : (uint16_t)fp;
+  d->maxGrowthCIR = cir > 65535 ? 65535 : (uint16_t)cir;
+  d->rxPreamCount = preamble_symbols();
+  d->firstPath = 750 << 6;
+}
+/*---------------------------------------------------------------------------*/
+static void
+frame_end(struct node *r, uint64_t t, uint32_t id)
+{
+  struct frame *f = &frames[id % MAX_FRAMES];
+  int ri = r - nodes;
+  const struct node *s;
+  double rmarker, ts;
+
+  if(f->id != id || r->state != RADIO_RX) {
+    return;
+  }
+  s = &nodes[f->sender];
+  rmarker = f->rmarker + tof(f->sender, ri);
+  if(r->rx_since + EMU_US(RX_DETECT_US) > rmarker) {
+    return; // Receiver turned on too late to acquire this frame
+  }
+
+  r->state = RADIO_IDLE;
+  r->session++;
+  if(f->cut || collided(f, ri)) {
+    stats.collisions += !f->cut;
+    radio_irq(r, t, SYS_STATUS_RXFCE, r->cb_rx_err);
+    return;
+  }
+
+  memcpy(r->rx_buf, f->data, f->len);
+  r->rx_len = f->len + CRC_LEN;
+
+  /* The RMARKER reaches the digital part after the true antenna delay, the
+   * timestamp is corrected by the configured one */
+  ts = (double)radio_time(r, (uint64_t)rmarker) + (rmarker - floor(rmarker))
+       + ANTENNA_DELAY + r->ant_err - r->rx_ant + gauss(channel.noise_mm / 1000 / SPEED_OF_LIGHT * EMU_SECOND);
+  r->rx_ts = (uint64_t)llround(ts + DWT_VALUES) & TS_MASK;
+
+  /* Sender clock offset seen from the receiver, the opposite of what
+   * get_clock_offset() returns, scaled to the carrier frequency */
+  r->rx_ci = (int32_t)lround(-((s->drift - r->drift) + gauss(CI_NOISE_PPM * 1e-6))
+                             * (1 << 30) * CARRIER_MHZ / 3993.6);
+  rx_diagnostics(&r->rx_diag, emu_distance(f->sender, ri));
+  stats.received++;
+  radio_irq(r, t, SYS_STATUS_RXFCG, r->cb_rx_ok);
+}
+/*---------------------------------------------------------------------------*/
+void
+emu_register(const char *file, struct process *const procs[])
+{
+  if(num_roles < MAX_ROLES) {
+    roles[num_roles].file = file;
+    roles[num_roles].procs = procs;
+    num_roles++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+emu_init(const emu_channel_t *ch, unsigned int seed, emu_log_t log)
+{
+  channel = *ch;
+  log_line = log;
+  srand(seed);
+}
+/*---------------------------------------------------------------------------*/
+int
+emu_add_node(const char *role, const linkaddr_t *addr, double x, double y)
+{
+  struct node *n = &nodes[num_nodes];
+  const char *name;
+  int i;
+
+  if(num_nodes == EMU_MAX_NODES) {
+    return -1;
+  }
+  for(i = 0; i < num_roles; i++) {
+    name = strrchr(roles[i].file, '/') ? strrchr(roles[i].file, '/') + 1 : roles[i].file;
+    if(!roles[i].used && strncmp(name, role, strlen(role)) == 0 && strcmp(name + strlen(role), ".c") == 0) {
+      break;
+    }
+  }
+  if(i == num_roles) {
+    return -1;
+  }
+  roles[i].used = 1;
+
+  memset(n, 0, sizeof(*n));
+  n->procs = roles[i].procs;
+  n->addr = *addr;
+  n->x = x;
+  n->y = y;
+  n->drift = (2.0 * rand() / RAND_MAX - 1) * channel.drift_ppm * 1e-6;
+  n->phase = (((uint64_t)rand() << 31) ^ (uint64_t)rand()) & TS_MASK;
+  n->ant_err = gauss(channel.ant_err_dtu);
+  n->boot = EMU_US(rand() % 100000);
+  n->tx_ant = n->rx_ant = ANTENNA_DELAY;
+  push_event(n->boot, EV_BOOT, num_nodes, 0);
+  return num_nodes++;
+}
+/*---------------------------------------------------------------------------*/
+void
+emu_run(uint64_t until)
+{
+  struct etimer *et;
+  struct node *n;
+  uint64_t t;
+  int i, next, timer_node;
+
+  while(1) {
+    /* Earliest radio event or etimer */
+    next = -1;
+    t = UINT64_MAX;
+    for(i = 0; i < num_events; i++) {
+      if(events[i].time < t) {
+        t = events[i].time;
+        next = i;
+      }
+    }
+    timer_node = -1;
+    for(i = 0; i < num_nodes; i++) {
+      for(et = nodes[i].timers; et != NULL; et = et->next) {
+        if(etimer_due(&nodes[i], et) < t) {
+          t = etimer_due(&nodes[i], et);
+          timer_node = i;
+        }
+      }
+    }
+    if(t > until) {
+      now = until;
+      return;
+    }
+    now = t;
+
+    if(timer_node >= 0) {
+      run_node(&nodes[timer_node], t, 0);
+      continue;
+    }
+    struct event e = events[next];
+    events[next] = events[--num_events];
+    n = &nodes[e.node];
+    switch(e.type) {
+    case EV_BOOT:
+      run_node(n, t, 1);
+      break;
+    case EV_TX_END:
+      if(n->session == e.arg) {
+        n->state = RADIO_IDLE;
+        n->session++;
+        if(n->rx_after_tx) {
+          rx_on(n, t);
+        }
+        radio_irq(n, t, SYS_STATUS_TXFRS, n->cb_tx_done);
+      }
+      break;
+    case EV_FRAME_END:
+      frame_end(n, t, e.arg);
+      break;
+    case EV_RX_TIMEOUT:
+      if(n->session == e.arg && n->state == RADIO_RX) {
+        n->state = RADIO_IDLE;
+        n->session++;
+        stats.rx_timeouts++;
+        radio_irq(n, t, SYS_STATUS_RXRFTO, n->cb_rx_to);
+      }
+      break;
+    }
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint64_t
+emu_time(void)
+{
+  return now;
+}
+/*---------------------------------------------------------------------------*/
+const emu_stats_t *
+emu_stats(void)
+{
+  return &stats;
+}
+/*---------------------------------------------------------------------------*/
+double
+emu_drift_ppm(int node)
+{
+  return nodes[node].drift * 1e6;
+}
+/*---------------------------------------------------------------------------*/
+double
+emu_antenna_error(int node)
+{
+  return nodes[node].ant_err;
+}
+/*---------------------------------------------------------------------------*/
+/* DW1000 driver API, on the radio of the running node */
+/*---------------------------------------------------------------------------*/
+void
+dwt_write32bitoffsetreg(int regFileID, int regOffset, uint32_t regval)
+{
+  if(regFileID == SYS_STATUS_ID && regOffset == 0) {
+    cur->status &= ~regval; // Write 1 to clear
+  }
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+dwt_read32bitoffsetreg(int regFileID, int regOffset)
+{
+  if(regOffset != 0) {
+    return 0;
+  }
+  switch(regFileID) {
+  case SYS_STATUS_ID:
+    return cur->status;
+  case RX_FINFO_ID:
+    return cur->rx_len;
+  default:
+    return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_write8bitoffsetreg(int regFileID, int regOffset, uint8_t regval)
+{
+}
+/*---------------------------------------------------------------------------*/
+static void
+write_ts(uint8_t *buf, uint64_t ts)
+{
+  int i;
+
+  for(i = 0; i < 5; i++) {
+    buf[i] = (ts >> (8 * i)) & 0xFF;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_readtxtimestamp(uint8_t *timestamp)
+{
+  write_ts(timestamp, cur->tx_ts);
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_readrxtimestamp(uint8_t *timestamp)
+{
+  write_ts(timestamp, cur->rx_ts);
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+dwt_readsystimestamphi32(void)
+{
+  return (uint32_t)(radio_time(cur, cur->now) >> 8);
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+dwt_readcarrierintegrator(void)
+{
+  return cur->rx_ci;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_readdiagnostics(dwt_rxdiag_t *diagnostics)
+{
+  *diagnostics = cur->rx_diag;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setrxantennadelay(uint16_t antennaDly)
+{
+  cur->rx_ant = antennaDly;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_settxantennadelay(uint16_t antennaDly)
+{
+  cur->tx_ant = antennaDly;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_enableframefilter(uint16_t bitmask)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr)
+{
+  cur->cb_tx_done = cbTxDone;
+  cur->cb_rx_ok = cbRxOk;
+  cur->cb_rx_to = cbRxTo;
+  cur->cb_rx_err = cbRxErr;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setinterrupt(uint32_t bitmask, uint8_t enable)
+{
+  if(enable) {
+    cur->int_mask |= bitmask;
+  }
+  else {
+    cur->int_mask &= ~bitmask;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+dwt_writetxdata(uint16_t txFrameLength, uint8_t *txFrameBytes, uint16_t txBufferOffset)
+{
+  if(txFrameLength < CRC_LEN || txBufferOffset + txFrameLength > 127) {
+    return DWT_ERROR;
+  }
+  memcpy(&cur->tx_buf[txBufferOffset], txFrameBytes, txFrameLength - CRC_LEN);
+  return DWT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_writetxfctrl(uint16_t txFrameLength, uint16_t txBufferOffset, int ranging)
+{
+  cur->tx_len = txFrameLength - CRC_LEN;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setdelayedtrxtime(uint32_t starttime)
+{
+  cur->dx_time = starttime;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setrxaftertxdelay(uint32_t rxDelayTime)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_setrxtimeout(uint16_t time)
+{
+  cur->rx_timeout = time;
+}
+/*---------------------------------------------------------------------------*/
+int
+dwt_starttx(uint8_t mode)
+{
+  struct node *n = cur;
+  uint64_t rmarker, lead = frame_lead(), start;
+  struct frame *f;
+  int i;
+
+  if(n->state == RADIO_SLEEP) {
+    return DWT_ERROR;
+  }
+  if(mode & DWT_START_TX_DELAYED) {
+    /* The RMARKER leaves at the programmed time (low 9 bits ignored), the
+     * preamble must start after now: otherwise the chip flags HPDWARN */
+    rmarker = ((uint64_t)(n->dx_time & 0xFFFFFFFEUL)) << 8;
+    start = (rmarker - lead - radio_time(n, n->now)) & TS_MASK;
+    if(start >= DWT_VALUES / 2) {
+      stats.late_tx++;
+      return DWT_ERROR;
+    }
+    n->tx_ts = (rmarker + n->tx_ant) & TS_MASK;
+    rmarker = after_ticks(n, n->now, (double)start + lead);
+  }
+  else {
+    rmarker = n->now + EMU_US(TX_STARTUP_US) + lead;
+    n->tx_ts = (radio_time(n, rmarker) + n->tx_ant) & TS_MASK;
+  }
+
+  radio_off(n);
+  f = &frames[++last_frame_id % MAX_FRAMES];
+  memset(f, 0, sizeof(*f));
+  f->id = last_frame_id;
+  f->sender = n - nodes;
+  f->rmarker = rmarker + (uint64_t)llround(ANTENNA_DELAY + n->ant_err); // At the antenna
+  f->start = f->rmarker - lead;
+  f->end = f->rmarker + frame_tail(n->tx_len);
+  memcpy(f->data, n->tx_buf, n->tx_len);
+  f->len = n->tx_len;
+  stats.frames++;
+
+  n->state = RADIO_TX;
+  n->tx_frame = f->id;
+  n->rx_after_tx = (mode & DWT_RESPONSE_EXPECTED) != 0;
+  push_event(f->end, EV_TX_END, f->sender, n->session);
+  for(i = 0; i < num_nodes; i++) {
+    if(i != f->sender && in_range(f->sender, i)) {
+      push_event(f->end + (uint64_t)llround(tof(f->sender, i)), EV_FRAME_END, i, f->id);
+    }
+  }
+  return DWT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
+int
+dwt_rxenable(int mode)
+{
+  if(cur->state == RADIO_SLEEP) {
+    return DWT_ERROR;
+  }
+  radio_off(cur);
+  rx_on(cur, cur->now);
+  return DWT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
+{
+  if(rxBufferOffset + length <= sizeof(cur->rx_buf)) {
+    memcpy(buffer, &cur->rx_buf[rxBufferOffset], length);
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_forcetrxoff(void)
+{
+  radio_off(cur);
+  cur->status &= ~(SYS_STATUS_ALL_TX | SYS_STATUS_ALL_RX_GOOD | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR);
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_rxreset(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_configuresleep(uint16_t mode, uint8_t wake)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+dwt_entersleep(void)
+{
+  radio_off(cur);
+  cur->state = RADIO_SLEEP;
+  /* Lost in deep sleep, radio_wakeup() must restore them */
+  cur->int_mask = 0;
+  cur->tx_ant = cur->rx_ant = 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+dwt_spicswakeup(uint8_t *buff, uint16_t length)
+{
+  if(cur->state == RADIO_SLEEP) {
+    cur->state = RADIO_IDLE;
+    cur->session++;
+  }
+  return DWT_SUCCESS;
+}
+/*---------------------------------------------------------------------------*/
+/* Contiki shims, for the running node */
+/*---------------------------------------------------------------------------*/
+clock_time_t
+clock_time(void)
+{
+  return (clock_time_t)((cur->now - cur->boot) * CLOCK_SECOND / EMU_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+clock_seconds(void)
+{
+  return (unsigned long)((cur->now - cur->boot) / EMU_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+rtimer_clock_t
+emu_rtimer_now(void)
+{
+  return (rtimer_clock_t)((cur->now - cur->boot) * RTIMER_SECOND / EMU_SECOND);
+}
+/*---------------------------------------------------------------------------*/
+unsigned long
+energest_type_time(int type)
+{
+  switch(type) {
+  case ENERGEST_TYPE_CPU:
+    return (unsigned long)(cur->cpu * RTIMER_SECOND / EMU_SECOND);
+  case ENERGEST_TYPE_LPM:
+    return (unsigned long)((cur->now - cur->boot - cur->cpu) * RTIMER_SECOND / EMU_SECOND);
+  default:
+    return 0;
+  }
+}
+/*---------------------------------------------------------------------------*/
+void
+energest_flush(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+void
+process_poll(struct process *p)
+{
+  if(p != NULL) {
+    p->needspoll = 1;
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+etimer_add(struct etimer *et)
+{
+  etimer_stop(et);
+  et->p = process_current;
+  et->next = cur->timers;
+  cur->timers = et;
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_set(struct etimer *et, clock_time_t interval)
+{
+  et->start = clock_time();
+  et->interval = interval;
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_reset(struct etimer *et)
+{
+  et->start += et->interval;
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_restart(struct etimer *et)
+{
+  et->start = clock_time();
+  etimer_add(et);
+}
+/*---------------------------------------------------------------------------*/
+void
+etimer_stop(struct etimer *et)
+{
+  struct etimer **prev;
+
+  for(prev = &cur->timers; *prev != NULL; prev = &(*prev)->next) {
+    if(*prev == et) {
+      *prev = et->next;
+      break;
+    }
+  }
+  et->p = NULL;
+}
+/*---------------------------------------------------------------------------*/
+int
+etimer_expired(struct etimer *et)
+{
+  return et->p == NULL;
+}
+/*---------------------------------------------------------------------------*/
+clock_time_t
+etimer_expiration_time(struct etimer *et)
+{
+  return et->start + et->interval;
+}
+/*---------------------------------------------------------------------------*/
+void
+linkaddr_copy(linkaddr_t *dest, const linkaddr_t *from)
+{
+  *dest = *from;
+}
+/*---------------------------------------------------------------------------*/
+int
+linkaddr_cmp(const linkaddr_t *addr1, const linkaddr_t *addr2)
+{
+  return addr1->u8[0] == addr2->u8[0] && addr1->u8[1] == addr2->u8[1];
+}
+/*---------------------------------------------------------------------------*/
+unsigned short
+random_rand(void)
+{
+  return rand() & 0xFFFF;
+}
+/*---------------------------------------------------------------------------*/
+void
+watchdog_periodic(void)
+{
+  fprintf(stderr, "dwt-emu: busy wait on node %02x:%02x, not supported\n",
+          cur->addr.u8[0], cur->addr.u8[1]);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+/* Host cycle counter (rng-support.c has the Cortex-M3 one): 72 MHz cycles of
+ * the host time, only meaningful to compare computations with each other */
+void
+cycle_counter_init(void)
+{
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+cycle_counter_read(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec) * 72 / 1000);
+}
+/*---------------------------------------------------------------------------*/
+int
+emu_printf(const char *fmt, ...)
+{
+  va_list ap;
+  char *nl;
+  int len;
+
+  va_start(ap, fmt);
+  if(cur == NULL) {
+    len = vprintf(fmt, ap);
+    va_end(ap);
+    return len;
+  }
+  len = vsnprintf(&cur->line[cur->line_len], sizeof(cur->line) - cur->line_len, fmt, ap);
+  va_end(ap);
+  cur->line_len += len;
+  if(cur->line_len >= (int)sizeof(cur->line)) {
+    cur->line_len = sizeof(cur->line) - 1;
+  }
+
+  /* One log entry per complete line */
+  while((nl = memchr(cur->line, '\n', cur->line_len)) != NULL) {
+    *nl = '\0';
+    if(log_line) {
+      log_line(cur - nodes, cur->now, cur->line);
+    }
+    cur->line_len -= nl + 1 - cur->line;
+    memmove(cur->line, nl + 1, cur->line_len);
+  }
+  return len;
+}
+/*---------------------------------------------------------------------------*/
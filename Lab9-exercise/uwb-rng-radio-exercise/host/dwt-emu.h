@@ -0,0 +1,71 @@
+#ifndef DWT_EMU_H
+#define DWT_EMU_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include "core/net/linkaddr.h"
+/*---------------------------------------------------------------------------*/
+/****** Host emulator of the DW1000 and of the UWB channel ******/
+
+/* The ranging firmware (rng-init.c, rng-resp.c, rng-coord.c with their
+ * rng-*.c modules) is built for the host against the shims of this
+ * directory and linked once per emulated node, each copy with its own
+ * state (see rng-emu-host in the Makefile). The emulator schedules the
+ * node processes in simulated time and implements the dwt_* calls on top
+ * of a channel model:
+ * - time of flight from the distance between the nodes;
+ * - a 40-bit radio clock per node, with a random phase and a constant
+ *   offset (drift) uniform within +-drift_ppm, seen by the receivers'
+ *   carrier integrator;
+ * - true antenna delays off ANTENNA_DELAY by a gaussian error;
+ * - gaussian noise on the RX timestamps;
+ * - frame airtime from the preamble length and data rate of project-conf.h,
+ *   overlapping frames at a receiver are both lost (RX error);
+ * - late delayed transmissions fail as on the chip (start_tx() returns 0);
+ * - a constant firmware reaction time to each radio or timer event.
+ * Only interrupt-driven radio completion (APP_RADIO_IRQ) is supported.
+ *
+ * Times in DWT_TIME_UNITS of the simulation (true) time, EMU_SECOND per s.
+ */
+#define EMU_SECOND (63897600000ULL) // 499.2 MHz * 128
+#define EMU_US(us) ((uint64_t)(us) * 638976 / 10)
+#define EMU_MAX_NODES 16
+#define EMU_CPU_LATENCY_US (150) // Default reaction time of the firmware (IRQ, process switch, SPI)
+
+typedef struct {
+  double noise_mm;       // Standard deviation of the RX timestamps, as a distance
+  double drift_ppm;      // Bound of the clock offsets
+  double ant_err_dtu;    // Standard deviation of the true antenna delays from ANTENNA_DELAY
+  uint32_t latency_us;   // Firmware reaction time
+  double range_m;        // Frames are not heard beyond, 0 for no limit
+} emu_channel_t;
+
+typedef struct {
+  uint32_t frames;       // Frames transmitted
+  uint32_t received;     // Frames received with a good CRC (any destination)
+  uint32_t collisions;   // Receptions lost to overlapping frames
+  uint32_t late_tx;      // Delayed transmissions refused as late
+  uint32_t rx_timeouts;  // RX windows that timed out
+} emu_stats_t;
+
+/* Log callback: one complete line printed by a node, without the newline */
+typedef void (*emu_log_t)(int node, uint64_t time, const char *line);
+
+/* Set the channel model and the random seed, before adding the nodes */
+void emu_init(const emu_channel_t *channel, unsigned int seed, emu_log_t log);
+
+/* Add a node running the firmware named role (e.g. "rng-resp") at (x, y) m.
+ * Returns the node index, or -1 if no more copies of role were linked. */
+int emu_add_node(const char *role, const linkaddr_t *addr, double x, double y);
+
+/* Boot the nodes at random times in the first 100 ms and run the simulation
+ * until the given time, or continue it */
+void emu_run(uint64_t until);
+
+/* Simulation time, counters and node parameters */
+uint64_t emu_time(void);
+const emu_stats_t *emu_stats(void);
+double emu_distance(int a, int b); // In m
+double emu_drift_ppm(int node);
+double emu_antenna_error(int node); // True minus configured antenna delay, in DWT_TIME_UNITS
+/*---------------------------------------------------------------------------*/
+#endif /* DWT_EMU_H */
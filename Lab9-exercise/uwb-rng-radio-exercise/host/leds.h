@@ -0,0 +1,7 @@
+#ifndef LEDS_H_
+#define LEDS_H_
+/* Host shim, the nodes have no LEDs */
+#define leds_on(l)
+#define leds_off(l)
+#define leds_toggle(l)
+#endif /* LEDS_H_ */
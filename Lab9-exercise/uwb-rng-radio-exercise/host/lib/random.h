@@ -0,0 +1,6 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+/* Host shim, seeded by the emulator */
+unsigned short random_rand(void);
+#define RANDOM_RAND_MAX 65535U
+#endif /* RANDOM_H_ */
@@ -0,0 +1,52 @@
+/*
+ * Deployment map of the testbed, shared by the host programs (see map.h)
+ */
+#include <stdio.h>
+#include <string.h>
+#include "map.h"
+/*---------------------------------------------------------------------------*/
+static struct map_node nodes[MAP_MAX_NODES];
+static int num_nodes;
+/*---------------------------------------------------------------------------*/
+int
+map_load(const char *csv_file)
+{
+  char line[256], *coord, *addr;
+  double x, y;
+  FILE *f = fopen(csv_file, "r");
+
+  if(!f) {
+    return 0;
+  }
+  while(fgets(line, sizeof(line), f) && num_nodes < MAP_MAX_NODES) {
+    coord = strchr(line, '[');
+    addr = strrchr(line, ',');
+    if(!coord || !addr || sscanf(coord, "[%lf, %lf]", &x, &y) != 2 || strlen(addr) < 8) {
+      continue;
+    }
+    addr = strchr(addr, '"');
+    if(!addr || !(addr = strchr(addr + 1, '"'))) {
+      continue;
+    }
+    memcpy(nodes[num_nodes].addr, addr - 5, 5);
+    nodes[num_nodes].x = x;
+    nodes[num_nodes].y = y;
+    num_nodes++;
+  }
+  fclose(f);
+  return num_nodes;
+}
+/*---------------------------------------------------------------------------*/
+const struct map_node *
+map_find(const char *addr)
+{
+  int i;
+
+  for(i = 0; i < num_nodes; i++) {
+    if(strncmp(nodes[i].addr, addr, 5) == 0) {
+      return &nodes[i];
+    }
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,23 @@
+#ifndef MAP_H
+#define MAP_H
+/*---------------------------------------------------------------------------*/
+/****** Deployment map of the testbed, for the host programs ******/
+
+/* Rows of the map CSV (e.g. DEPT_evb1000_map.csv) look like:
+ * "2","DEPT","[72.74, 6.6]","10:20:5f:13:10:00:19:15"
+ * The node is known by the last two bytes of its address, its short address.
+ */
+#define MAP_MAX_NODES 256
+
+struct map_node {
+  char addr[6];        // Short address, "xx:xx"
+  double x, y;         // Position, in m
+};
+
+/* Load the nodes of csv_file. Returns their number, 0 if it cannot be read. */
+int map_load(const char *csv_file);
+
+/* Node of short address addr ("xx:xx"), NULL if not in the map */
+const struct map_node *map_find(const char *addr);
+/*---------------------------------------------------------------------------*/
+#endif /* MAP_H */
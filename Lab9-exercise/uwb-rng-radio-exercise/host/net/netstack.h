@@ -0,0 +1,5 @@
+#ifndef NETSTACK_H
+#define NETSTACK_H
+/* Host shim: the ranging processes drive the radio directly (dwt_* calls) */
+#include "contiki.h"
+#endif /* NETSTACK_H */
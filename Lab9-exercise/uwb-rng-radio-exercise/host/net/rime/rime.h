@@ -0,0 +1,5 @@
+#ifndef RIME_H_
+#define RIME_H_
+/* Host shim: the ranging processes do not use Rime */
+#include "contiki.h"
+#endif /* RIME_H_ */
@@ -5,6 +5,91 @@
 
 #define APP_RADIO_CONF 1
 
+/* Ranging scheme: 0 for single-sided TWR (init, resp), computed by the initiator;
+ * 1 for double-sided TWR (init, resp, final), computed by the responder (see rng-dstwr.h) */
+#define APP_DSTWR 0
+
+/* 1 to range with all the responders in one round: a broadcast init message lists
+ * them and each one replies in its own slot (single-sided TWR only, see
+ * rng-bcast.h). Responder i
+ * replies RESP_DELAY + i * BCAST_SLOT after the init, and SS-TWR is off by half
+ * the reply times the clock offset: 0.77 m plus 0.62 m per slot at 10 ppm. Hence
+ * APP_CLOCK_OFFSET_CORR is required, which brings the error down to ~2 mm. */
+#define APP_BCAST_INIT 0
+
+/* 1 for the responders to search the shortest reply delay at which the delayed
+ * resp transmission is still on time (ignored with APP_BCAST_INIT, where the
+ * reply slots assume the same delay on every responder). The search makes a
+ * few resp transmissions late on purpose, and the exchanges fail, after boot
+ * (see rng-delay.h). */
+#define APP_CALIBRATE_RESP_DELAY 0
+
+/* 1 to also print a filtered distance (median + Kalman, see rng-filter.h) for
+ * each ranging peer, computed on the node that computes the raw distance */
+#define APP_RNG_FILTER 0
+
+/* 1 for the initiator to estimate its own position from the ranges to the
+ * responders (anchors, see rng-pos.h), SS-TWR and broadcast init only */
+#define APP_RNG_POS 0
+
+/* 1 to share the channel among several initiators: a coordinator (rng-coord)
+ * beacons a superframe and assigns a ranging slot to each initiator that
+ * registers (see rng-tdma.h, TDMA_* in rng-support.h and experiment-tdma.json) */
+#define APP_TDMA 0
+
+/* 1 to correct single-sided TWR for the responder clock offset, estimated by the
+ * initiator radio on each resp message (see sstwr_dist_mm() in rng-tof.h) */
+#define APP_CLOCK_OFFSET_CORR 0
+
+/* 1 for the responders to add their estimate of the initiator clock offset to
+ * the resp message (RNG_EXT_CLOCK_OFFSET, 6 bytes): the initiator averages it
+ * with its own, for a less noisy SS-TWR correction */
+#define APP_EXT_CLOCK_OFFSET 0
+
+/* 1 for the responders to learn the period of their init messages and keep the
+ * radio in deep sleep between short RX windows around the expected arrivals,
+ * listening continuously until synchronized (single initiator, no APP_TDMA, see
+ * rng-duty.h) */
+#define APP_RESP_DUTY_CYCLE 0
+
+/* 1 for the initiator to range with each responder at its own rate, from the
+ * filtered speed and prediction errors of its distance (see rng-rate.h): rarely
+ * when static, often when moving. Unicast SS-TWR with APP_RNG_FILTER only. */
+#define APP_ADAPTIVE_RATE 0
+
+/* 1 to drop the IEEE 802.15.4 frame control and PAN ID from the ranging
+ * messages (see rng_hdr_t in rng-support.h), 4 bytes shorter frames that only
+ * the ranging nodes understand. All the nodes must use the same setting. */
+#define APP_SHORT_HDR 0
+
+/* 1 to piggyback application data (e.g. sensor readings) on the init and resp
+ * messages, see rng-payload.h: rng-resp queues an example sample for the
+ * initiator every 2 s. All the nodes must use the same frame version. */
+#define APP_PIGGYBACK 0
+
+/* 1 to print the receive diagnostics (first path and total power, noise) of the
+ * message closing each exchange, classified as LOS, suspect or NLOS (see
+ * read_rx_diag() in rng-support.h), and to down-weight the suspect and NLOS
+ * ranges in the distance filter */
+#define APP_RX_DIAG 0
+
+/* 1 for the initiator to print, every CPU_REPORT_ROUNDS rounds, the cycles of the
+ * fixed-point distance computation and of the former double one (SS-TWR) */
+#define APP_TOF_BENCH 0
+
+/* Radio completion: 1 for DW1000 interrupts, the ranging processes yield while
+ * waiting for the radio; 0 for busy polling of the status register. The host
+ * emulator (make rng-emu-host) only supports interrupts and builds with 1. */
+#ifndef APP_RADIO_IRQ
+#define APP_RADIO_IRQ 0
+#endif
+
+/* Every CPU_REPORT_ROUNDS ranging rounds (0 for never), the nodes print their
+ * CPU usage if ENERGEST_CONF_ON, and the statistics of the enabled features
+ * (APP_TOF_BENCH, APP_ADAPTIVE_RATE, APP_PIGGYBACK, APP_RESP_DUTY_CYCLE) */
+#define ENERGEST_CONF_ON 0
+#define CPU_REPORT_ROUNDS 0
+
 #if APP_RADIO_CONF == 1
 #define DW1000_CONF_CHANNEL        4
 #define DW1000_CONF_PRF            DWT_PRF_64M
@@ -0,0 +1,143 @@
+#include "contiki.h"
+#include <stdio.h>
+#include <string.h>
+#include "dw1000.h"
+#include "rng-support.h"
+#include "rng-tof.h"
+#include "rng-tdma.h"
+#include "rng-peers.h"
+#include "rng-bcast.h"
+/*---------------------------------------------------------------------------*/
+#if APP_BCAST_INIT
+static bcast_init_msg_t bcast_msg; // Broadcast init message, listing all the responders
+static sstwr_resp_msg_t resp_msg;
+static sstwr_resp_msg_t replies[BCAST_MAX_RESP]; // Resp message of each responder in the current round
+static uint8_t replies_len[BCAST_MAX_RESP]; // Length of each resp message
+static uint64_t replies_rx_ts[BCAST_MAX_RESP]; // RX timestamp of each resp message
+static int32_t replies_offset[BCAST_MAX_RESP]; // Clock offset of each responder
+#if APP_RX_DIAG
+static rx_diag_t replies_diag[BCAST_MAX_RESP]; // Receive diagnostics of each resp message
+#define REPLY_DIAG(i) (&replies_diag[i])
+#else
+#define REPLY_DIAG(i) NULL
+#endif
+static uint8_t replied[BCAST_MAX_RESP];
+static uint8_t received;
+static uint64_t window_end; // End of the RX window, in radio time
+static uint16_t resp_len;
+static uint8_t ret;
+static uint8_t i;
+/*---------------------------------------------------------------------------*/
+PT_THREAD(rng_bcast_round(struct pt *pt, uint8_t seqn, const linkaddr_t *resp, uint8_t n,
+                          uint16_t timeout, uint64_t tx_time))
+{
+  uint64_t init_rx_ts, resp_tx_ts;
+  int32_t dist_mm;
+  uint8_t init_len;
+
+  PT_BEGIN(pt);
+
+  for(i = 0; i < n; i++) {
+    printf("[%u] ranging with %02x%02x ...\n", seqn, resp[i].u8[0], resp[i].u8[1]);
+    bcast_msg.resp[i][0] = resp[i].u8[0];
+    bcast_msg.resp[i][1] = resp[i].u8[1];
+    replied[i] = 0;
+  }
+  fill_hdr(&bcast_msg.hdr, RNG_MSG_BCAST_INIT, &linkaddr_node_addr, &bcast_addr, seqn);
+  init_len = BCAST_MSG_MIN_LEN + rng_payload_put(bcast_msg.ext, 0, &bcast_addr);
+
+  ret = start_tx(&bcast_msg, init_len, INIT_TX_MODE, timeout + n * BCAST_SLOT, tx_time);
+  rng_payload_sent(ret);
+  if(!ret) {
+    radio_reset();
+    printf("[%u] fail (TX err)\n", seqn);
+    PT_EXIT(pt);
+  }
+
+  /* Collect the replies until every responder answered or the window is over.
+   * Only the reply is stored here: the receiver must be re-enabled before the next slot. */
+  RADIO_PT_WAIT_TX(pt);
+  window_end = (get_tx_timestamp() + (uint64_t)(timeout + n * BCAST_SLOT) * UUS_TO_DWT_TIME) % DWT_VALUES;
+  received = 0;
+  while(1) {
+    RADIO_PT_WAIT_RX(pt, ret);
+    if(ret && (resp_len = read_rx_msg(&resp_msg, RNG_MSG_RESP, RESP_MSG_MIN_LEN, sizeof(resp_msg))) &&
+       resp_msg.hdr.seqn == seqn &&
+       resp_msg.hdr.dst[0] == linkaddr_node_addr.u8[1] && resp_msg.hdr.dst[1] == linkaddr_node_addr.u8[0]) {
+      for(i = 0; i < n; i++) {
+        if(!replied[i] && resp_msg.hdr.src[0] == resp[i].u8[1] && resp_msg.hdr.src[1] == resp[i].u8[0]) {
+          replies[i] = resp_msg;
+          replies_len[i] = resp_len;
+          replies_rx_ts[i] = get_rx_timestamp();
+          replies_offset[i] = RESP_CLOCK_OFFSET(&resp_msg, resp_len);
+#if APP_RX_DIAG
+          read_rx_diag(&replies_diag[i]);
+#endif
+          replied[i] = 1;
+          received++;
+          break;
+        }
+      }
+    }
+    else if(!ret) {
+      radio_reset();
+    }
+    if(received == n || uus_until(window_end) == 0) {
+      break;
+    }
+    start_rx(uus_until(window_end));
+  }
+  radio_reset();
+
+  /* Single-sided TWR with each responder, all sharing the init TX timestamp */
+  for(i = 0; i < n; i++) {
+    if(!replied[i]) {
+      printf("[%u] fail (RX err) %02x%02x\n", seqn, resp[i].u8[0], resp[i].u8[1]);
+      continue;
+    }
+    resp_msg_get_timestamp(&(replies[i].init_rx_ts[0]), &init_rx_ts);
+    resp_msg_get_timestamp(&(replies[i].resp_tx_ts[0]), &resp_tx_ts);
+    dist_mm = sstwr_dist_mm(ts_interval(get_tx_timestamp(), replies_rx_ts[i]),
+                            ts_interval(init_rx_ts, resp_tx_ts), replies_offset[i]);
+
+    printf("RANGING OK [%02x:%02x->%02x:%02x] %ld mm %lu us\n",
+      linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+      resp[i].u8[0], resp[i].u8[1],
+      (long)dist_mm, (unsigned long)dtu_to_us(ts_interval(get_tx_timestamp(), replies_rx_ts[i])));
+    rng_peers_range(i, dist_mm, seqn, REPLY_DIAG(i));
+    rng_payload_receive(replies[i].ext, replies_len[i] - RESP_MSG_MIN_LEN, &resp[i]);
+  }
+  rng_peers_round(seqn); // Once per round, with the distances to all the responders
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rng_bcast_read_init(sstwr_init_msg_t *msg, uint8_t *slot)
+{
+  static bcast_init_msg_t bcast_msg;
+  uint16_t len;
+
+  len = read_rx_msg(&bcast_msg, RNG_MSG_BCAST_INIT, BCAST_MSG_MIN_LEN, sizeof(bcast_msg));
+  if(!len) {
+    return 0;
+  }
+
+  /* Our reply slot is our index in the list of responders */
+  for(*slot = 0; *slot < BCAST_MAX_RESP; (*slot)++) {
+    if(bcast_msg.resp[*slot][0] == linkaddr_node_addr.u8[0] &&
+       bcast_msg.resp[*slot][1] == linkaddr_node_addr.u8[1]) {
+      break;
+    }
+  }
+  msg->hdr = bcast_msg.hdr;
+  if(*slot < BCAST_MAX_RESP &&
+     msg->hdr.dst[0] == bcast_addr.u8[1] && msg->hdr.dst[1] == bcast_addr.u8[0]) {
+    msg->hdr.dst[0] = linkaddr_node_addr.u8[1];
+    msg->hdr.dst[1] = linkaddr_node_addr.u8[0];
+  }
+  memcpy(msg->ext, bcast_msg.ext, len - BCAST_MSG_MIN_LEN);
+  return INIT_MSG_MIN_LEN + (len - BCAST_MSG_MIN_LEN);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* APP_BCAST_INIT */
@@ -0,0 +1,29 @@
+#ifndef RNG_BCAST_H
+#define RNG_BCAST_H
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "core/net/linkaddr.h"
+#include "rng-support.h"
+/*---------------------------------------------------------------------------*/
+/****** Broadcast init: one round with all the responders (APP_BCAST_INIT) ******/
+
+/* The initiator sends one bcast_init_msg_t listing up to BCAST_MAX_RESP
+ * responders. Responder i replies RESP_DELAY + i * BCAST_SLOT after it, and the
+ * initiator computes the single-sided TWR distance to each one from the same
+ * init TX timestamp.
+ */
+
+/* Initiator protothread of round seqn, for the ranging process
+ * (PROCESS_PT_SPAWN): send the init message to the n responders at tx_time
+ * (with INIT_TX_MODE, see rng-tdma.h), collect the replies, waiting timeout ~us
+ * for the first slot, and print the distances (see rng-peers.h) */
+PT_THREAD(rng_bcast_round(struct pt *pt, uint8_t seqn, const linkaddr_t *resp, uint8_t n,
+                          uint16_t timeout, uint64_t tx_time));
+
+/* Responder: upon reception, read a broadcast init message into msg as a
+ * unicast one, addressed to this node if it is in the list, and get the
+ * index of this node in it (BCAST_MAX_RESP if missing). Returns the length of
+ * the equivalent init message, 0 if the frame is not a broadcast init. */
+uint16_t rng_bcast_read_init(sstwr_init_msg_t *msg, uint8_t *slot);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_BCAST_H */
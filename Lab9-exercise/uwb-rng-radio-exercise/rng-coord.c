@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2022, University of Trento.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above
+ *    copyright notice, this list of conditions and the following
+ *    disclaimer in the documentation and/or other materials provided
+ *    with the distribution.
+ * 3. The name of the author may not be used to endorse or promote
+ *    products derived from this software without specific prior
+ *    written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS
+ * OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include "contiki.h"
+#include "net/rime/rime.h"
+#include "net/netstack.h"
+#include <stdio.h>
+#include "dw1000.h"
+#include "core/net/linkaddr.h"
+#include "rng-support.h"
+/*---------------------------------------------------------------------------*/
+PROCESS(tdma_coord_process, "TDMA coordinator process");
+AUTOSTART_PROCESSES(&tdma_coord_process);
+/*---------------------------------------------------------------------------*/
+static tdma_beacon_msg_t beacon; // Current schedule, owner[i] is the initiator of slot i
+static uint8_t idle[TDMA_MAX_SLOTS]; // Superframes since the initiator of each slot was last heard
+/*---------------------------------------------------------------------------*/
+static int
+find_slot(const linkaddr_t *addr)
+{
+  int i;
+
+  for(i = 0; i < TDMA_MAX_SLOTS; i++) {
+    if(beacon.owner[i][0] == addr->u8[0] && beacon.owner[i][1] == addr->u8[1]) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+PROCESS_THREAD(tdma_coord_process, ev, data)
+{
+  static struct etimer et;
+  static rng_hdr_t hdr; // Header of the frames heard during the superframe
+  static uint64_t window_end; // End of the registration slots, in radio time
+  static uint8_t seqn = 0;
+  static uint8_t ret;
+  static linkaddr_t src, dst;
+  static int i;
+
+  PROCESS_BEGIN();
+
+  printf("I am %02x%02x (TDMA coordinator)\n",
+    linkaddr_node_addr.u8[0],
+    linkaddr_node_addr.u8[1]
+  );
+
+  radio_init();
+
+  etimer_set(&et, TDMA_SUPERFRAME);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
+    etimer_reset(&et);
+    seqn++;
+
+    /* Release the slots of the initiators that stopped ranging */
+    for(i = 0; i < TDMA_MAX_SLOTS; i++) {
+      if((beacon.owner[i][0] || beacon.owner[i][1]) && ++idle[i] > TDMA_LEASE) {
+        printf("TDMA slot %d released by %02x%02x\n", i, beacon.owner[i][0], beacon.owner[i][1]);
+        beacon.owner[i][0] = beacon.owner[i][1] = 0;
+      }
+    }
+
+    /* Start the superframe */
+    fill_hdr(&beacon.hdr, RNG_MSG_TDMA_BEACON, &linkaddr_node_addr, &bcast_addr, seqn);
+    ret = start_tx(&beacon, sizeof(beacon), DWT_START_TX_IMMEDIATE, 0, 0);
+    if(!ret) {
+      radio_reset();
+      printf("[%u] fail (TX err)\n", seqn);
+      continue;
+    }
+    RADIO_WAIT_TX();
+
+    /* Listen until the end of the registration slots: the init messages
+     * of the slot owners renew their slots, requests get a free one */
+    window_end = (get_tx_timestamp() + (uint64_t)TDMA_REG_END * UUS_TO_DWT_TIME) % DWT_VALUES;
+    start_rx(uus_until(window_end));
+    while(1) {
+      RADIO_WAIT_RX(ret);
+      if(ret && read_rx_hdr(&hdr)) {
+        src.u8[0] = hdr.src[1];
+        src.u8[1] = hdr.src[0];
+        dst.u8[0] = hdr.dst[1];
+        dst.u8[1] = hdr.dst[0];
+        i = find_slot(&src);
+        if(i >= 0) {
+          idle[i] = 0;
+        }
+        else if(linkaddr_cmp(&dst, &linkaddr_node_addr) && rx_msg_type() == RNG_MSG_TDMA_REG) {
+          linkaddr_copy(&dst, &linkaddr_null);
+          i = find_slot(&dst);
+          if(i >= 0) {
+            beacon.owner[i][0] = src.u8[0];
+            beacon.owner[i][1] = src.u8[1];
+            idle[i] = 0;
+            printf("TDMA slot %d assigned to %02x%02x\n", i, src.u8[0], src.u8[1]);
+          }
+          else {
+            printf("TDMA no free slot for %02x%02x\n", src.u8[0], src.u8[1]);
+          }
+        }
+      }
+      else if(!ret) {
+        radio_reset();
+      }
+      if(uus_until(window_end) == 0) {
+        break;
+      }
+      start_rx(uus_until(window_end));
+    }
+    radio_reset();
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,41 @@
+#include "contiki.h"
+#include <stdio.h>
+#include "rng-delay.h"
+/*---------------------------------------------------------------------------*/
+#if CALIBRATE_RESP_DELAY
+static uint16_t delay_max, delay_on_time, delay_late = RESP_DELAY_MIN; // Search interval
+static uint8_t calibrated = 0;
+/*---------------------------------------------------------------------------*/
+void
+rng_delay_init(uint16_t max)
+{
+  delay_max = delay_on_time = max;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rng_delay_update(uint16_t delay, uint8_t on_time)
+{
+  if(!calibrated) {
+    if(on_time) {
+      delay_on_time = delay;
+    }
+    else {
+      delay_late = delay;
+    }
+    if(delay_on_time - delay_late <= RESP_DELAY_STEP) {
+      calibrated = 1;
+      delay = delay_on_time + RESP_DELAY_MARGIN;
+      printf("RESP DELAY calibrated: %u uus (shortest on time %u uus)\n", delay, delay_on_time);
+    }
+    else {
+      delay = (delay_on_time + delay_late) / 2;
+    }
+  }
+  else if(!on_time && delay < delay_max) {
+    delay += RESP_DELAY_STEP;
+    printf("RESP DELAY increased: %u uus\n", delay);
+  }
+  return delay;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* CALIBRATE_RESP_DELAY */
@@ -0,0 +1,30 @@
+#ifndef RNG_DELAY_H
+#define RNG_DELAY_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/****** Reply delay calibration of the responders (APP_CALIBRATE_RESP_DELAY) ******/
+
+/* Binary search of the shortest reply delay at which start_tx() succeeds, one
+ * exchange per step: a late delayed transmission fails to start and that
+ * exchange is lost. Once calibrated, the delay is only increased after late
+ * TXs. Not with APP_BCAST_INIT, where the reply slots assume the same delay
+ * on every responder.
+ */
+#define CALIBRATE_RESP_DELAY (APP_CALIBRATE_RESP_DELAY && !APP_BCAST_INIT)
+#define RESP_DELAY_MIN (50)     // Lower bound of the search, in ~us
+#define RESP_DELAY_STEP (10)    // Resolution of the search, and increase after a late TX once calibrated
+#define RESP_DELAY_MARGIN (50)  // Added to the shortest delay found, for processing jitter
+
+#if CALIBRATE_RESP_DELAY
+/* Start the search below max, the upper bound, assumed to be always on time */
+void rng_delay_init(uint16_t max);
+
+/* Reply delay of the next exchange, after one at delay that was on time or late */
+uint16_t rng_delay_update(uint16_t delay, uint8_t on_time);
+#else
+#define rng_delay_init(max)
+#define rng_delay_update(delay, on_time) (delay)
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_DELAY_H */
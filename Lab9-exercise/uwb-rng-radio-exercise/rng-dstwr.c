@@ -0,0 +1,109 @@
+#include "contiki.h"
+#include <stdio.h>
+#include "dw1000.h"
+#include "rng-support.h"
+#include "rng-tof.h"
+#include "rng-dstwr.h"
+/*---------------------------------------------------------------------------*/
+#if APP_DSTWR
+#define UWB_FINAL_DELAY (FINAL_DELAY * UUS_TO_DWT_TIME)
+/*---------------------------------------------------------------------------*/
+static dstwr_final_msg_t final_msg;
+static uint8_t ret;
+#if APP_RNG_FILTER
+static rng_filter_t filter; // Of the responder, the deployment has a single initiator
+#endif
+/*---------------------------------------------------------------------------*/
+PT_THREAD(rng_dstwr_send_final(struct pt *pt, linkaddr_t *resp, uint8_t seqn))
+{
+  uint64_t init_tx_ts, resp_rx_ts, final_tx_ts;
+
+  PT_BEGIN(pt);
+
+  /* Reply FINAL_DELAY after the resp message, embedding the initiator timestamps */
+  init_tx_ts = get_tx_timestamp();
+  resp_rx_ts = get_rx_timestamp();
+  final_tx_ts = (resp_rx_ts + UWB_FINAL_DELAY) % DWT_VALUES;
+  fill_hdr(&final_msg.hdr, RNG_MSG_FINAL, &linkaddr_node_addr, resp, seqn);
+  resp_msg_set_timestamp(&final_msg.init_tx_ts[0], init_tx_ts);
+  resp_msg_set_timestamp(&final_msg.resp_rx_ts[0], resp_rx_ts);
+  resp_msg_set_timestamp(&final_msg.final_tx_ts[0], predict_tx_timestamp(final_tx_ts));
+
+  ret = start_tx(&final_msg, sizeof(final_msg), DWT_START_TX_DELAYED, 0, final_tx_ts);
+  if(!ret) {
+    radio_reset();
+    printf("[%u] fail (TX err)\n", seqn);
+    PT_EXIT(pt);
+  }
+
+  /* The next round must not start while the final message is on air */
+  RADIO_PT_WAIT_TX(pt);
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+PT_THREAD(rng_dstwr_recv_final(struct pt *pt, const sstwr_init_msg_t *init_msg, uint64_t init_rx_ts))
+{
+  uint64_t init_tx_ts, resp_rx_ts, final_tx_ts, resp_tx_ts, final_rx_ts;
+  linkaddr_t init_src;
+  int32_t dist_mm;
+#if APP_RX_DIAG
+  rx_diag_t diag;
+#endif
+
+  PT_BEGIN(pt);
+
+  /* Wait for the final message of the same exchange */
+  RADIO_PT_WAIT_RX(pt, ret);
+  if(!ret) {
+    radio_reset();
+    printf("[%u] FINAL RX fail\n", init_msg->hdr.seqn);
+    PT_EXIT(pt);
+  }
+  ret = read_rx_msg(&final_msg, RNG_MSG_FINAL, sizeof(final_msg), sizeof(final_msg)) > 0;
+  if(!ret) {
+    radio_reset();
+    printf("[%u] FINAL wrong frame\n", init_msg->hdr.seqn);
+    PT_EXIT(pt);
+  }
+  if(final_msg.hdr.seqn != init_msg->hdr.seqn ||
+      final_msg.hdr.src[0] != init_msg->hdr.src[0] || final_msg.hdr.src[1] != init_msg->hdr.src[1]) {
+    printf("[%u] FINAL wrong exchange [%u]\n", init_msg->hdr.seqn, final_msg.hdr.seqn);
+    PT_EXIT(pt);
+  }
+
+  /* Timestamps of both sides:
+   * INIT   init_tx_ts <-- round A --> resp_rx_ts <-- reply A --> final_tx_ts
+   * RESP   init_rx_ts <-- reply B --> resp_tx_ts <-- round B --> final_rx_ts
+   */
+  resp_tx_ts = get_tx_timestamp(); // Actual TX time of the resp message
+  final_rx_ts = get_rx_timestamp();
+  resp_msg_get_timestamp(&final_msg.init_tx_ts[0], &init_tx_ts);
+  resp_msg_get_timestamp(&final_msg.resp_rx_ts[0], &resp_rx_ts);
+  resp_msg_get_timestamp(&final_msg.final_tx_ts[0], &final_tx_ts);
+
+  dist_mm = dstwr_dist_mm(
+    ts_interval(init_tx_ts, resp_rx_ts), ts_interval(resp_rx_ts, final_tx_ts),
+    ts_interval(resp_tx_ts, final_rx_ts), ts_interval(init_rx_ts, resp_tx_ts));
+
+  init_src.u8[0] = init_msg->hdr.src[1];
+  init_src.u8[1] = init_msg->hdr.src[0];
+  printf("RANGING OK [%02x:%02x->%02x:%02x] %ld mm %lu us\n",
+    init_src.u8[0], init_src.u8[1],
+    linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+    (long)dist_mm, (unsigned long)dtu_to_us(ts_interval(init_rx_ts, final_rx_ts)));
+#if APP_RX_DIAG
+  /* Diagnostics of the final message, still in the radio registers */
+  read_rx_diag(&diag);
+  print_rx_diag(&init_src, &linkaddr_node_addr, &diag);
+#if APP_RNG_FILTER
+  print_filtered(&filter, &init_src, &linkaddr_node_addr, dist_mm, rx_diag_meas_std(&diag), NULL);
+#endif
+#elif APP_RNG_FILTER
+  print_filtered(&filter, &init_src, &linkaddr_node_addr, dist_mm, RNG_FILTER_MEAS_STD, NULL);
+#endif
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+#endif /* APP_DSTWR */
@@ -0,0 +1,36 @@
+#ifndef RNG_DSTWR_H
+#define RNG_DSTWR_H
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "core/net/linkaddr.h"
+#include "dw1000.h"
+#include "rng-support.h"
+/*---------------------------------------------------------------------------*/
+/****** Double-sided TWR (APP_DSTWR) ******/
+
+/* The initiator answers the resp message with a final message, FINAL_DELAY
+ * after it, embedding its timestamps. The responder then has both round and
+ * reply times of both sides, and computes and prints the distance.
+ */
+#define FINAL_DELAY (500) // Time to wait before sending the final message in ~us
+
+/* Resp transmission: with APP_DSTWR, the receiver is kept on for the final message */
+#if APP_DSTWR
+#define FINAL_TIMEOUT (5000) // Maximum time to wait for the final message after the resp in ~us
+#define RESP_TX_MODE (DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED)
+#else
+#define FINAL_TIMEOUT (0)
+#define RESP_TX_MODE (DWT_START_TX_DELAYED)
+#endif
+
+/* Initiator protothread, for the ranging process (PROCESS_PT_SPAWN), once the
+ * resp message is received: send the final message of exchange seqn to resp,
+ * with the TX timestamp of the init message and the RX timestamp of the resp */
+PT_THREAD(rng_dstwr_send_final(struct pt *pt, linkaddr_t *resp, uint8_t seqn));
+
+/* Responder protothread, for the ranging process (PROCESS_PT_SPAWN), once the
+ * resp message to init_msg is sent: wait for the final message and print the
+ * distance to the initiator. init_rx_ts is the RX timestamp of init_msg. */
+PT_THREAD(rng_dstwr_recv_final(struct pt *pt, const sstwr_init_msg_t *init_msg, uint64_t init_rx_ts));
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_DSTWR_H */
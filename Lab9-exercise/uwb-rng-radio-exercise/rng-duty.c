@@ -0,0 +1,161 @@
+#include "contiki.h"
+#include <stdio.h>
+#include "rng-support.h"
+#include "rng-duty.h"
+/*---------------------------------------------------------------------------*/
+#if APP_RESP_DUTY_CYCLE
+#define CLOCK_TO_UUS(t) ((uint64_t)(t) * 975000 / CLOCK_SECOND) // 1 uus = 512 / 499.2 us
+/*---------------------------------------------------------------------------*/
+/* Schedule of the init messages for this node, learnt from their arrival
+ * times: with the period known, the radio sleeps between RX windows opened
+ * around the expected arrivals, otherwise it listens continuously */
+static clock_time_t dc_period = 0; // Learnt init period, 0 while not synchronized
+static clock_time_t dc_last_init; // Arrival of the last init for this node
+static clock_time_t dc_interval = 0; // Last interval between inits, candidate period
+static uint8_t dc_misses = 0; // Consecutive missed windows
+static clock_time_t dc_on_since, dc_on_time = 0, dc_report_since; // Radio on time accounting
+static struct etimer et; // Wake-up before the next RX window
+static clock_time_t window_end;
+static uint8_t in_window = 0; // 1 while the RX window of the expected init is open
+/*---------------------------------------------------------------------------*/
+/* Expected arrival of the next init, and half width of its RX window,
+ * both growing with each missed window */
+static clock_time_t
+dc_expected(void)
+{
+  return dc_last_init + (dc_misses + 1) * dc_period;
+}
+static clock_time_t
+dc_guard(void)
+{
+  return DC_GUARD * (dc_misses + 1);
+}
+/*---------------------------------------------------------------------------*/
+static void
+dc_window_missed(void)
+{
+  if(++dc_misses == DC_MAX_MISSES) {
+    dc_period = 0;
+    dc_interval = 0;
+    dc_misses = 0;
+    printf("DUTY CYCLE lost sync (%u windows missed)\n", DC_MAX_MISSES);
+  }
+  else {
+    printf("DUTY CYCLE window missed\n");
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+dc_radio_on(void)
+{
+  dc_on_since = clock_time();
+}
+static void
+dc_radio_off(void)
+{
+  dc_on_time += clock_time() - dc_on_since;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_duty_init(void)
+{
+  dc_last_init = dc_report_since = clock_time();
+  dc_radio_on();
+}
+/*---------------------------------------------------------------------------*/
+PT_THREAD(rng_duty_wait(struct pt *pt))
+{
+  clock_time_t wake;
+
+  PT_BEGIN(pt);
+
+  while(dc_period) {
+    if(!in_window) {
+      radio_sleep();
+      dc_radio_off();
+      wake = dc_expected() - dc_guard() - RADIO_WAKEUP_TIME;
+      if((int32_t)(wake - clock_time()) > 0) {
+        etimer_set(&et, wake - clock_time());
+        PT_WAIT_UNTIL(pt, etimer_expired(&et));
+      }
+      if(!radio_wakeup()) {
+        printf("DUTY CYCLE radio wake-up failed\n");
+      }
+      dc_radio_on();
+      window_end = dc_expected() + dc_guard();
+      in_window = 1;
+    }
+    if((int32_t)(window_end - clock_time()) > 0) {
+      break;
+    }
+    in_window = 0;
+    dc_window_missed();
+  }
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rng_duty_rx_timeout(void)
+{
+  uint64_t rx_to;
+
+  if(!dc_period) {
+    return NO_RX_TIMEOUT;
+  }
+  rx_to = CLOCK_TO_UUS(window_end - clock_time());
+  return rx_to > 0xFFFF ? 0xFFFF : rx_to;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_duty_init_received(void)
+{
+  clock_time_t now = clock_time();
+  clock_time_t interval = now - dc_last_init;
+  clock_time_t periods;
+  int32_t err;
+
+  if(dc_period) {
+    /* Refine the period, unless the schedule changed (e.g., initiator restart) */
+    periods = (interval + dc_period / 2) / dc_period;
+    err = (int32_t)(interval - periods * dc_period);
+    if(periods > 0 && err <= (int32_t)DC_PERIOD_TOL && err >= -(int32_t)DC_PERIOD_TOL) {
+      dc_period += err / (int32_t)(periods * 4);
+    }
+    else {
+      dc_period = 0;
+      printf("DUTY CYCLE lost sync (interval %lu ms)\n", (unsigned long)(interval * 1000 / CLOCK_SECOND));
+    }
+  }
+  else {
+    /* Synchronized once two intervals in a row agree */
+    err = (int32_t)(interval - dc_interval);
+    if(dc_interval && err <= (int32_t)DC_PERIOD_TOL && err >= -(int32_t)DC_PERIOD_TOL) {
+      dc_period = interval;
+      printf("DUTY CYCLE synchronized, period %lu ms\n", (unsigned long)(dc_period * 1000 / CLOCK_SECOND));
+    }
+  }
+  dc_interval = interval;
+  dc_last_init = now;
+  dc_misses = 0;
+  in_window = 0; // Back to sleep after the exchange
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_duty_report(void)
+{
+  clock_time_t now = clock_time();
+  clock_time_t elapsed = now - dc_report_since;
+
+  dc_radio_off();
+  dc_on_since = now;
+  if(elapsed > 0) {
+    uint32_t duty = (uint64_t)dc_on_time * 10000 / elapsed; // In 0.01%
+    printf("DUTY CYCLE %lu.%02lu%% (period %lu ms)\n", (unsigned long)(duty / 100),
+      (unsigned long)(duty % 100), (unsigned long)(dc_period * 1000 / CLOCK_SECOND));
+  }
+  dc_on_time = 0;
+  dc_report_since = now;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* APP_RESP_DUTY_CYCLE */
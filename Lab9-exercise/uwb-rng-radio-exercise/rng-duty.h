@@ -0,0 +1,44 @@
+#ifndef RNG_DUTY_H
+#define RNG_DUTY_H
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+/*---------------------------------------------------------------------------*/
+/****** Duty-cycled responders (APP_RESP_DUTY_CYCLE) ******/
+
+/* The responder learns the period of the init messages addressed to it from
+ * their arrival times. Once two intervals in a row agree, the radio is put in
+ * deep sleep between RX windows opened DC_GUARD before and closed DC_GUARD
+ * after each expected init, wider after each missed one. After DC_MAX_MISSES
+ * missed windows, it listens continuously again to resynchronize.
+ */
+#define DC_GUARD (CLOCK_SECOND / 50) // RX window opened this long before the expected init, and closed as long after
+#define DC_PERIOD_TOL DC_GUARD // Init intervals this close are taken as the same period
+#define DC_MAX_MISSES 3 // Consecutive missed windows before listening continuously to resynchronize
+
+#if APP_RESP_DUTY_CYCLE
+#if APP_TDMA
+#error Duty-cycled responders follow the schedule of a single initiator
+#endif
+
+/* Start listening continuously, at boot */
+void rng_duty_init(void);
+
+/* Protothread, for the ranging process (PROCESS_PT_SPAWN) before it turns the
+ * receiver on: once synchronized, sleep until the next RX window */
+PT_THREAD(rng_duty_wait(struct pt *pt));
+
+/* RX timeout until the end of the current window, NO_RX_TIMEOUT if not synchronized */
+uint16_t rng_duty_rx_timeout(void);
+
+/* An init message for this node was received */
+void rng_duty_init_received(void);
+
+/* Print the share of time the radio was on since the previous call, made with the radio on */
+void rng_duty_report(void);
+#else
+#define rng_duty_init()
+#define rng_duty_init_received()
+#define rng_duty_report()
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_DUTY_H */
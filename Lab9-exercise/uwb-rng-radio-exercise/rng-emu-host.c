@@ -0,0 +1,198 @@
+/*
+ * Host emulation of a ranging deployment (make rng-emu-host): runs the
+ * initiator and responder firmware, unmodified, on the DW1000 emulator of
+ * host/dwt-emu.c at the positions of the deployment map, and checks the
+ * ranges against the true distances. The node logs go to stdout, prefixed
+ * with the simulation time and node address, so that rng_eval.py and
+ * antenna_calib.py can be tried on them; a summary per initiator/responder
+ * pair follows.
+ *
+ * Usage: ./rng-emu-host [-t SECONDS] [-n NOISE_MM] [-d PPM] [-a ANT_ERR_DTU]
+ *                       [-l LATENCY_US] [-r RANGE_M] [-s SEED] [-m MAP_CSV]
+ *                       [-e MAX_RMSE_MM] [-q] [ROLE=ADDR ...]
+ * e.g. ./rng-emu-host -t 60 rng-init=13:9a rng-resp=19:15 rng-resp=11:0c
+ * Each role is linked as many times as listed in EMU_NODES (Makefile). The
+ * exit status is 1 if a pair got no range or, with -e, an RMSE above MAX.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include "dwt-emu.h"
+#include "map.h"
+/*---------------------------------------------------------------------------*/
+static const char *default_nodes[] = {
+  "rng-init=13:9a", "rng-resp=19:15", "rng-resp=11:0c", "rng-resp=18:33", "rng-resp=15:95", NULL
+};
+/*---------------------------------------------------------------------------*/
+struct pair {
+  long ranges;
+  double err_sum, err_sq, lat_sum;
+  long filtered;
+  double ferr_sq;
+};
+static struct pair pairs[EMU_MAX_NODES][EMU_MAX_NODES];
+static long fails[EMU_MAX_NODES];
+static char addrs[EMU_MAX_NODES][6];
+static char roles[EMU_MAX_NODES][32];
+static int num_nodes, quiet;
+/*---------------------------------------------------------------------------*/
+static int
+find_node(const char *addr)
+{
+  int i;
+
+  for(i = 0; i < num_nodes; i++) {
+    if(strncmp(addrs[i], addr, 5) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+/*---------------------------------------------------------------------------*/
+static void
+log_line(int node, uint64_t time, const char *line)
+{
+  char init[6], resp[6];
+  const char *p;
+  long dist, lat;
+  int a, b;
+  double err;
+
+  if(!quiet) {
+    printf("%.6f %s %s\n", (double)time / EMU_SECOND, addrs[node], line);
+  }
+  if((p = strstr(line, "RANGING OK [")) != NULL
+     && sscanf(p, "RANGING OK [%5[0-9a-f:]->%5[0-9a-f:]] %ld mm %ld us", init, resp, &dist, &lat) == 4
+     && (a = find_node(init)) >= 0 && (b = find_node(resp)) >= 0) {
+    err = dist - emu_distance(a, b) * 1000;
+    pairs[a][b].ranges++;
+    pairs[a][b].err_sum += err;
+    pairs[a][b].err_sq += err * err;
+    pairs[a][b].lat_sum += lat;
+  }
+  else if((p = strstr(line, "FILTERED [")) != NULL
+          && sscanf(p, "FILTERED [%5[0-9a-f:]->%5[0-9a-f:]] %ld mm", init, resp, &dist) == 3
+          && (a = find_node(init)) >= 0 && (b = find_node(resp)) >= 0) {
+    err = dist - emu_distance(a, b) * 1000;
+    pairs[a][b].filtered++;
+    pairs[a][b].ferr_sq += err * err;
+  }
+  else if(strstr(line, "fail") != NULL) {
+    fails[node]++;
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  emu_channel_t channel = { 30, 10, 0, EMU_CPU_LATENCY_US, 0 };
+  const char *map_file = "DEPT_evb1000_map.csv", **specs = default_nodes;
+  double seconds = 60, max_rmse = 0, rmse, wall;
+  unsigned int seed = 1, a0, a1;
+  const emu_stats_t *stats;
+  const struct map_node *node;
+  struct timespec t0, t1;
+  linkaddr_t addr;
+  char role[32];
+  int opt, i, j, k, status = 0;
+  struct pair *p;
+
+  while((opt = getopt(argc, argv, "t:n:d:a:l:r:s:m:e:q")) != -1) {
+    switch(opt) {
+    case 't': seconds = atof(optarg); break;
+    case 'n': channel.noise_mm = atof(optarg); break;
+    case 'd': channel.drift_ppm = atof(optarg); break;
+    case 'a': channel.ant_err_dtu = atof(optarg); break;
+    case 'l': channel.latency_us = atoi(optarg); break;
+    case 'r': channel.range_m = atof(optarg); break;
+    case 's': seed = atoi(optarg); break;
+    case 'm': map_file = optarg; break;
+    case 'e': max_rmse = atof(optarg); break;
+    case 'q': quiet = 1; break;
+    default:
+      fprintf(stderr, "Usage: %s [-t SECONDS] [-n NOISE_MM] [-d PPM] [-a ANT_ERR_DTU] [-l LATENCY_US]"
+              " [-r RANGE_M] [-s SEED] [-m MAP_CSV] [-e MAX_RMSE_MM] [-q] [ROLE=ADDR ...]\n", argv[0]);
+      return 1;
+    }
+  }
+  if(optind < argc) {
+    specs = (const char **)&argv[optind];
+  }
+  if(!map_load(map_file)) {
+    fprintf(stderr, "Cannot read the deployment map\n");
+    return 1;
+  }
+
+  emu_init(&channel, seed, log_line);
+  for(i = 0; specs[i] != NULL; i++) {
+    if(sscanf(specs[i], "%31[^=]=%2x:%2x", role, &a0, &a1) != 3) {
+      fprintf(stderr, "Bad node %s, expected ROLE=xx:xx\n", specs[i]);
+      return 1;
+    }
+    snprintf(addrs[num_nodes], sizeof(addrs[0]), "%02x:%02x", a0, a1);
+    strcpy(roles[num_nodes], role);
+    if(!(node = map_find(addrs[num_nodes]))) {
+      fprintf(stderr, "Node %s not in the deployment map\n", addrs[num_nodes]);
+      return 1;
+    }
+    addr.u8[0] = a0;
+    addr.u8[1] = a1;
+    if(emu_add_node(role, &addr, node->x, node->y) < 0) {
+      fprintf(stderr, "No more %s to run (see EMU_NODES in the Makefile)\n", role);
+      return 1;
+    }
+    num_nodes++;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  emu_run((uint64_t)(seconds * EMU_SECOND));
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  wall = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  printf("Pair          true mm  ranges  bias mm  std mm  rmse mm  filtered rmse mm  latency us\n");
+  for(i = 0; i < num_nodes; i++) {
+    for(j = 0; j < num_nodes; j++) {
+      p = &pairs[i][j];
+      if(p->ranges == 0) {
+        continue;
+      }
+      rmse = sqrt(p->err_sq / p->ranges);
+      printf("%s->%s %8.0f %7ld %8.1f %7.1f %8.1f %17.1f %11.0f\n", addrs[i], addrs[j],
+             emu_distance(i, j) * 1000, p->ranges, p->err_sum / p->ranges,
+             sqrt(p->err_sq / p->ranges - pow(p->err_sum / p->ranges, 2)), rmse,
+             p->filtered ? sqrt(p->ferr_sq / p->filtered) : 0, p->lat_sum / p->ranges);
+      if(max_rmse > 0 && rmse > max_rmse) {
+        status = 1;
+      }
+    }
+  }
+  for(i = 0; i < num_nodes; i++) {
+    printf("Node %s drift %+.2f ppm antenna error %+.0f dtu, %ld fails\n",
+           addrs[i], emu_drift_ppm(i), emu_antenna_error(i), fails[i]);
+  }
+  stats = emu_stats();
+  printf("%lu frames, %lu received, %lu collisions, %lu late TX, %lu RX timeouts\n",
+         (unsigned long)stats->frames, (unsigned long)stats->received, (unsigned long)stats->collisions,
+         (unsigned long)stats->late_tx, (unsigned long)stats->rx_timeouts);
+  printf("%.1f s simulated in %.2f s (%.0fx real time)\n", seconds, wall, seconds / wall);
+
+  /* Every ranging node must have ranged or been ranged: not the TDMA
+   * coordinator, which only sends the beacons */
+  for(i = 0; i < num_nodes; i++) {
+    if(strcmp(roles[i], "rng-coord") == 0) {
+      continue;
+    }
+    for(j = 0, k = 0; j < num_nodes; j++) {
+      k += pairs[i][j].ranges > 0 || pairs[j][i].ranges > 0;
+    }
+    if(k == 0) {
+      printf("No range with %s\n", addrs[i]);
+      status = 1;
+    }
+  }
+  return status;
+}
+/*---------------------------------------------------------------------------*/
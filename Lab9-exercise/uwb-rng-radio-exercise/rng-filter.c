@@ -0,0 +1,120 @@
+#include "rng-filter.h"
+#include "rng-math.h"
+/*---------------------------------------------------------------------------*/
+#define MEAS_VAR ((int64_t)RNG_FILTER_MEAS_STD * RNG_FILTER_MEAS_STD)
+#define ACC_VAR ((int64_t)RNG_FILTER_ACC_STD * RNG_FILTER_ACC_STD)
+#define INIT_SPEED_VAR (1000000) // (1 m/s)^2, the speed is unknown at start
+/*---------------------------------------------------------------------------*/
+static int32_t
+sat32(int64_t x)
+{
+  return x > INT32_MAX ? INT32_MAX : (x < INT32_MIN ? INT32_MIN : (int32_t)x);
+}
+/*---------------------------------------------------------------------------*/
+/* Standard deviation from a variance, saturated to 16 bits */
+static uint16_t
+std16(int32_t var)
+{
+  uint32_t res = var > 0 ? isqrt64(var) : 0;
+
+  return res > UINT16_MAX ? UINT16_MAX : res;
+}
+/*---------------------------------------------------------------------------*/
+static int32_t
+window_median(const rng_filter_t *f)
+{
+  int32_t sorted[RNG_FILTER_WIN];
+  int32_t v;
+  uint8_t i, j;
+
+  /* Insertion sort, the window is tiny */
+  for(i = 0; i < f->win_len; i++) {
+    v = f->win[i];
+    for(j = i; j > 0 && sorted[j - 1] > v; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = v;
+  }
+  return sorted[f->win_len / 2];
+}
+/*---------------------------------------------------------------------------*/
+static void
+restart(rng_filter_t *f, int32_t dist_mm)
+{
+  f->rejected = 0;
+  f->valid = 1;
+  f->dist = dist_mm;
+  f->speed = 0;
+  f->p_dd = MEAS_VAR;
+  f->p_ds = 0;
+  f->p_ss = INIT_SPEED_VAR;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_filter_reset(rng_filter_t *f)
+{
+  f->valid = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_filter_update(rng_filter_t *f, int32_t raw_mm, uint16_t meas_std, uint32_t now_ms, rng_filter_out_t *out)
+{
+  uint32_t dt = now_ms - f->last_ms;
+  int64_t q_ss, q_ds, q_dd, s, y;
+  int64_t meas_var = (int64_t)meas_std * meas_std;
+
+  out->outlier = 0;
+  if(!f->valid || dt > RNG_FILTER_MAX_DT) {
+    f->win_len = 0;
+    f->win_head = 0;
+  }
+  f->win[f->win_head] = raw_mm;
+  f->win_head = (f->win_head + 1) % RNG_FILTER_WIN;
+  if(f->win_len < RNG_FILTER_WIN) {
+    f->win_len++;
+  }
+  if(f->win_len == 1) {
+    restart(f, raw_mm);
+  }
+  else {
+    /* Prediction, dt in ms. White acceleration noise:
+     * Q = ACC_VAR * [dt^4/4 dt^3/2; dt^3/2 dt^2], built up one dt at a time
+     * so that the intermediate values fit 64 bits for any dt <= RNG_FILTER_MAX_DT */
+    q_ss = ACC_VAR * dt * dt / 1000000;
+    q_ds = q_ss * dt / 2000;
+    q_dd = q_ds * dt / 2000;
+    f->dist = sat32(f->dist + (int64_t)f->speed * dt / 1000);
+    f->p_dd = sat32(f->p_dd + 2 * (int64_t)f->p_ds * dt / 1000
+                    + (int64_t)f->p_ss * dt * dt / 1000000 + q_dd);
+    f->p_ds = sat32(f->p_ds + (int64_t)f->p_ss * dt / 1000 + q_ds);
+    f->p_ss = sat32(f->p_ss + q_ss);
+
+    /* Correction, unless the measurement is too far from the prediction */
+    y = raw_mm - f->dist;
+    s = f->p_dd + meas_var;
+    if(y * y > (int64_t)RNG_FILTER_GATE * RNG_FILTER_GATE * s) {
+      out->outlier = 1;
+      if(++f->rejected >= RNG_FILTER_MAX_REJECT) {
+        /* The target moved faster than the model allows, or the filter
+         * started from a wild value: trust the measurements again */
+        restart(f, window_median(f));
+        out->outlier = 0;
+      }
+    }
+    else {
+      f->rejected = 0;
+      f->dist = sat32(f->dist + f->p_dd * y / s);
+      f->speed = sat32(f->speed + f->p_ds * y / s);
+      f->p_ss = sat32(f->p_ss - (int64_t)f->p_ds * f->p_ds / s);
+      f->p_ds = sat32(f->p_ds - (int64_t)f->p_dd * f->p_ds / s);
+      f->p_dd = sat32(f->p_dd * meas_var / s);
+    }
+  }
+
+  f->last_ms = now_ms;
+  out->dist = f->dist;
+  out->speed = f->speed;
+  out->std = std16(f->p_dd);
+  out->speed_std = std16(f->p_ss);
+}
+/*---------------------------------------------------------------------------*/
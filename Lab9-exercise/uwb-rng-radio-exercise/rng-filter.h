@@ -0,0 +1,52 @@
+#ifndef RNG_FILTER_H
+#define RNG_FILTER_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/****** Distance filter, one instance per ranging peer ******/
+
+/* Raw distances feed a constant-velocity Kalman filter (distance, radial
+ * speed). A raw distance farther than RNG_FILTER_GATE standard deviations from
+ * the prediction is rejected as an outlier (e.g., a wrong first-path detection).
+ * The filter (re)starts from the median of the last RNG_FILTER_WIN raw values:
+ * after RNG_FILTER_MAX_REJECT consecutive rejections, the median follows a real
+ * jump of the distance while a wild first value does not lock the filter.
+ *
+ * Everything is integer arithmetic: distances in mm, speeds in mm/s,
+ * variances in the squared units.
+ */
+#define RNG_FILTER_WIN (5)           // Median window, odd
+#define RNG_FILTER_MEAS_STD (100)    // Standard deviation of a raw distance, in mm
+#define RNG_FILTER_ACC_STD (500)     // Standard deviation of the acceleration (process noise), in mm/s^2
+#define RNG_FILTER_GATE (3)          // Outlier gate, in standard deviations of the innovation
+#define RNG_FILTER_MAX_REJECT (3)    // Consecutive rejections before restarting
+#define RNG_FILTER_MAX_DT (5000)     // Longer gaps between measurements restart the filter, in ms
+
+typedef struct {
+  int32_t win[RNG_FILTER_WIN]; // Last raw distances (circular)
+  uint8_t win_len;
+  uint8_t win_head;
+  uint8_t rejected;            // Consecutive rejected medians
+  uint8_t valid;               // 0 until the first measurement
+  uint32_t last_ms;            // Time of the last update
+  int32_t dist;                // Estimated distance, mm
+  int32_t speed;               // Estimated radial speed, mm/s
+  int32_t p_dd, p_ds, p_ss;    // Covariance of (dist, speed)
+} rng_filter_t;
+
+typedef struct {
+  int32_t dist;                // Filtered distance, mm
+  int32_t speed;               // Radial speed, mm/s
+  uint16_t std;                // Standard deviation of the filtered distance (confidence), mm
+  uint16_t speed_std;          // Standard deviation of the speed, mm/s
+  uint8_t outlier;             // 1 if the current measurement was rejected
+} rng_filter_out_t;
+
+void rng_filter_reset(rng_filter_t *f);
+
+/* Add a raw distance (mm) of standard deviation meas_std (mm, RNG_FILTER_MEAS_STD
+ * unless the measurement is known to be worse) measured at now_ms (any ms clock,
+ * may wrap) and get the estimate */
+void rng_filter_update(rng_filter_t *f, int32_t raw_mm, uint16_t meas_std, uint32_t now_ms, rng_filter_out_t *out);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_FILTER_H */
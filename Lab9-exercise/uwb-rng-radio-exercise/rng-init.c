@@ -29,6 +29,7 @@
  *
  */
 
+
 #include "contiki.h"
 #include "lib/random.h"
 #include "net/rime/rime.h"
@@ -38,6 +39,11 @@
 #include "dw1000.h"
 #include "core/net/linkaddr.h"
 #include "rng-support.h"
+#include "rng-tof.h"
+#include "rng-peers.h"
+#include "rng-tdma.h"
+#include "rng-bcast.h"
+#include "rng-dstwr.h"
 /*---------------------------------------------------------------------------*/
 PROCESS(ranging_process, "Ranging process");
 AUTOSTART_PROCESSES(&ranging_process);
@@ -47,6 +53,8 @@ AUTOSTART_PROCESSES(&ranging_process);
                                 * NB: This timeout has been set deliberately large, to let you play with different RESP_DELAY at the responder.
                                 * If you want to increase RESP_DELAY further, remember to increase this timeout as well!
                                 */
+#define RANGING_TICK (RANGING_INTERVAL / RNG_PEERS_TICKS) // Scheduling grid, finer with APP_ADAPTIVE_RATE
+#define RX_TIMEOUT_MARGIN (300) // Added to the reply delay advertised by a responder (resp airtime and jitter), in ~us
 /*---------------------------------------------------------------------------*/
 linkaddr_t init = {{0x13, 0x9a}}; // Node 1
 #define NUM_DEST 4
@@ -56,7 +64,19 @@ linkaddr_t resp_list[NUM_DEST] = {
   {{0x18, 0x33}}, // Node 7
   {{0x15, 0x95}}  // Node 36
 };
+/* Responder positions in mm, from DEPT_evb1000_map.csv (same order as resp_list, used with APP_RNG_POS) */
+static const rng_pos_t anchors[NUM_DEST] = {
+  {72740, 6600},  // Node 2
+  {75970, 6860},  // Node 3
+  {72910, 370},   // Node 7
+  {74370, 16130}  // Node 36
+};
+#if NUM_DEST > RNG_PEERS_MAX || (APP_BCAST_INIT && NUM_DEST > BCAST_MAX_RESP)
+#error Too many responders
+#endif
 linkaddr_t resp;
+static uint8_t dest; // Index of resp in resp_list
+static uint16_t rx_timeout[NUM_DEST]; // RX timeout for each responder, 0 until it advertised its reply delay
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(ranging_process, ev, data)
 {
@@ -65,6 +85,15 @@ PROCESS_THREAD(ranging_process, ev, data)
   static sstwr_resp_msg_t resp_msg; // Resp ranging message (i.e., the second message in the TWR exchange, sent by the responder)
   static uint8_t seqn = 0; // Sequence number
   static uint8_t ret; // To check the TX/RX status
+  static uint16_t resp_len; // Length of the resp message, with its extension fields
+  static uint8_t init_len; // Length of the init message, with its extension fields
+  static uint64_t init_tx_time = 0; // Scheduled TX time of the init message, 0 for immediate TX
+#if APP_TDMA || APP_BCAST_INIT || APP_DSTWR
+  static struct pt child; // Protothread of the enabled scheme, see PROCESS_PT_SPAWN()
+#endif
+#if APP_ADAPTIVE_RATE
+  static int due; // Index of the responder due for ranging, -1 if none
+#endif
 
   PROCESS_BEGIN();
 
@@ -75,29 +104,72 @@ PROCESS_THREAD(ranging_process, ev, data)
 
   /* Initialize the radio */
   radio_init();
+  cycle_counter_init();
+  rng_peers_init(resp_list, anchors, NUM_DEST);
+  etimer_set(&et, RANGING_TICK); // Ranging schedule, unless APP_TDMA
 
   /* Keep ranging (in round robin with the variious responders) */
   while(1) {
     seqn ++;
 
+#if CPU_REPORT_ROUNDS
+    /* Report the CPU usage every CPU_REPORT_ROUNDS rounds */
+    if(seqn % CPU_REPORT_ROUNDS == 0) {
+      print_cpu_usage(CPU_REPORT_ROUNDS);
+      rng_peers_report(CPU_REPORT_ROUNDS);
+      rng_payload_report();
+    }
+#endif
+
     /* Choose the destination (round robin) */
-    linkaddr_copy(&resp, &resp_list[seqn % NUM_DEST]);
+    dest = seqn % NUM_DEST;
+    linkaddr_copy(&resp, &resp_list[dest]);
+
+#if APP_TDMA
+    /* Range in our slot of the next superframe */
+    PROCESS_PT_SPAWN(&child, rng_tdma_wait_slot(&child, seqn));
+    if(!rng_tdma_slot_time(&init_tx_time)) {
+      continue;
+    }
+#else
+    /* Wait for RANGING_INTERVAL, on a fixed schedule that duty-cycled responders can follow */
+    if(!etimer_expired(&et)) {
+      PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
+    }
+    etimer_reset(&et);
+#if APP_ADAPTIVE_RATE
+    /* Range with the most overdue responder, at the first tick where one is due */
+    while((due = rng_peers_due()) < 0) {
+      if(!etimer_expired(&et)) {
+        PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
+      }
+      etimer_reset(&et);
+    }
+    dest = due;
+    linkaddr_copy(&resp, &resp_list[dest]);
+#endif
+#endif
+
+#if APP_BCAST_INIT
+    /* One init message for all the responders, each one replies in its own slot */
+    PROCESS_PT_SPAWN(&child, rng_bcast_round(&child, seqn, resp_list, NUM_DEST, RANGING_TIMEOUT, init_tx_time));
+    continue;
+#endif
 
-    /* Wait for RANGING_INTERVAL */
-    etimer_set(&et, RANGING_INTERVAL);
-    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
     printf("[%u] ranging with %02x%02x ...\n", seqn, resp.u8[0], resp.u8[1]);
 
     /* Prepare the packet header, setting the surce and destination addresses and the sequence number */
-    fill_ieee_hdr(&init_msg.hdr, &linkaddr_node_addr, &resp, seqn);
+    fill_hdr(&init_msg.hdr, RNG_MSG_INIT, &linkaddr_node_addr, &resp, seqn);
+    init_len = INIT_MSG_MIN_LEN + rng_payload_put(init_msg.ext, 0, &resp);
 
     /* Send the packet */
     ret = start_tx(
-      &init_msg, sizeof(init_msg), // Content
-      DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED, // Mode
-      RANGING_TIMEOUT, // Maximum RX time after TX (relevant only if DWT_RESPONSE_EXPECTED is set)
-      0 // TX time, not set because we are asking the radio to TX immediately (DWT_START_TX_IMMEDIATE)
+      &init_msg, init_len, // Content, only the extension fields in use
+      INIT_TX_MODE, // Mode, delayed to our slot with APP_TDMA
+      rx_timeout[dest] ? rx_timeout[dest] : RANGING_TIMEOUT, // Maximum RX time after TX (relevant only if DWT_RESPONSE_EXPECTED is set)
+      init_tx_time // TX time, only used with DWT_START_TX_DELAYED (APP_TDMA)
     );
+    rng_payload_sent(ret);
 
     /* If the transmission failed, abort the ranging round and restart the procedure */
     if (!ret) {
@@ -107,22 +179,24 @@ PROCESS_THREAD(ranging_process, ev, data)
     }
 
     /* Wait for a response */
-    ret = wait_rx();
+    RADIO_WAIT_RX(ret);
 
-    /* If the reception failed, abort the ranging round and restart the procedure */
+    /* If the reception failed, abort the ranging round and restart the procedure.
+     * The responder may have increased its reply delay: use the default timeout next time. */
     if (!ret) {
       radio_reset();
+      rx_timeout[dest] = 0;
       printf("[%u] fail (RX err)\n", seqn);
       continue;
     }
 
     /* Read the ranging reply */
-    ret = read_rx_data(&resp_msg, sizeof(resp_msg));
+    resp_len = read_rx_msg(&resp_msg, RNG_MSG_RESP, RESP_MSG_MIN_LEN, sizeof(resp_msg));
 
     /* If the message could not be read, abort and restart the procedure */
-    if (!ret) {
+    if(!resp_len) {
       radio_reset();
-      printf("[%u] fail (bad size)\n", seqn);
+      printf("[%u] fail (bad frame)\n", seqn);
       continue;
     }
 
@@ -136,6 +210,14 @@ PROCESS_THREAD(ranging_process, ev, data)
     /* Check that the addresses match the initiator's expectations */
     if(linkaddr_cmp(&resp_src, &resp) && linkaddr_cmp(&resp_dst, &linkaddr_node_addr)) {
 
+      /* Wait for the responder only as long as it needs from now on */
+      rx_timeout[dest] = (resp_msg.resp_delay[0] | (resp_msg.resp_delay[1] << 8)) + RX_TIMEOUT_MARGIN;
+
+#if APP_DSTWR
+      /* DS-TWR: the responder computes the time of flight and prints the distance */
+      PROCESS_PT_SPAWN(&child, rng_dstwr_send_final(&child, &resp, seqn));
+#else
+
       /* Get init TX and resp RX timestamps */
       uint64_t init_tx_ts, resp_rx_ts;
       init_tx_ts = get_tx_timestamp(); // Time at which the initiator sent the init message
@@ -162,26 +244,32 @@ PROCESS_THREAD(ranging_process, ev, data)
        *              \                          /
        * RESP     init_rx_ts <-- t_two ---> resp_tx_ts
        */
-      int64_t t_one, t_two;
-      double tof; // needs to be in seconds
+      uint64_t t_one, t_two;
       // ...
-      t_one = (resp_rx_ts - init_tx_ts) % DWT_VALUES;
-      t_two = (resp_tx_ts - init_rx_ts) % DWT_VALUES;
-      tof = ((t_one - t_two) / 2.0) * DWT_TIME_UNITS;
+      t_one = ts_interval(init_tx_ts, resp_rx_ts);
+      t_two = ts_interval(init_rx_ts, resp_tx_ts);
 
       /* TO-DO 3: Based on the time of flight, compute the actual distance!
        * TIP: You can get the speed of light in air from the macro SPEED_OF_LIGHT (m/s) in rng-support.h
+       * Done in fixed point (no FPU on the MCU), see DTU_TO_MM_Q16 in rng-tof.h.
        */
-      double dist;
-      uint64_t dist_mm;  // In millimeters
+      int32_t dist_mm;  // In millimeters
       // ...
-      dist = (tof * SPEED_OF_LIGHT);
-      dist_mm = (uint64_t)(dist * 1000);
+      dist_mm = sstwr_dist_mm(t_one, t_two, RESP_CLOCK_OFFSET(&resp_msg, resp_len));
+#if APP_TOF_BENCH && CPU_REPORT_ROUNDS
+      if(seqn % CPU_REPORT_ROUNDS == 0) {
+        print_tof_bench(t_one, t_two);
+      }
+#endif
 
-      printf("RANGING OK [%02x:%02x->%02x:%02x] %llu mm\n",
+      printf("RANGING OK [%02x:%02x->%02x:%02x] %ld mm %lu us\n",
         linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
         resp.u8[0], resp.u8[1],
-        dist_mm);
+        (long)dist_mm, (unsigned long)dtu_to_us(t_one));
+      rng_peers_range(dest, dist_mm, seqn, NULL);
+#endif
+      /* Once the timed part of the exchange is over */
+      rng_payload_receive(resp_msg.ext, resp_len - RESP_MSG_MIN_LEN, &resp);
     }
     else {
       printf("[%u] fail [%02x%02x->%02x%02x]\n",
@@ -0,0 +1,23 @@
+#include "rng-math.h"
+/*---------------------------------------------------------------------------*/
+uint32_t
+isqrt64(uint64_t x)
+{
+  uint64_t res = 0, bit = 1ULL << 62;
+
+  while(bit > x) {
+    bit >>= 2;
+  }
+  while(bit) {
+    if(x >= res + bit) {
+      x -= res + bit;
+      res = (res >> 1) + bit;
+    }
+    else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)res;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,11 @@
+#ifndef RNG_MATH_H
+#define RNG_MATH_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/****** Integer helpers shared by the ranging modules (no FPU on the nodes) ******/
+
+/* Integer square root, rounded down */
+uint32_t isqrt64(uint64_t x);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_MATH_H */
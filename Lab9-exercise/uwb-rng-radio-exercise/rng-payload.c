@@ -0,0 +1,134 @@
+#include "dw1000.h"
+#include "rng-support.h"
+#include "rng-payload.h"
+#include <stdio.h>
+#include <string.h>
+/*---------------------------------------------------------------------------*/
+#if APP_PIGGYBACK
+/* Airtime of one more data byte, with the Reed-Solomon parity (48 bits per 330) */
+#if DW1000_CONF_DATA_RATE == DWT_BR_110K
+#define NS_PER_BYTE (75187)
+#elif DW1000_CONF_DATA_RATE == DWT_BR_850K
+#define NS_PER_BYTE (9398)
+#else
+#define NS_PER_BYTE (1175)
+#endif
+/*---------------------------------------------------------------------------*/
+typedef struct {
+  linkaddr_t dst;          // linkaddr_null for any peer
+  uint8_t len;
+  uint8_t data[RNG_PAYLOAD_MAX_LEN];
+} payload_t;
+
+static payload_t queue[RNG_PAYLOAD_QUEUE]; // Circular, oldest at head
+static uint8_t head, count;
+static int8_t pending = -1; // Entry put in the message being sent, -1 if none
+static rng_payload_cb_t callback;
+
+/* Since the last report */
+static uint16_t tx_msgs, rx_msgs, dropped;
+static uint32_t tx_bytes, rx_bytes;
+/*---------------------------------------------------------------------------*/
+uint8_t
+rng_payload_send(const linkaddr_t *dst, const void *data, uint8_t len)
+{
+  payload_t *p;
+
+  if(len == 0 || len > RNG_PAYLOAD_MAX_LEN || count == RNG_PAYLOAD_QUEUE) {
+    dropped++;
+    return 0;
+  }
+  p = &queue[(head + count) % RNG_PAYLOAD_QUEUE];
+  linkaddr_copy(&p->dst, dst != NULL ? dst : &linkaddr_null);
+  p->len = len;
+  memcpy(p->data, data, len);
+  count++;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_payload_set_callback(rng_payload_cb_t cb)
+{
+  callback = cb;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rng_payload_put(uint8_t *ext, uint8_t ext_len, const linkaddr_t *dst)
+{
+  payload_t *p;
+  uint8_t i, new_len;
+
+  pending = -1;
+  for(i = 0; i < count; i++) {
+    p = &queue[(head + i) % RNG_PAYLOAD_QUEUE];
+    if(linkaddr_cmp(&p->dst, dst) || linkaddr_cmp(&p->dst, &linkaddr_null)) {
+      new_len = rng_ext_put(ext, ext_len, RNG_EXT_PAYLOAD, p->data, p->len);
+      if(new_len != ext_len) {
+        pending = (head + i) % RNG_PAYLOAD_QUEUE;
+      }
+      return new_len;
+    }
+  }
+  return ext_len;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_payload_sent(uint8_t ok)
+{
+  uint8_t i, next;
+
+  if(pending < 0 || !ok) {
+    pending = -1;
+    return;
+  }
+  tx_msgs++;
+  tx_bytes += queue[pending].len;
+
+  /* Remove the entry, keeping the order of the others */
+  for(i = (pending - head + RNG_PAYLOAD_QUEUE) % RNG_PAYLOAD_QUEUE; i > 0; i--) {
+    next = (head + i) % RNG_PAYLOAD_QUEUE;
+    queue[next] = queue[(head + i - 1) % RNG_PAYLOAD_QUEUE];
+  }
+  head = (head + 1) % RNG_PAYLOAD_QUEUE;
+  count--;
+  pending = -1;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_payload_receive(const uint8_t *ext, uint8_t ext_len, const linkaddr_t *src)
+{
+  const uint8_t *data;
+  uint8_t len, i;
+
+  data = rng_ext_get(ext, ext_len, RNG_EXT_PAYLOAD, &len);
+  if(data == NULL || len == 0) {
+    return;
+  }
+  rx_msgs++;
+  rx_bytes += len;
+  if(callback != NULL) {
+    callback(src, data, len);
+    return;
+  }
+  printf("PAYLOAD [%02x:%02x] %u bytes:", src->u8[0], src->u8[1], len);
+  for(i = 0; i < len; i++) {
+    printf(" %02x", data[i]);
+  }
+  printf("\n");
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_payload_report(void)
+{
+  /* Each field adds its data and the type and length bytes */
+  uint32_t airtime_ns = (tx_bytes + 2UL * tx_msgs) * NS_PER_BYTE;
+
+  printf("PIGGYBACK sent %u msgs %lu bytes (+%lu.%lu us airtime, 0 extra exchanges), "
+         "received %u msgs %lu bytes, %u dropped, %u queued\n",
+         tx_msgs, (unsigned long)tx_bytes, (unsigned long)(airtime_ns / 1000),
+         (unsigned long)(airtime_ns % 1000 / 100), rx_msgs, (unsigned long)rx_bytes, dropped, count);
+  tx_msgs = rx_msgs = dropped = 0;
+  tx_bytes = rx_bytes = 0;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* APP_PIGGYBACK */
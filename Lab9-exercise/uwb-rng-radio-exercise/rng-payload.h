@@ -0,0 +1,54 @@
+#ifndef RNG_PAYLOAD_H
+#define RNG_PAYLOAD_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+#include "core/net/linkaddr.h"
+/*---------------------------------------------------------------------------*/
+/****** Application data piggybacked on the ranging messages ******/
+
+/* With APP_PIGGYBACK, data queued by the application (e.g. sensor readings of
+ * the anchors) rides in an RNG_EXT_PAYLOAD field of the next init or resp
+ * message to its destination: no extra exchange, only a slightly longer frame.
+ * One field per message, sent at most once: the data is lost with the message
+ * if it is not received. The receiver hands it to the callback.
+ */
+#define RNG_PAYLOAD_MAX_LEN (16)  // Data per message, in bytes
+#define RNG_PAYLOAD_QUEUE (4)     // Queued messages
+
+/* Data received from src */
+typedef void (*rng_payload_cb_t)(const linkaddr_t *src, const uint8_t *data, uint8_t len);
+
+#if APP_PIGGYBACK
+/* Queue len bytes of data for dst, or for the next ranging peer if dst is
+ * NULL. Returns 0 if the queue is full or len exceeds RNG_PAYLOAD_MAX_LEN. */
+uint8_t rng_payload_send(const linkaddr_t *dst, const void *data, uint8_t len);
+
+/* Set the function called with the received data (by default, it is printed) */
+void rng_payload_set_callback(rng_payload_cb_t cb);
+
+/* For the ranging processes: append the oldest data queued for dst to the
+ * ext area of a message, of which ext_len bytes are used. Returns the new used
+ * length. The data leaves the queue once rng_payload_sent() confirms the TX. */
+uint8_t rng_payload_put(uint8_t *ext, uint8_t ext_len, const linkaddr_t *dst);
+
+/* Outcome of the transmission of the message prepared by rng_payload_put():
+ * the data is dropped from the queue if sent, kept for the next message otherwise */
+void rng_payload_sent(uint8_t ok);
+
+/* Deliver the payload field of the ext area of a message received from src, if any */
+void rng_payload_receive(const uint8_t *ext, uint8_t ext_len, const linkaddr_t *src);
+
+/* Print the bytes piggybacked and received since the previous call, with the
+ * airtime they added to the ranging messages */
+void rng_payload_report(void);
+#else
+/* Without APP_PIGGYBACK, the ranging messages carry no data */
+#define rng_payload_send(dst, data, len) 0
+#define rng_payload_set_callback(cb)
+#define rng_payload_put(ext, ext_len, dst) (ext_len)
+#define rng_payload_sent(ok)
+#define rng_payload_receive(ext, ext_len, src)
+#define rng_payload_report()
+#endif
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_PAYLOAD_H */
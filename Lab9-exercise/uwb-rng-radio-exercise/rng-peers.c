@@ -0,0 +1,150 @@
+#include "contiki.h"
+#include <stdio.h>
+#include "rng-peers.h"
+#include "rng-rate.h"
+/*---------------------------------------------------------------------------*/
+#define CLOCK_MS() ((uint32_t)((uint64_t)clock_time() * 1000 / CLOCK_SECOND))
+/*---------------------------------------------------------------------------*/
+static const linkaddr_t *peers; // Address of each responder
+static uint8_t num_peers;
+#if APP_RNG_FILTER && !APP_DSTWR
+static rng_filter_t filters[RNG_PEERS_MAX]; // Distance filter of each responder
+#endif
+#if APP_ADAPTIVE_RATE
+static rng_rate_t rates[RNG_PEERS_MAX]; // Ranging rate of each responder
+static uint16_t rate_ticks; // Scheduling ticks since the last report
+#endif
+#if RNG_POS
+static const rng_pos_t *anchor_pos; // Position of each responder
+static int32_t ranges[RNG_PEERS_MAX]; // Latest distance to each responder, in mm
+static uint8_t range_seqn[RNG_PEERS_MAX]; // Round of the latest distance
+static uint8_t range_valid[RNG_PEERS_MAX];
+static rng_pos_fix_t fix;
+static uint8_t fix_valid;
+#endif
+/*---------------------------------------------------------------------------*/
+void
+rng_peers_init(const linkaddr_t *resp, const rng_pos_t *anchors, uint8_t n)
+{
+  peers = resp;
+  num_peers = n;
+#if APP_ADAPTIVE_RATE
+  uint8_t i;
+
+  for(i = 0; i < n; i++) {
+    rng_rate_reset(&rates[i], CLOCK_MS());
+  }
+#endif
+#if RNG_POS
+  anchor_pos = anchors;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+int
+rng_peers_due(void)
+{
+#if APP_ADAPTIVE_RATE
+  int due;
+
+  rate_ticks++;
+  due = rng_rate_next(rates, num_peers, CLOCK_MS());
+  if(due >= 0) {
+    rng_rate_attempt(&rates[due], CLOCK_MS());
+  }
+  return due;
+#else
+  return -1;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_peers_round(uint8_t seqn)
+{
+#if RNG_POS
+  rng_pos_t used[RNG_PEERS_MAX];
+  int32_t used_ranges[RNG_PEERS_MAX];
+  uint32_t cycles;
+  uint8_t i, n = 0;
+
+  for(i = 0; i < num_peers; i++) {
+#if APP_ADAPTIVE_RATE
+    /* A range is as fresh as the rate of its responder requires until it is due */
+    if(range_valid[i] && (int32_t)(CLOCK_MS() - rates[i].due_ms) < RNG_RATE_MIN_MS) {
+#else
+    /* Only the ranges of the last round-robin cycle */
+    if(range_valid[i] && (uint8_t)(seqn - range_seqn[i]) < num_peers) {
+#endif
+      used[n] = anchor_pos[i];
+      used_ranges[n++] = ranges[i];
+    }
+  }
+
+  cycles = cycle_counter_read();
+  fix_valid = rng_pos_solve(used, used_ranges, n, fix_valid ? &fix.pos : NULL, &fix);
+  cycles = cycle_counter_read() - cycles;
+  if(fix_valid) {
+    printf("POSITION [%02x:%02x] %ld %ld mm res %lu mm it %u %lu cycles %lu ms\n",
+      linkaddr_node_addr.u8[0], linkaddr_node_addr.u8[1],
+      (long)fix.pos.x, (long)fix.pos.y, (unsigned long)fix.residual, fix.iterations,
+      (unsigned long)cycles, (unsigned long)CLOCK_MS());
+  }
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_peers_range(uint8_t idx, int32_t dist_mm, uint8_t seqn, const rx_diag_t *diag)
+{
+#if APP_RX_DIAG
+  rx_diag_t rx_diag;
+
+  if(diag == NULL) {
+    read_rx_diag(&rx_diag);
+    diag = &rx_diag;
+  }
+  print_rx_diag(&linkaddr_node_addr, &peers[idx], diag);
+#else
+  diag = NULL; // All the ranges have the same weight
+#endif
+#if APP_RNG_FILTER && !APP_DSTWR
+  uint16_t meas_std = diag ? rx_diag_meas_std(diag) : RNG_FILTER_MEAS_STD;
+#if APP_ADAPTIVE_RATE
+  rng_filter_out_t est;
+  int32_t raw_mm = dist_mm;
+
+  dist_mm = print_filtered(&filters[idx], &linkaddr_node_addr, &peers[idx], dist_mm, meas_std, &est);
+  rng_rate_update(&rates[idx], raw_mm, est.dist, est.speed, est.speed_std, CLOCK_MS());
+#else
+  dist_mm = print_filtered(&filters[idx], &linkaddr_node_addr, &peers[idx], dist_mm, meas_std, NULL);
+#endif
+#endif
+#if RNG_POS
+  ranges[idx] = dist_mm;
+  range_seqn[idx] = seqn;
+  range_valid[idx] = 1;
+#if !APP_BCAST_INIT
+  rng_peers_round(seqn);
+#endif
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_peers_report(uint16_t exchanges)
+{
+#if APP_ADAPTIVE_RATE
+  /* Exchanges saved with respect to ranging every ranging interval, the
+   * current interval of each responder and the RMS error of the predicted
+   * distances (how far the estimates drifted between two ranges) */
+  uint32_t baseline = rate_ticks / RNG_PEERS_TICKS;
+  uint8_t i;
+
+  printf("RATE %u exchanges, %lu at fixed rate (%ld%% saved), intervals",
+    exchanges, (unsigned long)baseline,
+    baseline ? (long)(100 - (int32_t)exchanges * 100 / (int32_t)baseline) : 0L);
+  for(i = 0; i < num_peers; i++) {
+    printf(" %lu", (unsigned long)rates[i].interval_ms);
+  }
+  printf(" ms, tracking error %lu mm rms\n", (unsigned long)rng_rate_err_rms(rates, num_peers));
+  rate_ticks = 0;
+#endif
+}
+/*---------------------------------------------------------------------------*/
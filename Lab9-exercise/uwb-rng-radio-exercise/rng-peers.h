@@ -0,0 +1,52 @@
+#ifndef RNG_PEERS_H
+#define RNG_PEERS_H
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "core/net/linkaddr.h"
+#include "rng-support.h"
+#include "rng-pos.h"
+/*---------------------------------------------------------------------------*/
+/****** Processing of the SS-TWR distances on the initiator ******/
+
+/* Each distance to a responder goes through the enabled features: receive
+ * diagnostics (APP_RX_DIAG), distance filter (APP_RNG_FILTER, rng-filter.h)
+ * and ranging rate (APP_ADAPTIVE_RATE, rng-rate.h). The position of the
+ * initiator (APP_RNG_POS, rng-pos.h) follows from the latest distances to all
+ * the responders. Nothing happens with APP_DSTWR, where the responders
+ * compute the distances.
+ */
+#define RNG_PEERS_MAX RNG_POS_MAX_ANCHORS // Responders
+#define RNG_POS (APP_RNG_POS && !APP_DSTWR)
+
+#if APP_ADAPTIVE_RATE
+#if APP_BCAST_INIT || APP_DSTWR || APP_TDMA || !APP_RNG_FILTER
+#error The adaptive ranging rate needs unicast SS-TWR, without APP_TDMA, and APP_RNG_FILTER
+#endif
+#if APP_RESP_DUTY_CYCLE
+#error Duty-cycled responders expect a fixed ranging period
+#endif
+#define RNG_PEERS_TICKS (4) // Scheduling ticks per ranging interval: a due responder is ranged at the next one
+#else
+#define RNG_PEERS_TICKS (1)
+#endif
+
+/* Start without any distance to the n responders, anchors holding their
+ * positions in mm (used with APP_RNG_POS only) */
+void rng_peers_init(const linkaddr_t *resp, const rng_pos_t *anchors, uint8_t n);
+
+/* With APP_ADAPTIVE_RATE, called at each scheduling tick: index of the most
+ * overdue responder to range now, -1 if none is due */
+int rng_peers_due(void);
+
+/* New raw distance to responder idx in round seqn. The receive diagnostics
+ * of its resp message are read from the radio if diag is NULL. Without
+ * APP_BCAST_INIT, the position is updated as well. */
+void rng_peers_range(uint8_t idx, int32_t dist_mm, uint8_t seqn, const rx_diag_t *diag);
+
+/* End of a broadcast round: position from the distances to all the responders */
+void rng_peers_round(uint8_t seqn);
+
+/* Print the statistics of the ranging rate over the last exchanges */
+void rng_peers_report(uint16_t exchanges);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_PEERS_H */
@@ -0,0 +1,132 @@
+/*
+ * Host build of the position solver (make rng-pos-host), to validate it
+ * against logged data: replays the RANGING OK lines of a log with the anchor
+ * positions of the deployment map, the same way the initiator does with
+ * APP_RNG_POS, and compares each fix with the true initiator position.
+ *
+ * Usage: ./rng-pos-host LOG [MAP_CSV]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "rng-pos.h"
+#include "host/map.h"
+/*---------------------------------------------------------------------------*/
+/* Position of a map node as the solver sees it, in whole mm */
+static rng_pos_t
+node_pos(const struct map_node *node)
+{
+  rng_pos_t pos = { (int32_t)lround(node->x * 1000), (int32_t)lround(node->y * 1000) };
+  return pos;
+}
+/*---------------------------------------------------------------------------*/
+static int
+cmp_double(const void *a, const void *b)
+{
+  double d = *(const double *)a - *(const double *)b;
+  return (d > 0) - (d < 0);
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  char line[512], init[6], resp[6];
+  const struct map_node *init_node = NULL, *resp_node;
+  rng_pos_t anchors[RNG_POS_MAX_ANCHORS], used[RNG_POS_MAX_ANCHORS], prev;
+  int32_t ranges[RNG_POS_MAX_ANCHORS], used_ranges[RNG_POS_MAX_ANCHORS];
+  long last_range[RNG_POS_MAX_ANCHORS];
+  const struct map_node *anchor_nodes[RNG_POS_MAX_ANCHORS];
+  int num_anchors = 0, i, n, have_prev = 0;
+  long num_ranges = 0, num_fixes = 0, iterations = 0, dist;
+  double *errors = NULL, err_sum = 0, elapsed_ns = 0;
+  struct timespec t0, t1;
+  rng_pos_fix_t fix;
+  rng_pos_t init_pos;
+  char *p;
+  FILE *f;
+
+  if(argc < 2) {
+    fprintf(stderr, "Usage: %s LOG [MAP_CSV]\n", argv[0]);
+    return 1;
+  }
+  if(!map_load(argc > 2 ? argv[2] : "DEPT_evb1000_map.csv")) {
+    fprintf(stderr, "Cannot read the deployment map\n");
+    return 1;
+  }
+  if(!(f = fopen(argv[1], "r"))) {
+    fprintf(stderr, "Cannot open %s\n", argv[1]);
+    return 1;
+  }
+
+  while(fgets(line, sizeof(line), f)) {
+    p = strstr(line, "RANGING OK [");
+    if(!p || sscanf(p, "RANGING OK [%5[0-9a-f:]->%5[0-9a-f:]] %ld mm", init, resp, &dist) != 3) {
+      continue;
+    }
+    if(!init_node) {
+      init_node = map_find(init);
+    }
+    resp_node = map_find(resp);
+    if(!init_node || !resp_node || strncmp(init_node->addr, init, 5) != 0) {
+      continue; // Unknown node, or another initiator
+    }
+    num_ranges++;
+
+    /* Latest range to each anchor, in order of appearance */
+    for(i = 0; i < num_anchors && anchor_nodes[i] != resp_node; i++);
+    if(i == num_anchors) {
+      if(num_anchors == RNG_POS_MAX_ANCHORS) {
+        continue;
+      }
+      anchor_nodes[num_anchors] = resp_node;
+      anchors[num_anchors] = node_pos(resp_node);
+      num_anchors++;
+    }
+    ranges[i] = (int32_t)dist;
+    last_range[i] = num_ranges;
+
+    /* As on the initiator: the ranges of the last round-robin cycle */
+    for(i = 0, n = 0; i < num_anchors; i++) {
+      if(num_ranges - last_range[i] < num_anchors) {
+        used[n] = anchors[i];
+        used_ranges[n++] = ranges[i];
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    if(!rng_pos_solve(used, used_ranges, n, have_prev ? &prev : NULL, &fix)) {
+      continue;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed_ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+    prev = fix.pos;
+    have_prev = 1;
+
+    errors = realloc(errors, (num_fixes + 1) * sizeof(double));
+    init_pos = node_pos(init_node);
+    errors[num_fixes] = hypot(fix.pos.x - init_pos.x, fix.pos.y - init_pos.y);
+    err_sum += errors[num_fixes];
+    iterations += fix.iterations;
+    printf("POSITION %ld %ld mm error %.0f mm res %lu mm it %u\n",
+           (long)fix.pos.x, (long)fix.pos.y, errors[num_fixes],
+           (unsigned long)fix.residual, fix.iterations);
+    num_fixes++;
+  }
+  fclose(f);
+
+  if(num_fixes == 0) {
+    printf("No position fix (%ld ranges, at least 3 anchors needed)\n", num_ranges);
+    return 1;
+  }
+  qsort(errors, num_fixes, sizeof(double), cmp_double);
+  printf("%ld fixes from %ld ranges (%.2f fixes per range), %d anchors\n",
+         num_fixes, num_ranges, (double)num_fixes / num_ranges, num_anchors);
+  printf("Position error: mean %.0f mm, median %.0f mm, p95 %.0f mm\n",
+         err_sum / num_fixes, errors[num_fixes / 2], errors[num_fixes * 95 / 100]);
+  printf("Solver: %.1f iterations, %.0f ns per fix on this host\n",
+         (double)iterations / num_fixes, elapsed_ns / num_fixes);
+  free(errors);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,77 @@
+#include "rng-pos.h"
+#include "rng-math.h"
+#include <stddef.h>
+/*---------------------------------------------------------------------------*/
+int
+rng_pos_solve(const rng_pos_t *anchors, const int32_t *ranges, uint8_t n,
+              const rng_pos_t *guess, rng_pos_fix_t *fix)
+{
+  int64_t jtj_xx, jtj_xy, jtj_yy, jtr_x, jtr_y, det, dx, dy, sq_res;
+  int32_t ux, uy, res;
+  uint32_t norm;
+  uint8_t i, it;
+
+  if(n < 3 || n > RNG_POS_MAX_ANCHORS) {
+    return 0;
+  }
+  if(guess) {
+    fix->pos = *guess;
+  }
+  else {
+    dx = dy = 0;
+    for(i = 0; i < n; i++) {
+      dx += anchors[i].x;
+      dy += anchors[i].y;
+    }
+    fix->pos.x = dx / n;
+    fix->pos.y = dy / n;
+  }
+
+  for(it = 1; it <= RNG_POS_MAX_ITER; it++) {
+    /* Normal equations of the linearized ranges: J^T J delta = J^T r,
+     * J rows are the unit vectors from the anchors to the current estimate */
+    jtj_xx = jtj_xy = jtj_yy = jtr_x = jtr_y = sq_res = 0;
+    for(i = 0; i < n; i++) {
+      dx = fix->pos.x - anchors[i].x;
+      dy = fix->pos.y - anchors[i].y;
+      norm = isqrt64(dx * dx + dy * dy);
+      if(norm == 0) {
+        norm = 1; // On top of an anchor, any direction will do
+        dx = 1;
+      }
+      ux = dx * (1 << RNG_POS_Q) / norm;
+      uy = dy * (1 << RNG_POS_Q) / norm;
+      res = ranges[i] - (int32_t)norm;
+      if(res > RNG_POS_MAX_RES) {
+        res = RNG_POS_MAX_RES;
+      }
+      else if(res < -RNG_POS_MAX_RES) {
+        res = -RNG_POS_MAX_RES;
+      }
+      jtj_xx += (int64_t)ux * ux;
+      jtj_xy += (int64_t)ux * uy;
+      jtj_yy += (int64_t)uy * uy;
+      jtr_x += (int64_t)ux * res;
+      jtr_y += (int64_t)uy * res;
+      sq_res += (int64_t)res * res;
+    }
+
+    /* J^T J is in Q(2q), its determinant in Q(4q): scaling the determinant
+     * down by Q(q) leaves the correction in mm */
+    det = (jtj_xx * jtj_yy - jtj_xy * jtj_xy) >> RNG_POS_Q;
+    if(det <= 0) {
+      return 0; // Anchors (almost) aligned with the estimate
+    }
+    dx = (jtj_yy * jtr_x - jtj_xy * jtr_y) / det;
+    dy = (jtj_xx * jtr_y - jtj_xy * jtr_x) / det;
+    fix->pos.x += dx;
+    fix->pos.y += dy;
+    if(dx * dx + dy * dy < RNG_POS_CONVERGED * RNG_POS_CONVERGED) {
+      break;
+    }
+  }
+  fix->iterations = it > RNG_POS_MAX_ITER ? RNG_POS_MAX_ITER : it;
+  fix->residual = isqrt64(sq_res / n); // Of the last linearization point
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,38 @@
+#ifndef RNG_POS_H
+#define RNG_POS_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/****** 2D multilateration, independent of the radio ******/
+
+/* Gauss-Newton least squares on the ranges to known anchors, in integer
+ * arithmetic only (the initiator MCU has no FPU): positions and distances in
+ * mm, unit vectors in Q(RNG_POS_Q). Each iteration solves the 2x2 normal
+ * equations in closed form. At most RNG_POS_MAX_ANCHORS ranges, with the
+ * residuals clamped to +-RNG_POS_MAX_RES, keep every intermediate value within
+ * 64 bits: the J^T J * J^T r products stay below 2^(3 + 2q) * 2^(3 + q + 17) = 2^59.
+ */
+#define RNG_POS_Q (12)
+#define RNG_POS_MAX_ANCHORS (8)
+#define RNG_POS_MAX_RES (1L << 17) // mm, larger residuals only slow down the first steps
+#define RNG_POS_MAX_ITER (10)
+#define RNG_POS_CONVERGED (5)  // Stop when the correction is shorter than this, in mm
+
+typedef struct {
+  int32_t x, y;                // mm
+} rng_pos_t;
+
+typedef struct {
+  rng_pos_t pos;               // Estimated position, mm
+  uint32_t residual;           // RMS of the range residuals, mm
+  uint8_t iterations;
+} rng_pos_fix_t;
+
+/* Estimate the position from n ranges (mm) to the anchors, starting from
+ * *guess (e.g., the previous fix) or from the anchor centroid if guess is NULL.
+ * Returns 0 if there are fewer than 3 ranges or the geometry is degenerate.
+ */
+int rng_pos_solve(const rng_pos_t *anchors, const int32_t *ranges, uint8_t n,
+                  const rng_pos_t *guess, rng_pos_fix_t *fix);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_POS_H */
@@ -0,0 +1,102 @@
+#include "rng-rate.h"
+#include "rng-math.h"
+/*---------------------------------------------------------------------------*/
+#define MAX_ERR (46340) // Larger prediction errors are clipped, their square fits 32 bits
+#define NOISE_VAR ((uint32_t)RNG_RATE_NOISE_MM * RNG_RATE_NOISE_MM)
+/*---------------------------------------------------------------------------*/
+void
+rng_rate_reset(rng_rate_t *r, uint32_t now_ms)
+{
+  r->interval_ms = RNG_RATE_MIN_MS;
+  r->due_ms = now_ms;
+  r->err_var = 0;
+  r->valid = 0;
+  r->ranges = 0;
+  r->err_sum = 0;
+}
+/*---------------------------------------------------------------------------*/
+void
+rng_rate_attempt(rng_rate_t *r, uint32_t now_ms)
+{
+  r->due_ms = now_ms + RNG_RATE_MIN_MS;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+rng_rate_update(rng_rate_t *r, int32_t raw_mm, int32_t dist_mm, int32_t speed, uint16_t speed_std,
+                uint32_t now_ms)
+{
+  int64_t err;
+  uint32_t target, abs_speed = speed < 0 ? -speed : speed;
+
+  if(r->valid) {
+    /* Error of the distance predicted at the last range */
+    err = raw_mm - (r->last_dist + (int64_t)r->last_speed * (int32_t)(now_ms - r->last_ms) / 1000);
+    err = err > MAX_ERR ? MAX_ERR : (err < -MAX_ERR ? -MAX_ERR : err);
+    r->err_var = r->err_var - r->err_var / 4 + (uint32_t)(err * err) / 4;
+    r->err_sum += (uint64_t)(err * err);
+    r->ranges++;
+  }
+
+  /* Time for the distance to change by RNG_RATE_TOL_MM at the current speed */
+  if(abs_speed <= (uint32_t)RNG_RATE_SPEED_SIGMA * speed_std) {
+    abs_speed = 0;
+    speed = 0; // Nor extrapolated for the next prediction
+  }
+  target = abs_speed > 0 ? (uint32_t)RNG_RATE_TOL_MM * 1000 / abs_speed : RNG_RATE_MAX_MS;
+  target = target > RNG_RATE_MAX_MS ? RNG_RATE_MAX_MS : target;
+
+  if(r->valid && r->err_var > NOISE_VAR) {
+    r->interval_ms /= 2;
+  }
+  else if(target < r->interval_ms) {
+    r->interval_ms = target;
+  }
+  else {
+    r->interval_ms += r->interval_ms / 2;
+    r->interval_ms = r->interval_ms > target ? target : r->interval_ms;
+  }
+  if(r->interval_ms < RNG_RATE_MIN_MS) {
+    r->interval_ms = RNG_RATE_MIN_MS;
+  }
+
+  r->last_ms = now_ms;
+  r->last_dist = dist_mm;
+  r->last_speed = speed;
+  r->valid = 1;
+  r->due_ms = now_ms + r->interval_ms;
+  return r->interval_ms;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+rng_rate_err_rms(rng_rate_t *r, uint8_t n)
+{
+  uint64_t err_sum = 0;
+  uint32_t ranges = 0;
+  uint8_t i;
+
+  for(i = 0; i < n; i++) {
+    err_sum += r[i].err_sum;
+    ranges += r[i].ranges;
+    r[i].err_sum = 0;
+    r[i].ranges = 0;
+  }
+  return ranges ? isqrt64(err_sum / ranges) : 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+rng_rate_next(const rng_rate_t *r, uint8_t n, uint32_t now_ms)
+{
+  int best = -1;
+  int32_t late, best_late = -1;
+  uint8_t i;
+
+  for(i = 0; i < n; i++) {
+    late = (int32_t)(now_ms - r[i].due_ms);
+    if(late >= 0 && late > best_late) {
+      best = i;
+      best_late = late;
+    }
+  }
+  return best;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,56 @@
+#ifndef RNG_RATE_H
+#define RNG_RATE_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+/****** Adaptive ranging rate, one instance per ranging peer ******/
+
+/* The interval until the next range to a peer is sized so that the distance
+ * changes by about RNG_RATE_TOL_MM in between, from the filtered radial speed
+ * (see rng-filter.h) if it differs from 0 by more than RNG_RATE_SPEED_SIGMA
+ * standard deviations, up to RNG_RATE_MAX_MS otherwise. The prediction of each new distance from the previous
+ * estimate is checked: while the RMS of the prediction errors exceeds
+ * RNG_RATE_NOISE_MM (the target manoeuvres, or the estimate is off), the
+ * interval is halved at each range. The interval shrinks at once to follow a
+ * faster target but only grows by half at a time, within the bounds below.
+ *
+ * Times in ms from any clock (may wrap), distances in mm, speeds in mm/s.
+ */
+#define RNG_RATE_MIN_MS (500)        // Shortest interval between two ranges to a peer
+#define RNG_RATE_MAX_MS (4000)       // Longest interval, when static. Below RNG_FILTER_MAX_DT to keep the filter running
+#define RNG_RATE_TOL_MM (200)        // Distance change allowed between two ranges
+#define RNG_RATE_NOISE_MM (300)      // RMS prediction error above which the interval is halved (3 RNG_FILTER_MEAS_STD)
+#define RNG_RATE_SPEED_SIGMA (2)     // Speeds within this many standard deviations from 0 are taken as static
+
+typedef struct {
+  uint32_t interval_ms;        // Current interval
+  uint32_t due_ms;             // Time of the next range
+  uint32_t last_ms;            // Time of the last estimate
+  int32_t last_dist;           // Last filtered distance, mm
+  int32_t last_speed;          // Last radial speed, mm/s
+  uint32_t err_var;            // Moving average of the squared prediction errors, mm^2
+  uint8_t valid;               // 0 until the first estimate
+  /* Statistics, see rng_rate_err_rms() */
+  uint16_t ranges;             // Predictions checked
+  uint64_t err_sum;            // Sum of the squared prediction errors, mm^2
+} rng_rate_t;
+
+/* Start without estimate, due at now_ms */
+void rng_rate_reset(rng_rate_t *r, uint32_t now_ms);
+
+/* A ranging attempt starts: if it fails, retry after RNG_RATE_MIN_MS */
+void rng_rate_attempt(rng_rate_t *r, uint32_t now_ms);
+
+/* New range: raw distance and filtered estimate (distance, speed and its
+ * standard deviation). Returns the interval until the next range, in ms. */
+uint32_t rng_rate_update(rng_rate_t *r, int32_t raw_mm, int32_t dist_mm, int32_t speed, uint16_t speed_std,
+                         uint32_t now_ms);
+
+/* RMS of the prediction errors of the n peers since the last call, in mm
+ * (0 without any), and restart the statistics */
+uint32_t rng_rate_err_rms(rng_rate_t *r, uint8_t n);
+
+/* Index of the most overdue of the n peers at now_ms, -1 if none is due */
+int rng_rate_next(const rng_rate_t *r, uint8_t n, uint32_t now_ms);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_RATE_H */
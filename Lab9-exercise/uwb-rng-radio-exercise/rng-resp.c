@@ -38,21 +38,41 @@
 #include "dw1000.h"
 #include "core/net/linkaddr.h"
 #include "rng-support.h"
+#include "rng-tof.h"
+#include "rng-bcast.h"
+#include "rng-dstwr.h"
+#include "rng-duty.h"
+#include "rng-delay.h"
 /*---------------------------------------------------------------------------*/
 PROCESS(ranging_resp_process, "Ranging responder process");
+#if APP_PIGGYBACK
+PROCESS(sensor_process, "Sensor process");
+AUTOSTART_PROCESSES(&ranging_resp_process, &sensor_process);
+#else
 AUTOSTART_PROCESSES(&ranging_resp_process);
+#endif
 /*---------------------------------------------------------------------------*/
-/* UWB microsecond (uus) to device time unit (dtu, around 15.65 ps) conversion factor.
- * 1 uus = 512 / 499.2 µs and 1 µs = 499.2 * 128 dtu. */
-#define UUS_TO_DWT_TIME (65536)
 #define RESP_DELAY (500) // Time to wait before sending the ranging reply (resp message) in ~us
-#define UWB_RESP_DELAY (RESP_DELAY * UUS_TO_DWT_TIME)
+/*---------------------------------------------------------------------------*/
+static uint16_t resp_delay = RESP_DELAY; // Reply delay of the next exchange, in ~us
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(ranging_resp_process, ev, data)
 {
   static sstwr_init_msg_t init_msg; // Init ranging message (i.e., the first message in the TWR exchange, sent by the initiator)
   static sstwr_resp_msg_t resp_msg; // Resp ranging message (i.e., the second message in the TWR exchange, sent by the responder)
   static uint8_t ret; // To check the TX/RX status
+  /* Kept across radio waits, which yield the process with APP_RADIO_IRQ */
+  static linkaddr_t init_src, init_dst;
+  static uint64_t init_rx_ts, resp_tx_ts, predicted_tx_ts;
+#if CPU_REPORT_ROUNDS
+  static uint16_t exchanges = 0; // Init messages received since the last CPU report
+#endif
+  static uint8_t slot = 0; // Reply slot, always 0 unless APP_BCAST_INIT
+  static uint8_t ext_len; // Extension fields used in the resp message
+  static uint16_t init_len; // Length of the init message, with its extension fields
+#if APP_RESP_DUTY_CYCLE || APP_DSTWR
+  static struct pt child; // Protothread of the enabled scheme, see PROCESS_PT_SPAWN()
+#endif
 
   PROCESS_BEGIN();
 
@@ -63,15 +83,38 @@ PROCESS_THREAD(ranging_resp_process, ev, data)
 
   /* Initialize the radio */
   radio_init();
+  rng_delay_init(RESP_DELAY);
+  rng_duty_init();
 
   while(1) {
 
+#if APP_RESP_DUTY_CYCLE
+    /* Once synchronized, the receiver is only on in the windows of the expected inits */
+    PROCESS_PT_SPAWN(&child, rng_duty_wait(&child));
+    start_rx(rng_duty_rx_timeout());
+#else
     /* Start the receiver immediately */
     start_rx(NO_RX_TIMEOUT);
+#endif
     printf("RX enabled\n");
 
     /* Wait for an init message */
-    ret = wait_rx();
+    RADIO_WAIT_RX(ret);
+
+    /* Beacons and slot requests (APP_TDMA) are for the initiators and the coordinator */
+    if(ret && (rx_msg_type() == RNG_MSG_TDMA_BEACON || rx_msg_type() == RNG_MSG_TDMA_REG)) {
+      continue;
+    }
+
+#if CPU_REPORT_ROUNDS
+    /* Report the CPU usage every CPU_REPORT_ROUNDS exchanges */
+    if(++exchanges == CPU_REPORT_ROUNDS) {
+      print_cpu_usage(exchanges);
+      rng_payload_report();
+      rng_duty_report();
+      exchanges = 0;
+    }
+#endif
 
     /* If the reception failed, abort and restart the procedure */
     if (!ret) {
@@ -81,17 +124,21 @@ PROCESS_THREAD(ranging_resp_process, ev, data)
     }
 
     /* Read the ranging init message */
-    ret = read_rx_data(&init_msg, sizeof(init_msg));
+#if APP_BCAST_INIT
+    init_len = rng_bcast_read_init(&init_msg, &slot);
+#else
+    init_len = read_rx_msg(&init_msg, RNG_MSG_INIT, INIT_MSG_MIN_LEN, sizeof(init_msg));
+#endif
+    ret = init_len > 0;
 
     /* If the message could not be read, abort and restart the procedure */
     if (!ret) {
       radio_reset();
-      printf("RX wrong size\n");
+      printf("RX wrong frame\n");
       continue;
     }
 
     /* Extract the packet source and destination addresses from the received message */
-    linkaddr_t init_src, init_dst;
     init_src.u8[0] = init_msg.hdr.src[1];
     init_src.u8[1] = init_msg.hdr.src[0];
     init_dst.u8[0] = init_msg.hdr.dst[1];
@@ -100,19 +147,19 @@ PROCESS_THREAD(ranging_resp_process, ev, data)
     /* Check if the destination is this node.
      * If so, send a resp message to complete the two-way ranging exchange */
     if(linkaddr_cmp(&init_dst, &linkaddr_node_addr)) {
+      rng_duty_init_received();
 
       /* TO-DO 1: Get the init RX timestamp and *compute* the resp TX time to schedule the resp transmission 
        * TIP: Remember that DW1000 timestamps are 40 bits long (DWT_VALUES in rng-support.h) */
-      uint64_t init_rx_ts, resp_tx_ts;
       // ...
       init_rx_ts = get_rx_timestamp();
-      resp_tx_ts = (init_rx_ts + UWB_RESP_DELAY) % DWT_VALUES;
+      resp_tx_ts = (init_rx_ts + ((uint64_t)resp_delay + slot * BCAST_SLOT) * UUS_TO_DWT_TIME) % DWT_VALUES;
 
       /* Set the source and destination addresses and the ranging sequence number in resp message */
-      fill_ieee_hdr(&resp_msg.hdr, &linkaddr_node_addr, &init_src, init_msg.hdr.seqn);
+      fill_hdr(&resp_msg.hdr, RNG_MSG_RESP, &linkaddr_node_addr, &init_src, init_msg.hdr.seqn);
 
       /* Predict the *actual* TX timestamp BEFORE sending */
-      uint64_t predicted_tx_ts = predict_tx_timestamp(resp_tx_ts);
+      predicted_tx_ts = predict_tx_timestamp(resp_tx_ts);
 
       /* TO-DO 2: Write the timestamps in the resp message.
        * TIP: Find and exploit the appropriate function in rng-support.h / rng-support.c.
@@ -120,23 +167,38 @@ PROCESS_THREAD(ranging_resp_process, ev, data)
       // ...
       resp_msg_set_timestamp(&resp_msg.init_rx_ts[0], init_rx_ts);
       resp_msg_set_timestamp(&resp_msg.resp_tx_ts[0], predicted_tx_ts);
+      resp_msg.resp_delay[0] = resp_delay & 0xFF;
+      resp_msg.resp_delay[1] = resp_delay >> 8;
+      ext_len = resp_msg_put_clock_offset(resp_msg.ext, 0);
+      ext_len = rng_payload_put(resp_msg.ext, ext_len, &init_src);
 
       /* TO-DO 3: Send the packet and wait for TX confirmation
        * TIP: Use ret = start_tx(...);
        */
       ret = start_tx(
         &resp_msg, 
-        sizeof(resp_msg), 
-        DWT_START_TX_DELAYED, 
-        0, 
+        RESP_MSG_MIN_LEN + ext_len, // Only the extension fields in use
+        RESP_TX_MODE, // In DS-TWR, keep the receiver on for the final message
+        FINAL_TIMEOUT, 
         resp_tx_ts
       );
+      resp_delay = rng_delay_update(resp_delay, ret);
+
+      /* The resp transmission is scheduled: time to hand the init payload over */
+      rng_payload_sent(ret);
+      rng_payload_receive(init_msg.ext, init_len - INIT_MSG_MIN_LEN, &init_src);
 
       /* Check the outcome of the transmission */
       if(ret) {
+        RADIO_WAIT_TX();
         printf("[%u] RESP %02x:%02x at %llu (ts: %llu->%llu)\n",
           init_msg.hdr.seqn, resp_msg.hdr.dst[1], resp_msg.hdr.dst[0],
-          get_tx_timestamp(), init_rx_ts, predicted_tx_ts);
+          (unsigned long long)get_tx_timestamp(), (unsigned long long)init_rx_ts,
+          (unsigned long long)predicted_tx_ts);
+#if APP_DSTWR
+        /* DS-TWR: wait for the final message of the same exchange and print the distance */
+        PROCESS_PT_SPAWN(&child, rng_dstwr_recv_final(&child, &init_msg, init_rx_ts));
+#endif
       }
       else {
         printf("[%u] RESP fail %02x:%02x\n",
@@ -151,3 +213,36 @@ PROCESS_THREAD(ranging_resp_process, ev, data)
   PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
+#if APP_PIGGYBACK
+/* Example producer of piggybacked data: a sample for the initiator every
+ * SENSOR_PERIOD, sent with the next resp message. In place of a real sensor
+ * reading, the sample is a counter and the uptime (little endian). */
+#define SENSOR_PERIOD (2 * CLOCK_SECOND)
+PROCESS_THREAD(sensor_process, ev, data)
+{
+  static struct etimer et;
+  static uint16_t sample = 0;
+  uint8_t msg[6];
+  unsigned long uptime;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&et, SENSOR_PERIOD);
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER && etimer_expired(&et));
+    etimer_reset(&et);
+    uptime = clock_seconds();
+    msg[0] = sample & 0xFF;
+    msg[1] = sample >> 8;
+    msg[2] = uptime & 0xFF;
+    msg[3] = (uptime >> 8) & 0xFF;
+    msg[4] = (uptime >> 16) & 0xFF;
+    msg[5] = (uptime >> 24) & 0xFF;
+    sample++;
+    rng_payload_send(NULL, msg, sizeof(msg));
+  }
+
+  PROCESS_END();
+}
+/*---------------------------------------------------------------------------*/
+#endif
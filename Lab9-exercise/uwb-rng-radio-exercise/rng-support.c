@@ -2,6 +2,9 @@
 #include "net/netstack.h"
 #include "dev/watchdog.h"
 #include "rng-support.h"
+#include "rng-tof.h"
+#include <stdio.h>
+#include <string.h>
 /*---------------------------------------------------------------------------*/
 #define DEBUG 0
 #if DEBUG
@@ -11,6 +14,44 @@
 #define PRINTF(...)
 #endif
 /*---------------------------------------------------------------------------*/
+linkaddr_t bcast_addr = {{0xff, 0xff}};
+/*---------------------------------------------------------------------------*/
+static const antenna_delay_t antenna_delays[] = {
+#include "antenna-delays.h"
+  {{{0x00, 0x00}}, ANTENNA_DELAY, ANTENNA_DELAY} // End of the table
+};
+static uint16_t tx_antenna_delay = ANTENNA_DELAY; // Of this node, for predict_tx_timestamp()
+static uint16_t rx_antenna_delay = ANTENNA_DELAY;
+/*---------------------------------------------------------------------------*/
+#if APP_RADIO_IRQ
+volatile uint8_t radio_events;
+static struct process *radio_process; // Process waiting for the radio
+/*---------------------------------------------------------------------------*/
+/* DW1000 callbacks, called by dwt_isr() in interrupt context
+ * (the driver has already cleared the corresponding status flags) */
+static void
+tx_done_cb(const dwt_cb_data_t *cb_data)
+{
+  radio_events |= RADIO_EV_TX_DONE;
+  process_poll(radio_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_ok_cb(const dwt_cb_data_t *cb_data)
+{
+  radio_events |= RADIO_EV_RX_OK;
+  process_poll(radio_process);
+}
+/*---------------------------------------------------------------------------*/
+static void
+rx_fail_cb(const dwt_cb_data_t *cb_data)
+{
+  PRINTF("RX failed. Status: %lx\n", cb_data->status);
+  radio_events |= RADIO_EV_RX_FAIL;
+  process_poll(radio_process);
+}
+#endif
+/*---------------------------------------------------------------------------*/
 uint64_t
 get_rx_timestamp(void)
 {
@@ -43,7 +84,7 @@ uint64_t
 predict_tx_timestamp(uint64_t tx_ts) {
 
   /* Obtain the actual transmission time of the DW1000 */
-  return (tx_ts & DWT_TX_BITMASK) + ANTENNA_DELAY;
+  return (tx_ts & DWT_TX_BITMASK) + tx_antenna_delay;
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -68,14 +109,17 @@ resp_msg_get_timestamp(uint8_t *ts_field, uint64_t *ts)
 }
 /*---------------------------------------------------------------------------*/
 void
-fill_ieee_hdr(ieee154_hdr_t *hdr, linkaddr_t *src, linkaddr_t *dst, uint8_t seqn)
+fill_hdr(rng_hdr_t *hdr, uint8_t msg_type, linkaddr_t *src, linkaddr_t *dst, uint8_t seqn)
 {
   /* Fill in the constant part of the TX buffer */
+#if !APP_SHORT_HDR
   hdr->fctrl[0] = 0x41;
   hdr->fctrl[1] = 0x88;
-  hdr->seqn = seqn;
   hdr->pan_id[0] = IEEE802154_PANID & 0xff;
   hdr->pan_id[1] = IEEE802154_PANID >> 8;
+#endif
+  hdr->type = RNG_HDR_TYPE(msg_type);
+  hdr->seqn = seqn;
   if(src != NULL) {
     hdr->src[0] = src->u8[1];
     hdr->src[1] = src->u8[0];
@@ -87,11 +131,54 @@ fill_ieee_hdr(ieee154_hdr_t *hdr, linkaddr_t *src, linkaddr_t *dst, uint8_t seqn
 }
 /*---------------------------------------------------------------------------*/
 uint8_t
+rng_ext_put(uint8_t *ext, uint8_t ext_len, uint8_t type, const void *value, uint8_t len)
+{
+  if(ext_len + 2 + len > RNG_EXT_MAX_LEN) {
+    return ext_len;
+  }
+  ext[ext_len] = type;
+  ext[ext_len + 1] = len;
+  memcpy(&ext[ext_len + 2], value, len);
+  return ext_len + 2 + len;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+rng_ext_get(const uint8_t *ext, uint8_t ext_len, uint8_t type, uint8_t *len)
+{
+  uint8_t i = 0;
+
+  /* Walk the fields, a truncated one ends the area */
+  while(i + 2 <= ext_len && i + 2 + ext[i + 1] <= ext_len) {
+    if(ext[i] == type) {
+      *len = ext[i + 1];
+      return &ext[i + 2];
+    }
+    i += 2 + ext[i + 1];
+  }
+  return NULL;
+}
+/*---------------------------------------------------------------------------*/
+const uint8_t *
+rng_ext_find(const uint8_t *ext, uint8_t ext_len, uint8_t type, uint8_t len)
+{
+  uint8_t found_len;
+  const uint8_t *value = rng_ext_get(ext, ext_len, type, &found_len);
+
+  return value != NULL && found_len == len ? value : NULL;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
 start_tx(void *data, uint8_t len, uint8_t mode, uint16_t rx_to, uint64_t tx_time)
 {
   /* Force the transceiver off to avoid having the receiver enabled while transmitting */
   dwt_forcetrxoff();
 
+#if APP_RADIO_IRQ
+  /* Events of this transmission (and of the reception that may follow) */
+  radio_events = 0;
+  radio_process = PROCESS_CURRENT();
+#endif
+
   /* Clean event flags */
   dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS | RX_WAIT_FLAGS);
 
@@ -120,6 +207,10 @@ start_tx(void *data, uint8_t len, uint8_t mode, uint16_t rx_to, uint64_t tx_time
 
     /* Transmit */
     if(dwt_starttx(mode) == DWT_SUCCESS) {
+#if APP_RADIO_IRQ
+      /* Completion is signalled by tx_done_cb(), see RADIO_WAIT_TX() */
+      return 1;
+#else
       while(!(dwt_read32bitreg(SYS_STATUS_ID) & SYS_STATUS_TXFRS)) {
         watchdog_periodic();
       }
@@ -127,6 +218,7 @@ start_tx(void *data, uint8_t len, uint8_t mode, uint16_t rx_to, uint64_t tx_time
       /* Clean TX event */
       dwt_write32bitreg(SYS_STATUS_ID, SYS_STATUS_TXFRS);
       return 1;
+#endif
     }
   }
 
@@ -141,27 +233,94 @@ radio_init() {
   /* Force transceiver off */
   dwt_forcetrxoff();
 
+#if APP_RADIO_IRQ
+  /* Replace the driver callbacks with ours and enable the TX done, RX good frame,
+   * RX timeout and RX error interrupts */
+  dwt_setcallbacks(tx_done_cb, rx_ok_cb, rx_fail_cb, rx_fail_cb);
+  dwt_setinterrupt(DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO |
+    DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT  | DWT_INT_ARFE, 1);
+#else
   /* Disable the driver callbacks */
   dwt_setcallbacks(0, 0, 0, 0);
 
   /* Disable all interrupts */
   dwt_setinterrupt(DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO |
     DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT  | DWT_INT_ARFE, 0);
+#endif
 
-  /* Set antenna delays */
-  dwt_setrxantennadelay(ANTENNA_DELAY);
-  dwt_settxantennadelay(ANTENNA_DELAY);
+  /* Set antenna delays, calibrated per node if it is in the table */
+  const antenna_delay_t *d = antenna_delays;
+  while(!linkaddr_cmp(&d->addr, &linkaddr_null) && !linkaddr_cmp(&d->addr, &linkaddr_node_addr)) {
+    d++;
+  }
+  if(!linkaddr_cmp(&d->addr, &linkaddr_null)) {
+    printf("Antenna delay TX %u RX %u\n", d->tx, d->rx);
+  }
+  tx_antenna_delay = d->tx;
+  rx_antenna_delay = d->rx;
+  dwt_setrxantennadelay(d->rx);
+  dwt_settxantennadelay(d->tx);
 
   /* Disable frame filtering */
   dwt_enableframefilter(DWT_FF_NOTYPE_EN);
 }
 /*---------------------------------------------------------------------------*/
 void
+radio_sleep(void)
+{
+  dwt_forcetrxoff();
+
+  /* Keep the configuration and reload the LDE microcode on wake-up, which is
+   * triggered by holding the SPI chip select low (radio_wakeup()) */
+  dwt_configuresleep(DWT_PRESRV_SLEEP | DWT_CONFIG | DWT_LOADUCODE, DWT_WAKE_CS | DWT_SLP_EN);
+  dwt_entersleep();
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+radio_wakeup(void)
+{
+  static uint8_t buf[RADIO_WAKEUP_LEN]; // Dummy SPI read, long enough to wake the radio up
+
+  if(dwt_spicswakeup(buf, sizeof(buf)) != DWT_SUCCESS) {
+    return 0;
+  }
+
+  /* Not all the registers are restored from the always-on memory */
+  dwt_setrxantennadelay(rx_antenna_delay);
+  dwt_settxantennadelay(tx_antenna_delay);
+#if APP_RADIO_IRQ
+  dwt_setinterrupt(DWT_INT_TFRS | DWT_INT_RFCG | DWT_INT_RFTO | DWT_INT_RXPTO |
+    DWT_INT_RPHE | DWT_INT_RFCE | DWT_INT_RFSL | DWT_INT_SFDT  | DWT_INT_ARFE, 1);
+#endif
+  dwt_enableframefilter(DWT_FF_NOTYPE_EN);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+void
 start_rx(uint16_t rx_to) {
+#if APP_RADIO_IRQ
+  radio_events = 0;
+  radio_process = PROCESS_CURRENT();
+#endif
+  /* Clean event flags of previous receptions */
+  dwt_write32bitreg(SYS_STATUS_ID, RX_WAIT_FLAGS);
+
   dwt_setrxtimeout(rx_to);
   dwt_rxenable(DWT_START_RX_IMMEDIATE);
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+uus_until(uint64_t ts)
+{
+  /* The high 32 bits of the system time count units of 256 dtu, 1 uus is 256 of them */
+  int32_t left = (int32_t)((uint32_t)(ts >> 8) - dwt_readsystimestamphi32());
+  if(left <= 0) {
+    return 0;
+  }
+  left >>= 8;
+  return left > 0xFFFF ? 0xFFFF : left;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
 wait_rx()
 {
@@ -182,24 +341,191 @@ wait_rx()
   return 0;
 }
 /*---------------------------------------------------------------------------*/
+uint16_t
+read_rx_msg(void *pkt, uint8_t msg_type, uint16_t min_len, uint16_t max_len)
+{
+  /* Check the length and type of the received packet and read the message */
+  uint16_t frame_len = rx_frame_len();
+  if(frame_len < min_len || frame_len > max_len || rx_msg_type() != msg_type) {
+    return 0;
+  }
+  dwt_readrxdata((uint8_t *)pkt, frame_len, 0);
+#if DEBUG
+  uint16_t i;
+  printf("RECV ");
+  for (i = 0; i < frame_len; i++) {
+    printf("%02x ", ((uint8_t *)pkt)[i]);
+  }
+  printf("\n");
+#endif
+  return frame_len;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rx_msg_type(void)
+{
+  uint8_t type;
+
+  if(rx_frame_len() < sizeof(rng_hdr_t)) {
+    return 0;
+  }
+  dwt_readrxdata(&type, 1, offsetof(rng_hdr_t, type));
+  return RNG_HDR_VERSION(type) == RNG_FRAME_VERSION ? RNG_HDR_MSG(type) : 0;
+}
+/*---------------------------------------------------------------------------*/
+/* The carrier integrator counts (998.4 MHz / 2 / 1024 / 131072) Hz at 850 kbps
+ * and 6.8 Mbps, the clock offset is that over the carrier frequency (4 * 998.4 MHz
+ * on channels 2 and 4): exactly 2^-30 per unit there, scaled for the other channels */
+#if DW1000_CONF_DATA_RATE == DWT_BR_110K
+#error Clock offset: the carrier integrator scale is only defined for 850 kbps and 6.8 Mbps
+#endif
+#if DW1000_CONF_CHANNEL == 1
+#define CARRIER_SCALE(x) ((x) * 8 / 7)   // 3494.4 MHz
+#elif DW1000_CONF_CHANNEL == 3
+#define CARRIER_SCALE(x) ((x) * 8 / 9)   // 4492.8 MHz
+#elif DW1000_CONF_CHANNEL == 5 || DW1000_CONF_CHANNEL == 7
+#define CARRIER_SCALE(x) ((x) * 8 / 13)  // 6489.6 MHz
+#else
+#define CARRIER_SCALE(x) (x)             // 3993.6 MHz
+#endif
+
+int32_t
+get_clock_offset(void)
+{
+  /* A faster sender shows up as a negative carrier offset */
+  return -CARRIER_SCALE(dwt_readcarrierintegrator());
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+resp_msg_clock_offset(const sstwr_resp_msg_t *msg, uint16_t len)
+{
+  int32_t offset = get_clock_offset();
+  const uint8_t *ext;
+
+  ext = rng_ext_find(msg->ext, len - RESP_MSG_MIN_LEN, RNG_EXT_CLOCK_OFFSET, 4);
+  if(ext != NULL) {
+    /* The responder saw our clock offset from its side: the opposite of ours */
+    offset = (offset - (int32_t)((uint32_t)ext[0] | (uint32_t)ext[1] << 8 |
+                                 (uint32_t)ext[2] << 16 | (uint32_t)ext[3] << 24)) / 2;
+  }
+  return offset;
+}
+/*---------------------------------------------------------------------------*/
 uint8_t
-read_rx_data(void* pkt, uint32_t pkt_size) {
+resp_msg_put_clock_offset(uint8_t *ext, uint8_t ext_len)
+{
+#if APP_EXT_CLOCK_OFFSET
+  int32_t offset = get_clock_offset();
+  uint8_t offset_le[4];
 
-  /* Check length of received packet and read the message */
+  offset_le[0] = offset & 0xFF;
+  offset_le[1] = (offset >> 8) & 0xFF;
+  offset_le[2] = (offset >> 16) & 0xFF;
+  offset_le[3] = (offset >> 24) & 0xFF;
+  ext_len = rng_ext_put(ext, ext_len, RNG_EXT_CLOCK_OFFSET, offset_le, sizeof(offset_le));
+#endif
+  return ext_len;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rx_frame_len(void)
+{
   uint32_t frame_len = dwt_read32bitreg(RX_FINFO_ID) & RX_FINFO_RXFL_MASK_1023;
-  if (frame_len == pkt_size + CRC_LEN) {
-    dwt_readrxdata((uint8_t *)pkt, pkt_size, 0);
-#if DEBUG
-    uint32_t i;
-    printf("RECV ");
-    for (i = 0; i < pkt_size; i++) {
-      printf("%02x ", ((uint8_t *)pkt)[i]);
+  return frame_len > CRC_LEN ? frame_len - CRC_LEN : 0;
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+read_rx_hdr(rng_hdr_t *hdr)
+{
+  if(rx_frame_len() < sizeof(rng_hdr_t)) {
+    return 0;
+  }
+  dwt_readrxdata((uint8_t *)hdr, sizeof(rng_hdr_t), 0);
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+/* 10 * log10(x) in 0.1 dB, from log2(x) in Q8 (x > 0) */
+static int32_t
+db10(uint64_t x)
+{
+  uint64_t y;
+  int32_t log2_q8;
+  uint8_t n = 0, i;
+
+  if(x == 0) {
+    return 0;
+  }
+  while((x >> n) > 1) {
+    n++;
+  }
+  /* Integer part from the leading bit, then one fractional bit per squaring
+   * of the mantissa, kept in Q30 within [1, 2) */
+  y = n > 30 ? x >> (n - 30) : x << (30 - n);
+  log2_q8 = n << 8;
+  for(i = 0; i < 8; i++) {
+    y = (y * y) >> 30;
+    if(y >= (1ULL << 31)) {
+      y >>= 1;
+      log2_q8 |= 1 << (7 - i);
     }
-    printf("\n");
+  }
+  return (int32_t)(((int64_t)log2_q8 * 30103 + 128000) / 256000);
+}
+/*---------------------------------------------------------------------------*/
+#if DW1000_CONF_PRF == DWT_PRF_64M
+#define RX_POWER_A (1217) // 121.74 dB
+#else
+#define RX_POWER_A (1138) // 113.77 dB
 #endif
-    return 1;
+
+void
+read_rx_diag(rx_diag_t *diag)
+{
+  dwt_rxdiag_t d;
+  int32_t n2;
+
+  dwt_readdiagnostics(&d);
+
+  /* P = 10 log10(C * 2^17 / N^2) - A and F = 10 log10((F1^2 + F2^2 + F3^2) / N^2) - A,
+   * with N the accumulated preamble symbols */
+  n2 = d.rxPreamCount ? 2 * db10(d.rxPreamCount) : 0;
+  diag->rx_power = db10((uint64_t)d.maxGrowthCIR << 17) - n2 - RX_POWER_A;
+  diag->fp_power = db10((uint64_t)d.firstPathAmp1 * d.firstPathAmp1 +
+                        (uint64_t)d.firstPathAmp2 * d.firstPathAmp2 +
+                        (uint64_t)d.firstPathAmp3 * d.firstPathAmp3) - n2 - RX_POWER_A;
+  diag->noise = d.stdNoise;
+  diag->fp_snr = d.stdNoise ? (uint32_t)d.firstPathAmp2 * 10 / d.stdNoise : 0xFFFF;
+
+  if(diag->rx_power - diag->fp_power > RX_DIAG_NLOS_DB) {
+    diag->los = RX_DIAG_NLOS;
+  }
+  else if(diag->rx_power - diag->fp_power > RX_DIAG_SUSPECT_DB || diag->fp_snr < RX_DIAG_MIN_SNR) {
+    diag->los = RX_DIAG_SUSPECT;
+  }
+  else {
+    diag->los = RX_DIAG_LOS;
   }
-  return 0;
+}
+/*---------------------------------------------------------------------------*/
+uint16_t
+rx_diag_meas_std(const rx_diag_t *diag)
+{
+  return RNG_FILTER_MEAS_STD << (diag->los == RX_DIAG_NLOS ? 2 : diag->los);
+}
+/*---------------------------------------------------------------------------*/
+void
+print_rx_diag(const linkaddr_t *init, const linkaddr_t *resp, const rx_diag_t *diag)
+{
+  static const char *los_names[] = {"LOS", "SUSPECT", "NLOS"};
+  /* Sign printed on its own, -0.5 dBm would print as 0.5 otherwise */
+  unsigned rx = diag->rx_power < 0 ? -diag->rx_power : diag->rx_power;
+  unsigned fp = diag->fp_power < 0 ? -diag->fp_power : diag->fp_power;
+
+  printf("DIAG [%02x:%02x->%02x:%02x] rx %s%u.%u dBm fp %s%u.%u dBm noise %u fp/noise %u.%u %s\n",
+    init->u8[0], init->u8[1], resp->u8[0], resp->u8[1],
+    diag->rx_power < 0 ? "-" : "", rx / 10, rx % 10,
+    diag->fp_power < 0 ? "-" : "", fp / 10, fp % 10,
+    diag->noise, diag->fp_snr / 10, diag->fp_snr % 10, los_names[diag->los]);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -218,3 +544,79 @@ radio_reset()
   dwt_forcetrxoff();
 }
 /*---------------------------------------------------------------------------*/
+void
+print_cpu_usage(uint16_t rounds)
+{
+#if ENERGEST_CONF_ON
+  static unsigned long last_cpu, last_lpm;
+  unsigned long cpu, lpm;
+
+  energest_flush();
+  cpu = energest_type_time(ENERGEST_TYPE_CPU);
+  lpm = energest_type_time(ENERGEST_TYPE_LPM);
+  if(rounds > 0) {
+    /* Average per round, in us */
+    printf("CPU %lu us LPM %lu us per round (%u rounds)\n",
+      (unsigned long)((uint64_t)(cpu - last_cpu) * 1000000 / RTIMER_SECOND / rounds),
+      (unsigned long)((uint64_t)(lpm - last_lpm) * 1000000 / RTIMER_SECOND / rounds),
+      rounds);
+  }
+  last_cpu = cpu;
+  last_lpm = lpm;
+#endif
+}
+/*---------------------------------------------------------------------------*/
+void
+print_tof_bench(uint64_t round, uint64_t reply)
+{
+  volatile int32_t fixed_mm;
+  volatile double double_mm;
+  uint32_t c0, c1, c2;
+
+  c0 = cycle_counter_read();
+  fixed_mm = sstwr_dist_mm(round, reply, 0);
+  c1 = cycle_counter_read();
+  double_mm = sstwr_tof(round, reply) * DWT_TIME_UNITS * SPEED_OF_LIGHT * 1000;
+  c2 = cycle_counter_read();
+  printf("TOF BENCH fixed %ld mm %lu cycles, double %ld mm %lu cycles\n",
+    (long)fixed_mm, (unsigned long)(c1 - c0), (long)double_mm, (unsigned long)(c2 - c1));
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+print_filtered(rng_filter_t *f, const linkaddr_t *init, const linkaddr_t *resp, int32_t raw_mm,
+               uint16_t meas_std, rng_filter_out_t *out)
+{
+  rng_filter_out_t est;
+
+  if(out == NULL) {
+    out = &est;
+  }
+  rng_filter_update(f, raw_mm, meas_std, (uint32_t)((uint64_t)clock_time() * 1000 / CLOCK_SECOND), out);
+  printf("FILTERED [%02x:%02x->%02x:%02x] %ld mm std %u mm speed %ld mm/s%s\n",
+    init->u8[0], init->u8[1], resp->u8[0], resp->u8[1],
+    (long)out->dist, out->std, (long)out->speed, out->outlier ? " outlier" : "");
+  return out->dist;
+}
+/*---------------------------------------------------------------------------*/
+#ifndef DWT_EMU // The DW1000 emulator has a host one
+#define CORE_DEMCR (*(volatile uint32_t *)0xE000EDFC)
+#define CORE_DEMCR_TRCENA (1UL << 24)
+#define CORE_DWT_CTRL (*(volatile uint32_t *)0xE0001000)
+#define CORE_DWT_CTRL_CYCCNTENA (1UL << 0)
+#define CORE_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+void
+cycle_counter_init(void)
+{
+  CORE_DEMCR |= CORE_DEMCR_TRCENA;
+  CORE_DWT_CYCCNT = 0;
+  CORE_DWT_CTRL |= CORE_DWT_CTRL_CYCCNTENA;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+cycle_counter_read(void)
+{
+  return CORE_DWT_CYCCNT;
+}
+#endif /* DWT_EMU */
+/*---------------------------------------------------------------------------*/
@@ -1,40 +1,162 @@
 #ifndef RNG_SUPPORT_H
 #define RNG_SUPPORT_H
 /*---------------------------------------------------------------------------*/
+#include "contiki.h"
 #include "deca_regs.h"
 #include "core/net/linkaddr.h"
+#include "rng-filter.h"
+#include "rng-payload.h"
+#include <stddef.h>
 /*---------------------------------------------------------------------------*/
 #define RX_WAIT_FLAGS (SYS_STATUS_RXFCG | SYS_STATUS_ALL_RX_TO | SYS_STATUS_ALL_RX_ERR)
 #define NO_RX_TIMEOUT 0
-#define RNG_TS_LEN 8 // Number of lower bytes for ranging timestamps
+#define RNG_TS_LEN 5 // Number of lower bytes for ranging timestamps (all the 40 bits)
 #define DWT_TX_BITMASK (0xFFFFFFFE00UL)
 #define DWT_VALUES 1099511627776 // Number of values in the 40-bit radio timestamp
-#define ANTENNA_DELAY 16455
+#define ANTENNA_DELAY 16455 // Default, for the nodes missing from antenna-delays.h
 #define SPEED_OF_LIGHT 299702547 // In air, m/s
+/* UWB microsecond (uus) to device time unit (dtu, around 15.65 ps) conversion factor.
+ * 1 uus = 512 / 499.2 µs and 1 µs = 499.2 * 128 dtu. */
+#define UUS_TO_DWT_TIME (65536)
 #define BUF_LEN 30
 #define CRC_LEN 2
+#define BCAST_MAX_RESP 4 // Responders addressed by one broadcast init message
+#define BCAST_SLOT (400) /* Reply slot of each responder to a broadcast init in ~us.
+                          * Must cover the resp airtime plus the time the initiator
+                          * needs to read the reply and re-enable the receiver. */
+/* TDMA superframe (APP_TDMA): the coordinator beacon starts it, initiator i
+ * sends its init message TDMA_FIRST_SLOT + i * TDMA_SLOT after the beacon,
+ * unregistered initiators register in one of the TDMA_REG_SLOTS that follow */
+#define TDMA_MAX_SLOTS 8
+#define TDMA_SUPERFRAME (CLOCK_SECOND / 10) // Beacon period
+#define TDMA_FIRST_SLOT (15000) /* Start of the first slot after the beacon in ~us, leaves the
+                                 * initiators time to process the beacon, print and schedule the init */
+#define TDMA_SLOT (3000) // Ranging slot in ~us, must fit a whole exchange (incl. DS-TWR or broadcast init)
+#define TDMA_REG_START (TDMA_FIRST_SLOT + TDMA_MAX_SLOTS * TDMA_SLOT)
+#define TDMA_REG_SLOTS 4
+#define TDMA_REG_SLOT (1000) // Registration slot in ~us
+#define TDMA_REG_END (TDMA_REG_START + TDMA_REG_SLOTS * TDMA_REG_SLOT)
+#define TDMA_LEASE 20 // Superframes without hearing an initiator before its slot is released
+#define RADIO_WAKEUP_LEN 600 // SPI bytes read to hold the chip select low long enough (>500 us) for radio_wakeup()
+#define RADIO_WAKEUP_TIME (CLOCK_SECOND / 100) // Upper bound of radio_wakeup(), incl. the crystal start-up
 /*---------------------------------------------------------------------------*/
+#if APP_BCAST_INIT && APP_DSTWR
+#error Broadcast init is only supported with single-sided TWR
+#endif
+#if APP_BCAST_INIT && !APP_CLOCK_OFFSET_CORR
+#error Broadcast init needs APP_CLOCK_OFFSET_CORR: the SS-TWR error grows with the reply slot
+#endif
+/*---------------------------------------------------------------------------*/
+
+/* Frame format version and message types, in the type byte of every header.
+ * Change RNG_FRAME_VERSION with the layout of any message: the nodes drop the
+ * frames of other versions instead of misreading them. */
+#define RNG_FRAME_VERSION 2
+#define RNG_MSG_INIT        0x01
+#define RNG_MSG_RESP        0x02
+#define RNG_MSG_FINAL       0x03
+#define RNG_MSG_BCAST_INIT  0x04
+#define RNG_MSG_TDMA_BEACON 0x05
+#define RNG_MSG_TDMA_REG    0x06
+#define RNG_HDR_TYPE(msg_type) ((RNG_FRAME_VERSION << 5) | (msg_type))
+#define RNG_HDR_VERSION(type) ((type) >> 5)
+#define RNG_HDR_MSG(type) ((type) & 0x1F)
 
-/* Message header, common for init and resp messages */
+/* Message header, common for all the messages: an IEEE 802.15.4 data frame
+ * header followed by the type byte (10 bytes). With APP_SHORT_HDR, only the
+ * type byte, sequence number and addresses are kept (6 bytes): the frames are
+ * then no longer IEEE 802.15.4 compliant, fine with frame filtering disabled. */
 typedef struct {
+#if APP_SHORT_HDR
+  uint8_t type;
+  uint8_t seqn;
+  uint8_t dst[2];
+  uint8_t src[2];
+#else
   uint8_t fctrl[2];
   uint8_t seqn;
   uint8_t pan_id[2];
   uint8_t dst[2];
   uint8_t src[2];
-} __attribute__ ((__packed__)) ieee154_hdr_t;
+  uint8_t type;
+#endif
+} __attribute__ ((__packed__)) rng_hdr_t;
+
+/* Extension fields, appended to the init and resp messages as type, length,
+ * value. Receivers skip the types they do not know. */
+#define RNG_EXT_MAX_LEN (6 + 2 + RNG_PAYLOAD_MAX_LEN) // Clock offset and payload
+#define RNG_EXT_CLOCK_OFFSET 0x01 /* Clock offset of the initiator estimated by the responder on
+                                   * the init message, 2^-30 units, int32 little endian (APP_EXT_CLOCK_OFFSET) */
+#define RNG_EXT_PAYLOAD 0x02      /* Application data for the receiver, up to RNG_PAYLOAD_MAX_LEN
+                                   * bytes (APP_PIGGYBACK, see rng-payload.h) */
 
 /* Ranging initiator message */
 typedef struct {
-  ieee154_hdr_t hdr;
+  rng_hdr_t hdr;
+  uint8_t ext[RNG_EXT_MAX_LEN]; // Extension fields, only the used part is sent
 } __attribute__ ((__packed__)) sstwr_init_msg_t;
+#define INIT_MSG_MIN_LEN (offsetof(sstwr_init_msg_t, ext))
+
+/* Broadcast ranging initiator message (APP_BCAST_INIT), listing the responders:
+ * each one replies RESP_DELAY + i * BCAST_SLOT after the init, i being its index */
+typedef struct {
+  rng_hdr_t hdr;
+  uint8_t resp[BCAST_MAX_RESP][2];
+  uint8_t ext[RNG_EXT_MAX_LEN]; // Extension fields, only the used part is sent
+} __attribute__ ((__packed__)) bcast_init_msg_t;
+#define BCAST_MSG_MIN_LEN (offsetof(bcast_init_msg_t, ext))
 
 /* Ranging responder message, embedding the necessary timestamps */
 typedef struct {
-  ieee154_hdr_t hdr;
+  rng_hdr_t hdr;
   uint8_t init_rx_ts[RNG_TS_LEN];
   uint8_t resp_tx_ts[RNG_TS_LEN];
+  uint8_t resp_delay[2]; // Reply delay used by the responder in ~us (little endian), to size the initiator RX timeout
+  uint8_t ext[RNG_EXT_MAX_LEN]; // Extension fields, only the used part is sent (see rng_ext_put())
 } __attribute__ ((__packed__)) sstwr_resp_msg_t;
+#define RESP_MSG_MIN_LEN (offsetof(sstwr_resp_msg_t, ext))
+
+/* Ranging final message (DS-TWR only), embedding the initiator timestamps */
+typedef struct {
+  rng_hdr_t hdr;
+  uint8_t init_tx_ts[RNG_TS_LEN];
+  uint8_t resp_rx_ts[RNG_TS_LEN];
+  uint8_t final_tx_ts[RNG_TS_LEN];
+} __attribute__ ((__packed__)) dstwr_final_msg_t;
+
+/* Receive diagnostics of a frame (APP_RX_DIAG), see read_rx_diag() */
+#define RX_DIAG_LOS 0
+#define RX_DIAG_SUSPECT 1
+#define RX_DIAG_NLOS 2
+#define RX_DIAG_SUSPECT_DB (60) // Total minus first path power above which a range is suspect, in 0.1 dB
+#define RX_DIAG_NLOS_DB (100)   // Total minus first path power above which a range is taken as NLOS, in 0.1 dB
+#define RX_DIAG_MIN_SNR (60)    // First path amplitude over the noise below which a range is suspect, x10
+typedef struct {
+  int16_t rx_power;   // Total received power, 0.1 dBm
+  int16_t fp_power;   // First path power, 0.1 dBm
+  uint16_t noise;     // Standard deviation of the noise in the channel impulse response
+  uint16_t fp_snr;    // First path amplitude over the noise, x10
+  uint8_t los;        // RX_DIAG_*
+} rx_diag_t;
+
+/* Per-node antenna delays in DWT_TIME_UNITS, applied by radio_init() to the
+ * node whose address matches (table in antenna-delays.h, see antenna_calib.py) */
+typedef struct {
+  linkaddr_t addr;
+  uint16_t tx;
+  uint16_t rx;
+} antenna_delay_t;
+
+/* TDMA coordinator beacon (broadcast), listing the initiator of each slot ({0, 0} if free) */
+typedef struct {
+  rng_hdr_t hdr;
+  uint8_t owner[TDMA_MAX_SLOTS][2];
+} __attribute__ ((__packed__)) tdma_beacon_msg_t;
+
+/* TDMA slot request, sent by an initiator to the coordinator */
+typedef struct {
+  rng_hdr_t hdr;
+} __attribute__ ((__packed__)) tdma_reg_msg_t;
 
 /*---------------------------------------------------------------------------*/
 /****** Timestamps management ******/
@@ -53,21 +175,36 @@ uint64_t get_tx_timestamp(void);
 uint64_t predict_tx_timestamp(uint64_t tx_ts);
 
 /* Embed the desired timestamp in the specified field (init RX or resp TX) of response.
- * Used by the responder.
+ * Used by the responder, and by the initiator for the final message in DS-TWR.
  */
 void resp_msg_set_timestamp(uint8_t *ts_field, uint64_t ts);
 
 /* Read the timestamp from the specified field (init RX or resp TX) of the response message
  * and store it at the desired location.
- * Used by the initiator.
+ * Used by the initiator, and by the responder for the final message in DS-TWR.
  */
 void resp_msg_get_timestamp(uint8_t *ts_field, uint64_t *ts);
 
 /*---------------------------------------------------------------------------*/
 /****** Packet transmission and reception ******/
 
-/* Set source, destination addresses and the sequence number in the pointed header */
-void fill_ieee_hdr(ieee154_hdr_t *hdr, linkaddr_t *src, linkaddr_t *dst, uint8_t seqn);
+/* Destination address of broadcast init messages */
+extern linkaddr_t bcast_addr;
+
+/* Set the message type (RNG_MSG_*), source, destination addresses and the sequence number in the pointed header */
+void fill_hdr(rng_hdr_t *hdr, uint8_t msg_type, linkaddr_t *src, linkaddr_t *dst, uint8_t seqn);
+
+/* Append a type, length, value extension field to the ext area of a resp
+ * message, of which ext_len bytes are used. Returns the new used length, or
+ * ext_len if the field does not fit. */
+uint8_t rng_ext_put(uint8_t *ext, uint8_t ext_len, uint8_t type, const void *value, uint8_t len);
+
+/* Find the extension field of the given type and length in the ext_len bytes
+ * of an ext area. Returns a pointer to its value, NULL if missing. */
+const uint8_t *rng_ext_find(const uint8_t *ext, uint8_t ext_len, uint8_t type, uint8_t len);
+
+/* As rng_ext_find(), for a field of any length, stored in *len */
+const uint8_t *rng_ext_get(const uint8_t *ext, uint8_t ext_len, uint8_t type, uint8_t *len);
 
 /* Radio initialization */
 void radio_init();
@@ -82,19 +219,141 @@ void radio_init();
  *        Ignored unless DWT_RESPONSE_EXPECTED is set;
  * tx_time: Wanted TX time for the transmission (will differ from actual TX
  *          time - see predict_tx_timestamp()).
+ * With APP_RADIO_IRQ, returns as soon as the transmission is started:
+ * use RADIO_WAIT_TX() before reading the TX timestamp.
  */
 uint8_t start_tx(void *data, uint8_t len, uint8_t mode, uint16_t rx_to, uint64_t tx_time);
 
 /* Turn on the radio and enable reception */
 void start_rx(uint16_t rx_to);
 
-/* Wait until a packet is received, or an error/timeout occurs */
+/* Time left until the given radio timestamp, in ~us (0 if already past).
+ * Used to keep the receiver on until the end of a window across several receptions. */
+uint16_t uus_until(uint64_t ts);
+
+/* Wait until a packet is received, or an error/timeout occurs (busy polling) */
 uint8_t wait_rx();
 
-/* Upon reception, read pkt_size bytes into pkt */
-uint8_t read_rx_data(void* pkt, uint32_t pkt_size);
+/* Upon reception, read a message of the given type (RNG_MSG_*) into pkt if its
+ * length is between min_len and max_len (the size of pkt). Returns the length
+ * read, 0 for frames of another type, version or length. */
+uint16_t read_rx_msg(void *pkt, uint8_t msg_type, uint16_t min_len, uint16_t max_len);
+
+/* Upon reception, type of the received message (RNG_MSG_*), 0 if it is not a
+ * message of this frame version */
+uint8_t rx_msg_type(void);
+
+/* Upon reception, clock offset of the sender with respect to this node, in units
+ * of 2^-30, from the carrier frequency offset estimated by the radio (for
+ * sstwr_dist_mm()). Positive if the sender clock is faster. */
+int32_t get_clock_offset(void);
+
+/* Upon reception of the resp message msg of length len, clock offset of the
+ * responder with respect to this node (see get_clock_offset()). With the
+ * RNG_EXT_CLOCK_OFFSET field, averaged with the estimate of the responder. */
+int32_t resp_msg_clock_offset(const sstwr_resp_msg_t *msg, uint16_t len);
+
+/* Clock offset to correct SS-TWR with, 0 without APP_CLOCK_OFFSET_CORR */
+#if APP_CLOCK_OFFSET_CORR
+#define RESP_CLOCK_OFFSET(msg, len) resp_msg_clock_offset(msg, len)
+#else
+#define RESP_CLOCK_OFFSET(msg, len) 0
+#endif
+
+/* Upon reception of an init message, append our estimate of the clock offset
+ * of the initiator (RNG_EXT_CLOCK_OFFSET) to the ext area of the resp message,
+ * of which ext_len bytes are used. Returns the new used length, ext_len
+ * without APP_EXT_CLOCK_OFFSET. */
+uint8_t resp_msg_put_clock_offset(uint8_t *ext, uint8_t ext_len);
+
+/* Upon reception, length of the received frame without CRC */
+uint16_t rx_frame_len(void);
+
+/* Upon reception, read the header of a frame of any length */
+uint8_t read_rx_hdr(rng_hdr_t *hdr);
+
+/* Upon reception, read the receive diagnostics and classify the channel
+ * (DW1000 user manual 4.7 for the powers). A first path much weaker than the
+ * total power means that the direct path is attenuated and reflections
+ * dominate: over 6 dB is suspect, over 10 dB is likely NLOS (Decawave APS006).
+ * A first path close to the noise may also be a missed direct path. */
+void read_rx_diag(rx_diag_t *diag);
+
+/* Standard deviation to feed to the distance filter for a range with these
+ * diagnostics: RNG_FILTER_MEAS_STD, doubled if suspect and quadrupled if NLOS */
+uint16_t rx_diag_meas_std(const rx_diag_t *diag);
+
+/* Print the diagnostics of the last range of the init->resp pair */
+void print_rx_diag(const linkaddr_t *init, const linkaddr_t *resp, const rx_diag_t *diag);
 
 /* Reset radio after errors and timeouts */
 void radio_reset();
+
+/* Put the radio in deep sleep (a few uA instead of more than 100 mA in RX),
+ * keeping its configuration. The radio system time restarts on wake-up:
+ * timestamps taken before the sleep do not compare with the ones taken after. */
+void radio_sleep(void);
+
+/* Wake the radio up from radio_sleep(), busy waiting for its crystal to settle
+ * (RADIO_WAKEUP_TIME). Returns 0 if the radio does not answer. */
+uint8_t radio_wakeup(void);
+
+/*---------------------------------------------------------------------------*/
+/****** Waiting for the radio ******/
+
+#if APP_RADIO_IRQ
+/* Radio events, set by the DW1000 interrupt callbacks.
+ * start_tx() and start_rx() clear them and remember the calling process,
+ * which is polled when an event occurs. */
+#define RADIO_EV_TX_DONE 0x01
+#define RADIO_EV_RX_OK   0x02
+#define RADIO_EV_RX_FAIL 0x04 // RX error or timeout
+extern volatile uint8_t radio_events;
+
+/* Yield the calling process until the last transmission is complete */
+#define RADIO_WAIT_TX() \
+  PROCESS_WAIT_EVENT_UNTIL(radio_events & RADIO_EV_TX_DONE)
+
+/* Yield the calling process until a packet is received (ret = 1),
+ * or an error/timeout occurs (ret = 0) */
+#define RADIO_WAIT_RX(ret) do { \
+    PROCESS_WAIT_EVENT_UNTIL(radio_events & (RADIO_EV_RX_OK | RADIO_EV_RX_FAIL)); \
+    (ret) = (radio_events & RADIO_EV_RX_OK) != 0; \
+  } while(0)
+
+/* The same, in a protothread spawned by the process (PROCESS_PT_SPAWN) */
+#define RADIO_PT_WAIT_TX(pt) \
+  PT_WAIT_UNTIL(pt, radio_events & RADIO_EV_TX_DONE)
+#define RADIO_PT_WAIT_RX(pt, ret) do { \
+    PT_WAIT_UNTIL(pt, radio_events & (RADIO_EV_RX_OK | RADIO_EV_RX_FAIL)); \
+    (ret) = (radio_events & RADIO_EV_RX_OK) != 0; \
+  } while(0)
+#else
+/* Busy polling: start_tx() returns once the transmission is complete */
+#define RADIO_WAIT_TX()
+#define RADIO_WAIT_RX(ret) (ret) = wait_rx()
+#define RADIO_PT_WAIT_TX(pt)
+#define RADIO_PT_WAIT_RX(pt, ret) (ret) = wait_rx()
+#endif
+
+/* Print the average CPU and low-power mode time (energest) per ranging round
+ * since the previous call, nothing without ENERGEST_CONF_ON */
+void print_cpu_usage(uint16_t rounds);
+
+/* Print the cycles of the fixed-point SS-TWR distance (sstwr_dist_mm()) and of
+ * the equivalent double computation on these intervals (APP_TOF_BENCH) */
+void print_tof_bench(uint64_t round, uint64_t reply);
+
+/* Feed a raw distance, of standard deviation meas_std (RNG_FILTER_MEAS_STD unless
+ * down-weighted, see rx_diag_meas_std()), to the filter of the init->resp pair,
+ * print the estimate and return it. The whole estimate is also stored in *out
+ * unless out is NULL. */
+int32_t print_filtered(rng_filter_t *f, const linkaddr_t *init, const linkaddr_t *resp, int32_t raw_mm,
+                       uint16_t meas_std, rng_filter_out_t *out);
+
+/* Cortex-M3 cycle counter (DWT CYCCNT of the core debug unit, unrelated to the
+ * DW1000 DWT_ API), to measure the cost of on-node computations */
+void cycle_counter_init(void);
+uint32_t cycle_counter_read(void);
 /*---------------------------------------------------------------------------*/
 #endif /* RNG_SUPPORT_H */
@@ -0,0 +1,79 @@
+#include "contiki.h"
+#include "lib/random.h"
+#include <stdio.h>
+#include "rng-support.h"
+#include "rng-tdma.h"
+/*---------------------------------------------------------------------------*/
+#if APP_TDMA
+static struct etimer et; // Expires TDMA_BEACON_GUARD before the next beacon
+static tdma_beacon_msg_t beacon; // Last coordinator beacon
+static tdma_reg_msg_t reg_msg; // Slot request
+static uint64_t beacon_rx_ts; // Start of the superframe, in radio time
+static uint8_t synced = 0; // 1 if the last beacon was received
+static uint8_t slot;
+static uint8_t ret;
+/*---------------------------------------------------------------------------*/
+PT_THREAD(rng_tdma_wait_slot(struct pt *pt, uint8_t seqn))
+{
+  static linkaddr_t coord;
+
+  PT_BEGIN(pt);
+
+  /* Wait for the next coordinator beacon, with the receiver off until shortly
+   * before it is due (the timer was set when the previous one was received) */
+  if(synced && !etimer_expired(&et)) {
+    PT_WAIT_UNTIL(pt, etimer_expired(&et));
+  }
+  while(1) {
+    start_rx(synced ? TDMA_BEACON_TIMEOUT : NO_RX_TIMEOUT);
+    RADIO_PT_WAIT_RX(pt, ret);
+    if(ret && read_rx_msg(&beacon, RNG_MSG_TDMA_BEACON, sizeof(beacon), sizeof(beacon))) {
+      break;
+    }
+    if(!ret) {
+      radio_reset();
+      if(synced) {
+        synced = 0;
+        printf("[%u] TDMA beacon missed\n", seqn);
+      }
+    }
+  }
+  beacon_rx_ts = get_rx_timestamp();
+  synced = 1;
+  etimer_set(&et, TDMA_SUPERFRAME - TDMA_BEACON_GUARD);
+
+  /* Find our slot, or ask the coordinator for one */
+  for(slot = 0; slot < TDMA_MAX_SLOTS; slot++) {
+    if(beacon.owner[slot][0] == linkaddr_node_addr.u8[0] &&
+       beacon.owner[slot][1] == linkaddr_node_addr.u8[1]) {
+      break;
+    }
+  }
+  if(slot == TDMA_MAX_SLOTS) {
+    coord.u8[0] = beacon.hdr.src[1];
+    coord.u8[1] = beacon.hdr.src[0];
+    fill_hdr(&reg_msg.hdr, RNG_MSG_TDMA_REG, &linkaddr_node_addr, &coord, seqn);
+    ret = start_tx(&reg_msg, sizeof(reg_msg), DWT_START_TX_DELAYED, 0, (beacon_rx_ts +
+      (uint64_t)(TDMA_REG_START + (random_rand() % TDMA_REG_SLOTS) * TDMA_REG_SLOT) * UUS_TO_DWT_TIME) % DWT_VALUES);
+    if(!ret) {
+      radio_reset();
+      PT_EXIT(pt);
+    }
+    RADIO_PT_WAIT_TX(pt);
+    printf("[%u] TDMA slot request to %02x%02x\n", seqn, coord.u8[0], coord.u8[1]);
+  }
+
+  PT_END(pt);
+}
+/*---------------------------------------------------------------------------*/
+uint8_t
+rng_tdma_slot_time(uint64_t *tx_time)
+{
+  if(slot == TDMA_MAX_SLOTS) {
+    return 0;
+  }
+  *tx_time = (beacon_rx_ts + (uint64_t)(TDMA_FIRST_SLOT + slot * TDMA_SLOT) * UUS_TO_DWT_TIME) % DWT_VALUES;
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+#endif /* APP_TDMA */
@@ -0,0 +1,32 @@
+#ifndef RNG_TDMA_H
+#define RNG_TDMA_H
+/*---------------------------------------------------------------------------*/
+#include "contiki.h"
+#include "dw1000.h"
+/*---------------------------------------------------------------------------*/
+/****** TDMA superframe on the initiators (APP_TDMA) ******/
+
+/* The coordinator (rng-coord) starts each superframe with a beacon listing the
+ * initiator of each ranging slot, see TDMA_* in rng-support.h. An initiator
+ * without a slot requests one in a random registration slot. Once the beacons
+ * are received in a row, the receiver stays off until shortly before the next one.
+ */
+#define TDMA_BEACON_GUARD (CLOCK_SECOND / 100) // The receiver is turned on this early for the next beacon
+#define TDMA_BEACON_TIMEOUT (20000) // Beacon RX window when synchronized, in ~us
+
+/* TX mode of the init messages, delayed to our slot with APP_TDMA */
+#if APP_TDMA
+#define INIT_TX_MODE (DWT_START_TX_DELAYED | DWT_RESPONSE_EXPECTED)
+#else
+#define INIT_TX_MODE (DWT_START_TX_IMMEDIATE | DWT_RESPONSE_EXPECTED)
+#endif
+
+/* Protothread of round seqn, for the ranging process (PROCESS_PT_SPAWN):
+ * wait for the next beacon and, without a slot in it, request one */
+PT_THREAD(rng_tdma_wait_slot(struct pt *pt, uint8_t seqn));
+
+/* Scheduled TX time of the init message in our slot of the current
+ * superframe, in radio time. Returns 0 if we have no slot in it. */
+uint8_t rng_tdma_slot_time(uint64_t *tx_time);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_TDMA_H */
@@ -0,0 +1,201 @@
+/*
+ * Host unit tests of the time-of-flight math (make rng-tof-test): builds the
+ * timestamps of SS-TWR and DS-TWR exchanges with a known time of flight,
+ * with and without a responder clock offset, placed so that intervals cross
+ * the 40-bit wraparound, and checks ts_interval(), sstwr_tof() and
+ * dstwr_tof() against the expected values. Then checks the fixed-point
+ * distances of the nodes (sstwr_dist_mm(), dstwr_dist_mm()) against the
+ * double computation and the true distance on random exchanges.
+ * Exits with status 1 on a failure.
+ *
+ * Usage: ./rng-tof-test
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "rng-tof.h"
+/*---------------------------------------------------------------------------*/
+#define UUS (65536ULL)    // DWT_TIME_UNITS per ~us
+#define DRIFT (20e-6)     // Responder clock offset for the drift tests
+#define DWT_TIME_UNITS (1.0 / 499.2e6 / 128.0)
+#define SPEED_OF_LIGHT 299702547
+#define MM_PER_TICK (DWT_TIME_UNITS * SPEED_OF_LIGHT * 1000)
+#define VECTORS 10000     // Random exchanges of the fixed-point tests
+#define MAX_DIFF_MM 1     // Fixed-point distance from the double one
+/* Error from the true time of flight: the timestamps are rounded to whole
+ * ticks (+-0.5 tick on the time of flight) and the clock offset to 2^-30 */
+#define MAX_ERR_TICKS 0.6
+/*---------------------------------------------------------------------------*/
+static int checks, fails;
+/*---------------------------------------------------------------------------*/
+static void
+check(const char *what, double got, double expected, double tol)
+{
+  checks++;
+  if(fabs(got - expected) > tol) {
+    fails++;
+    printf("FAIL %s: %.3f, expected %.3f (+-%.3f)\n", what, got, expected, tol);
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Timestamps of an exchange, the initiator clock being the reference and the
+ * responder clock running (1 + drift) times faster */
+struct exchange {
+  uint64_t init_tx, resp_rx, final_tx;  // Initiator clock
+  uint64_t init_rx, resp_tx, final_rx;  // Responder clock
+};
+
+static void
+make_exchange(struct exchange *e, uint64_t init_tx, uint64_t init_rx, double tof,
+              double reply_a, double reply_b, double drift)
+{
+  e->init_tx = init_tx & DWT_TS_MASK;
+  e->init_rx = init_rx & DWT_TS_MASK;
+  e->resp_tx = (e->init_rx + (uint64_t)llround(reply_b)) & DWT_TS_MASK;
+  e->resp_rx = (e->init_tx + (uint64_t)llround(2 * tof + reply_b / (1 + drift))) & DWT_TS_MASK;
+  e->final_tx = (e->resp_rx + (uint64_t)llround(reply_a)) & DWT_TS_MASK;
+  e->final_rx = (e->resp_tx + (uint64_t)llround((2 * tof + reply_a) * (1 + drift))) & DWT_TS_MASK;
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_ts_interval(void)
+{
+  check("interval", ts_interval(1000, 5000), 4000, 0);
+  check("interval, same timestamp", ts_interval(0x123456789AULL, 0x123456789AULL), 0, 0);
+  check("interval across the wrap", ts_interval(0xFFFFFFFF00ULL, 0x100), 0x200, 0);
+  check("interval ending at the wrap", ts_interval(0xFFFFFFFF00ULL, 0), 0x100, 0);
+  check("longest interval", ts_interval(1, 0), DWT_TS_MASK, 0);
+  /* Timestamps with garbage above bit 40 still give the 40-bit interval */
+  check("interval of unmasked timestamps", ts_interval(0xFFFFFFFFFFULL, 0x10000000001ULL), 2, 0);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_sstwr(void)
+{
+  struct exchange e;
+  double reply = 500 * UUS;
+
+  /* No offset: exact, with the resp RX after the wraparound */
+  make_exchange(&e, DWT_TS_MASK - 1000, 0x4000000000ULL, 1000, 0, reply, 0);
+  check("SS-TWR across the wrap", sstwr_tof(ts_interval(e.init_tx, e.resp_rx),
+                                            ts_interval(e.init_rx, e.resp_tx)), 1000, 0);
+
+  /* Reply across the wraparound of the responder clock */
+  make_exchange(&e, 0x1000, DWT_TS_MASK - 100, 213, 0, reply, 0);
+  check("SS-TWR, reply across the wrap", sstwr_tof(ts_interval(e.init_tx, e.resp_rx),
+                                                   ts_interval(e.init_rx, e.resp_tx)), 213, 0);
+
+  /* Zero distance */
+  make_exchange(&e, 0x2000, 0x3000, 0, 0, reply, 0);
+  check("SS-TWR, zero distance", sstwr_tof(ts_interval(e.init_tx, e.resp_rx),
+                                           ts_interval(e.init_rx, e.resp_tx)), 0, 0);
+
+  /* With the offset, the reply measured by the fast responder clock is too
+   * long: the ToF is short by reply * drift / (2 * (1 + drift)) */
+  make_exchange(&e, DWT_TS_MASK - 1000, 0x4000000000ULL, 1000, 0, reply, DRIFT);
+  check("SS-TWR with clock offset", sstwr_tof(ts_interval(e.init_tx, e.resp_rx),
+                                              ts_interval(e.init_rx, e.resp_tx)),
+        1000 - reply * DRIFT / (2 * (1 + DRIFT)), 0.5);
+}
+/*---------------------------------------------------------------------------*/
+static void
+test_dstwr(void)
+{
+  struct exchange e;
+  uint64_t round_a, reply_a, round_b, reply_b;
+
+  /* No offset, different reply times: exact, with the initiator round and
+   * the responder reply crossing the wraparound */
+  make_exchange(&e, DWT_TS_MASK - 1000, DWT_TS_MASK - 50 * UUS, 1000, 700 * UUS, 300 * UUS, 0);
+  round_a = ts_interval(e.init_tx, e.resp_rx);
+  reply_a = ts_interval(e.resp_rx, e.final_tx);
+  round_b = ts_interval(e.resp_tx, e.final_rx);
+  reply_b = ts_interval(e.init_rx, e.resp_tx);
+  check("DS-TWR across the wrap", dstwr_tof(round_a, reply_a, round_b, reply_b), 1000, 1e-6);
+
+  /* The offset cancels out: the error is a fraction of tof * drift, plus the
+   * rounding of the timestamps to whole ticks */
+  make_exchange(&e, DWT_TS_MASK - 1000, DWT_TS_MASK - 50 * UUS, 1000, 700 * UUS, 300 * UUS, DRIFT);
+  round_a = ts_interval(e.init_tx, e.resp_rx);
+  reply_a = ts_interval(e.resp_rx, e.final_tx);
+  round_b = ts_interval(e.resp_tx, e.final_rx);
+  reply_b = ts_interval(e.init_rx, e.resp_tx);
+  check("DS-TWR with clock offset", dstwr_tof(round_a, reply_a, round_b, reply_b), 1000, 1);
+
+  /* Same with the opposite offset and long replies (2^31 ticks is the limit) */
+  make_exchange(&e, 0x8000000000ULL, 0, 20000, 30000 * UUS, 25000 * UUS, -DRIFT);
+  round_a = ts_interval(e.init_tx, e.resp_rx);
+  reply_a = ts_interval(e.resp_rx, e.final_tx);
+  round_b = ts_interval(e.resp_tx, e.final_rx);
+  reply_b = ts_interval(e.init_rx, e.resp_tx);
+  check("DS-TWR with long replies", dstwr_tof(round_a, reply_a, round_b, reply_b), 20000, 1);
+
+  /* Zero distance, and no division by zero without an exchange */
+  make_exchange(&e, 0x2000, 0x3000, 0, 400 * UUS, 400 * UUS, 0);
+  round_a = ts_interval(e.init_tx, e.resp_rx);
+  reply_a = ts_interval(e.resp_rx, e.final_tx);
+  round_b = ts_interval(e.resp_tx, e.final_rx);
+  reply_b = ts_interval(e.init_rx, e.resp_tx);
+  check("DS-TWR, zero distance", dstwr_tof(round_a, reply_a, round_b, reply_b), 0, 1e-6);
+  check("DS-TWR, no exchange", dstwr_tof(0, 0, 0, 0), 0, 0);
+}
+/*---------------------------------------------------------------------------*/
+static uint64_t
+rand64(void)
+{
+  return ((uint64_t)rand() << 42) ^ ((uint64_t)rand() << 21) ^ (uint64_t)rand();
+}
+/*---------------------------------------------------------------------------*/
+/* Exchanges over up to 300 m with up to DRIFT of responder clock offset,
+ * anywhere on the 40-bit clocks so that some intervals cross the wraparound */
+static void
+test_fixed_point(void)
+{
+  struct exchange e;
+  uint64_t round_a, reply_a, round_b, reply_b;
+  double tof, drift, true_mm;
+  int32_t offset;
+  int i;
+
+  srand(1);
+  for(i = 0; i < VECTORS; i++) {
+    tof = rand() / (double)RAND_MAX * 300.0 / SPEED_OF_LIGHT / DWT_TIME_UNITS - 50;
+    drift = (rand() / (double)RAND_MAX - 0.5) * 2 * DRIFT;
+    offset = (int32_t)lround(drift * (1 << 30));
+    make_exchange(&e, rand64(), rand64(), tof, (100 + rand() % 2000) * UUS, (100 + rand() % 2000) * UUS, drift);
+    round_a = ts_interval(e.init_tx, e.resp_rx);
+    reply_a = ts_interval(e.resp_rx, e.final_tx);
+    round_b = ts_interval(e.resp_tx, e.final_rx);
+    reply_b = ts_interval(e.init_rx, e.resp_tx);
+    true_mm = tof * MM_PER_TICK;
+
+    check("SS-TWR fixed point", sstwr_dist_mm(round_a, reply_b, 0),
+          sstwr_tof(round_a, reply_b) * MM_PER_TICK, MAX_DIFF_MM);
+    check("SS-TWR fixed point with clock offset", sstwr_dist_mm(round_a, reply_b, offset),
+          (round_a - reply_b * (1 - offset / (double)(1 << 30))) / 2.0 * MM_PER_TICK, MAX_DIFF_MM);
+    check("SS-TWR fixed point with clock offset, true distance", sstwr_dist_mm(round_a, reply_b, offset),
+          true_mm, MAX_ERR_TICKS * MM_PER_TICK + 0.5);
+    check("DS-TWR fixed point", dstwr_dist_mm(round_a, reply_a, round_b, reply_b),
+          dstwr_tof(round_a, reply_a, round_b, reply_b) * MM_PER_TICK, MAX_DIFF_MM);
+    /* The offset cancels out to the first order, the rest is a fraction of tof * drift */
+    check("DS-TWR fixed point, true distance", dstwr_dist_mm(round_a, reply_a, round_b, reply_b),
+          true_mm, (MAX_ERR_TICKS + fabs(tof * drift)) * MM_PER_TICK + 0.5);
+  }
+}
+/*---------------------------------------------------------------------------*/
+int
+main(void)
+{
+  test_ts_interval();
+  test_sstwr();
+  test_dstwr();
+  test_fixed_point();
+
+  if(fails) {
+    printf("FAIL: %d of %d checks\n", fails, checks);
+    return 1;
+  }
+  printf("OK: %d checks\n", checks);
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,65 @@
+#include "rng-tof.h"
+/*---------------------------------------------------------------------------*/
+uint64_t
+ts_interval(uint64_t from, uint64_t to)
+{
+  /* Unsigned subtraction modulo 2^40 also covers a wraparound between the two */
+  return (to - from) & DWT_TS_MASK;
+}
+/*---------------------------------------------------------------------------*/
+uint32_t
+dtu_to_us(uint64_t dtu)
+{
+  return dtu * 10 / 638976;
+}
+/*---------------------------------------------------------------------------*/
+double
+sstwr_tof(uint64_t round, uint64_t reply)
+{
+  return ((int64_t)round - (int64_t)reply) / 2.0;
+}
+/*---------------------------------------------------------------------------*/
+double
+dstwr_tof(uint64_t round_a, uint64_t reply_a, uint64_t round_b, uint64_t reply_b)
+{
+  /* Both products are below 2^62, their difference is exact on 64 bits */
+  int64_t num = (int64_t)(round_a * round_b) - (int64_t)(reply_a * reply_b);
+  uint64_t den = round_a + round_b + reply_a + reply_b;
+
+  if(den == 0) {
+    return 0;
+  }
+  return (double)num / den;
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+sstwr_dist_mm(uint64_t round, uint64_t reply, int32_t clock_offset)
+{
+  /* Twice the time of flight in Q8, the correction being a fraction of a tick
+   * for short replies: reply < 2^32 and |clock_offset| < 2^30 (1000 ppm) */
+  int64_t twice_tof_q8 = ((int64_t)round - (int64_t)reply) * (1 << 8)
+                         + ((int64_t)reply * clock_offset) / (1L << 22);
+
+  /* mm = twice_tof / 2 * DTU_TO_MM_Q16 / 2^16, rounded; twice_tof is a few
+   * 10^5 ticks for distances up to the km, far from overflowing */
+  int64_t mm_q25 = twice_tof_q8 * DTU_TO_MM_Q16;
+  return (int32_t)((mm_q25 + (mm_q25 >= 0 ? (1L << 24) : -(1L << 24))) / (1L << 25));
+}
+/*---------------------------------------------------------------------------*/
+int32_t
+dstwr_dist_mm(uint64_t round_a, uint64_t reply_a, uint64_t round_b, uint64_t reply_b)
+{
+  int64_t num = (int64_t)(round_a * round_b) - (int64_t)(reply_a * reply_b);
+  uint64_t den = (round_a + round_b + reply_a + reply_b) >> 4;
+  int64_t tof_q4, mm_q20;
+
+  /* The denominator is ~10^8 ticks, dropping its 4 low bits keeps the time
+   * of flight in Q4 without overflowing the numerator (up to 2^62) */
+  if(den == 0) {
+    return 0;
+  }
+  tof_q4 = (num + (num >= 0 ? (int64_t)den / 2 : -(int64_t)den / 2)) / (int64_t)den;
+  mm_q20 = tof_q4 * DTU_TO_MM_Q16;
+  return (int32_t)((mm_q20 + (mm_q20 >= 0 ? (1 << 19) : -(1 << 19))) / (1L << 20));
+}
+/*---------------------------------------------------------------------------*/
@@ -0,0 +1,54 @@
+#ifndef RNG_TOF_H
+#define RNG_TOF_H
+/*---------------------------------------------------------------------------*/
+#include <stdint.h>
+/*---------------------------------------------------------------------------*/
+#define DWT_TS_MASK (0xFFFFFFFFFFULL) // 40-bit radio timestamp
+/* Millimetres per DWT_TIME_UNITS (1 / (499.2 MHz * 128)) at the speed of light
+ * in air (SPEED_OF_LIGHT, 299702547 m/s): ~4.6904 mm, in Q16 */
+#define DTU_TO_MM_Q16 (307387)
+/*---------------------------------------------------------------------------*/
+/****** Time-of-flight computation, independent of the radio ******/
+
+/* Interval from the timestamp "from" to the timestamp "to", in DWT_TIME_UNITS.
+ * The radio clock wraps around every DWT_VALUES ticks (~17.2 s): the result is
+ * correct as long as the interval is shorter than that.
+ */
+uint64_t ts_interval(uint64_t from, uint64_t to);
+
+/* Radio time interval converted to us (1 us = 63897.6 DWT_TIME_UNITS) */
+uint32_t dtu_to_us(uint64_t dtu);
+
+/* Single-sided TWR time of flight, in DWT_TIME_UNITS: half the difference between
+ * the round time measured by the initiator and the reply time of the responder.
+ */
+double sstwr_tof(uint64_t round, uint64_t reply);
+
+/* Double-sided TWR time of flight, in DWT_TIME_UNITS.
+ * Message scheme:
+ * INIT   init_tx <--- round_a ---> resp_rx <-- reply_a --> final_tx
+ *            \                     /                           \
+ *             \                   /                             \
+ * RESP       init_rx <-- reply_b --> resp_tx <--- round_b ---> final_rx
+ *
+ * tof = (round_a * round_b - reply_a * reply_b) / (round_a + round_b + reply_a + reply_b)
+ *
+ * The clock offset between the boards cancels out to the first order, even with
+ * different reply times. The products are computed on 64 bits: rounds and
+ * replies must stay below 2^31 ticks (~33 ms).
+ */
+double dstwr_tof(uint64_t round_a, uint64_t reply_a, uint64_t round_b, uint64_t reply_b);
+
+/* Fixed-point versions of the above, for the FPU-less MCU: distance in mm,
+ * rounded to the nearest mm, negative if the time of flight is.
+ *
+ * clock_offset is the responder clock offset with respect to the initiator, in
+ * units of 2^-30 (see get_clock_offset()), 0 for none: the reply time measured
+ * by the responder is scaled by (1 - clock_offset / 2^30) before the subtraction.
+ * In SS-TWR, a 10 ppm offset over a 500 us reply otherwise biases the distance
+ * by ~75 cm; DS-TWR cancels it by construction.
+ */
+int32_t sstwr_dist_mm(uint64_t round, uint64_t reply, int32_t clock_offset);
+int32_t dstwr_dist_mm(uint64_t round_a, uint64_t reply_a, uint64_t round_b, uint64_t reply_b);
+/*---------------------------------------------------------------------------*/
+#endif /* RNG_TOF_H */
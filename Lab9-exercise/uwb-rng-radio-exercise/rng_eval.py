@@ -1,76 +1,318 @@
 #!/usr/bin/env python3
+"""Ranging error analytics of a log against the deployment map.
+
+Per initiator/responder pair: bias, standard deviation and RMSE of the raw
+ranges, percentiles of the absolute error (CDF), and the same statistics by
+true distance. Per responder: success rate of the ranging attempts, with the
+failures by cause, from the initiator lines "[seqn] ranging with xxxx ..."
+and "[seqn] fail (TX err|RX err|bad frame|bad size)". Then the filtered
+ranges, receive diagnostics, position fixes and exchange latencies when the
+log has them.
+
+The log is scanned once with cheap substring checks and all the statistics
+are computed on whole columns, for multi-hour logs. With --native, the
+native scanner tools/logscan (make -C tools/logscan) parses the log instead,
+on several threads, into the same tables.
+
+Example:
+    python3 rng_eval.py log.txt --csv results/run1 --plot run1.png
+"""
 import os
 import sys
 import re
+import argparse
+import subprocess
+import tempfile
+import numpy as np
 import pandas as pd
 
+PERCENTILES = [50, 68, 90, 95, 99]
+LOGSCAN = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools", "logscan", "logscan")
+
 def distance(a, b):
     return (
         ((a[0] - b[0]) ** 2) +
         ((a[1] - b[1]) ** 2)
     ) ** 0.5
 
-def parse_file(log_file, csv_file="DEPT_evb1000_map.csv"):
+# Ex.: RANGING OK [11:0c->19:15] 169 mm 812 us (exchange latency, optional)
+regex_rng = re.compile(r"RANGING OK \[(?P<init>\w\w:\w\w)->(?P<resp>\w\w:\w\w)\] (?P<dist>-?\d+) mm(?: (?P<lat>\d+) us)?")
+# Ex.: FILTERED [11:0c->19:15] 172 mm std 88 mm speed 3 mm/s (APP_RNG_FILTER)
+regex_flt = re.compile(r"FILTERED \[(?P<init>\w\w:\w\w)->(?P<resp>\w\w:\w\w)\] (?P<dist>-?\d+) mm std (?P<std>\d+) mm")
+# Ex.: DIAG [13:9a->19:15] rx -79.3 dBm fp -81.0 dBm noise 52 fp/noise 31.2 LOS (APP_RX_DIAG)
+regex_diag = re.compile(r"DIAG \[(?P<init>\w\w:\w\w)->(?P<resp>\w\w:\w\w)\] rx (?P<rx>-?\d+\.\d) dBm "
+                        r"fp (?P<fp>-?\d+\.\d) dBm noise \d+ fp/noise (?P<snr>\d+\.\d) (?P<los>\w+)")
+# Ex.: POSITION [13:9a] 75968 3966 mm res 23 mm it 4 5210 cycles 120500 ms (APP_RNG_POS)
+regex_pos = re.compile(r"POSITION \[(?P<node>\w\w:\w\w)\] (?P<x>-?\d+) (?P<y>-?\d+) mm res \d+ mm "
+                       r"it \d+ (?P<cycles>\d+) cycles (?P<ms>\d+) ms")
+# Ex.: [12] ranging with 1915 ...
+regex_try = re.compile(r"\[(?P<seqn>\d+)\] ranging with (?P<resp>[0-9a-f]{4})")
+# Ex.: [12] fail (RX err), [12] fail (RX err) 1915 (APP_BCAST_INIT), [12] fail [1915->139a] (reply of another exchange)
+regex_fail = re.compile(r"\[(?P<seqn>\d+)\] fail (?:\((?P<why>[^)]+)\)(?: (?P<resp>[0-9a-f]{4}))?|\[)")
 
-    # Dataframe from deployment csv
-    deployment_df = pd.read_csv(csv_file)
 
-    # Obtain short addresses (last 5 characters) and add them to the dataframe
-    deployment_df['evb1000Short'] = deployment_df['evb1000'].apply(lambda x: x[-5:])
+def load_map(csv_file):
+    # Short address -> (NodeId, x, y in m)
+    df = pd.read_csv(csv_file)
+    coords = df['Coordinates'].str.strip('[]').str.split(',', expand=True)
+    df['x'] = pd.to_numeric(coords[0], errors='coerce')
+    df['y'] = pd.to_numeric(coords[1], errors='coerce')
+    df.index = df['evb1000'].str[-5:]
+    return df[['NodeId', 'x', 'y']].dropna()
 
-    # Create the id_by_addr and the coord_by_id dictionary
-    id_by_addr = dict(zip(deployment_df['evb1000Short'], deployment_df["NodeId"]))
-    coord_strings = deployment_df['Coordinates'].apply(lambda x: x.translate(str.maketrans('', '', '[] ')))
-    coordinates = []
-    for c in coord_strings:
-        try:
-            coordinates.append(list(map(float, c.split(','))))
-        except ValueError:
-            coordinates.append(None)
-    print(coordinates)
-    coord_by_id = dict(zip(deployment_df["NodeId"], coordinates))
 
-    # Regular expressions to match
-    # Ex.: RANGING OK [11:0c->19:15] 169 mm
-    regex_rng = re.compile(r".*RANGING OK \[(?P<init>\w\w:\w\w)->(?P<resp>\w\w:\w\w)\] (?P<dist>\d+) mm.*\n")
+def parse_file(log_file):
+    ranges = [] # (init, resp, dist, latency)
+    filtered = [] # (init, resp, dist)
+    diags = [] # (los, rx-fp, fp, fp/noise, index of the range)
+    fixes = [] # (node, x, y, cycles, ms)
+    attempts = [] # responder of each ranging attempt
+    fails = [] # (responder, cause)
+    last_range = {} # Index of the last raw range of each pair, for its DIAG line
+    pending = {} # Responders of the attempts in progress, by sequence number
 
-    # Open log and read line by line
-    with open(log_file, 'r') as f:
+    # Open log and read line by line, cheap substring checks first
+    with open(log_file, 'r', buffering=1 << 20, errors='replace') as f:
         for line in f:
+            pos = line.find("RANGING OK")
+            if pos >= 0:
+                m = regex_rng.match(line, pos)
+                if m:
+                    last_range[(m['init'], m['resp'])] = len(ranges)
+                    ranges.append((m['init'], m['resp'], int(m['dist']), int(m['lat'] or -1)))
+            elif "ranging with" in line:
+                m = regex_try.search(line)
+                if m:
+                    resp = m['resp'][:2] + ':' + m['resp'][2:]
+                    if pending.get('seqn') != m['seqn']:
+                        pending = {'seqn': m['seqn'], 'resp': []}
+                    pending['resp'].append(resp)
+                    attempts.append(resp)
+            elif "] fail" in line:
+                m = regex_fail.search(line)
+                if m and pending.get('seqn') == m['seqn']:
+                    why = m['why'] or "wrong peer"
+                    if m['resp']:
+                        fails.append((m['resp'][:2] + ':' + m['resp'][2:], why))
+                    else:
+                        fails.extend((resp, why) for resp in pending['resp'])
+            elif line.find("FILTERED") >= 0:
+                m = regex_flt.match(line, line.find("FILTERED"))
+                if m:
+                    filtered.append((m['init'], m['resp'], int(m['dist'])))
+            elif line.find("DIAG") >= 0:
+                m = regex_diag.match(line, line.find("DIAG"))
+                if m and (m['init'], m['resp']) in last_range:
+                    diags.append((m['los'], float(m['rx']) - float(m['fp']), float(m['fp']), float(m['snr']),
+                                  last_range.pop((m['init'], m['resp']))))
+            elif line.find("POSITION") >= 0:
+                m = regex_pos.match(line, line.find("POSITION"))
+                if m:
+                    fixes.append((m['node'], int(m['x']) / 1000, int(m['y']) / 1000, int(m['cycles']), int(m['ms'])))
+
+    return {
+        "ranges": pd.DataFrame(ranges, columns=["init", "resp", "dist", "lat"]),
+        "filtered": pd.DataFrame(filtered, columns=["init", "resp", "dist"]),
+        "diags": pd.DataFrame(diags, columns=["los", "rx-fp", "fp", "fp/noise", "range"]),
+        "fixes": pd.DataFrame(fixes, columns=["node", "x", "y", "cycles", "ms"]),
+        "attempts": pd.Series(attempts, dtype=object),
+        "fails": pd.DataFrame(fails, columns=["resp", "cause"]),
+    }
+
+
+def parse_file_native(log_file):
+    # Same tables as parse_file(), parsed by logscan
+    with tempfile.TemporaryDirectory() as tmp:
+        subprocess.run([LOGSCAN, "rng", "-o", tmp, log_file], check=True)
+
+        def table(name, columns, strings=()):
+            df = pd.read_csv(os.path.join(tmp, f"{name}.tsv"), sep="\t", dtype=dict.fromkeys(strings, str),
+                             keep_default_na=False, float_precision="round_trip", encoding_errors="replace")
+            return df if not df.empty else pd.DataFrame([], columns=columns)
+
+        attempts = table("attempts", ["resp"], ["resp"])
+        return {
+            "ranges": table("ranges", ["init", "resp", "dist", "lat"], ["init", "resp"]),
+            "filtered": table("filtered", ["init", "resp", "dist"], ["init", "resp"]),
+            "diags": table("diags", ["los", "rx-fp", "fp", "fp/noise", "range"], ["los"]),
+            "fixes": table("fixes", ["node", "x", "y", "cycles", "ms"], ["node"]),
+            "attempts": pd.Series(attempts["resp"].to_numpy(dtype=object), dtype=object),
+            "fails": table("fails", ["resp", "cause"], ["resp", "cause"]),
+        }
+
+
+def add_errors(df, nodes):
+    # True distance and signed error of each range, in mm (pairs off the map dropped)
+    a = nodes.reindex(df["init"]).to_numpy()
+    b = nodes.reindex(df["resp"]).to_numpy()
+    df = df.assign(true=np.hypot(a[:, 1] - b[:, 1], a[:, 2] - b[:, 2]) * 1000)
+    df = df.assign(err=df["dist"] - df["true"], pair=df["init"] + "->" + df["resp"])
+    return df.dropna(subset=["true"])
+
+
+def error_stats(groups):
+    # Bias, standard deviation, RMSE and absolute error percentiles of grouped ranges
+    stats = groups["err"].agg(ranges="count", bias="mean", std="std")
+    stats["rmse"] = groups["err"].apply(lambda e: np.sqrt(np.mean(np.square(e))))
+    abs_err = groups["err"].apply(lambda e: np.percentile(np.abs(e), PERCENTILES)).apply(pd.Series)
+    abs_err.columns = [f"p{p}" for p in PERCENTILES]
+    return stats.join(abs_err)
+
+
+def success_rates(data):
+    # Ranging attempts, successes and failures by cause, per responder
+    ok = data["ranges"].groupby("resp").size().rename("ok")
+    fails = data["fails"].groupby(["resp", "cause"]).size().unstack(fill_value=0)
+    df = pd.concat([data["attempts"].value_counts().rename("attempts"), ok, fails], axis=1).fillna(0).astype(int)
+    # Logs without the attempt lines (e.g. responder side only)
+    df["attempts"] = np.maximum(df["attempts"], df["ok"] + df[fails.columns].sum(axis=1))
+    df["success %"] = 100 * df["ok"] / df["attempts"]
+    return df.sort_index()
+
+
+def distance_bins(ranges, bin_m):
+    # Error statistics by true distance, bins of bin_m m
+    edges = np.arange(0, ranges["true"].max() / 1000 + bin_m, bin_m)
+    bins = pd.cut(ranges["true"] / 1000, edges, right=False)
+    stats = error_stats(ranges.groupby(bins, observed=True))
+    stats.index = [f"{b.left:g}-{b.right:g}" for b in stats.index]
+    stats.index.name = "true m"
+    return stats
+
 
-            # Match transmissions strings
-            m = regex_rng.match(line)
-            if m:
+def error_cdf(ranges):
+    # Empirical CDF of the absolute error of each pair
+    df = ranges[["pair"]].assign(abs_err=ranges["err"].abs()).sort_values(["pair", "abs_err"])
+    df["fraction"] = (df.groupby("pair").cumcount() + 1) / df.groupby("pair")["abs_err"].transform("size")
+    return df
 
-                # Get dictionary of matched groups
-                d = m.groupdict()
 
-                # Retrieve IDs of nodes and the measured distance
-                init = id_by_addr[d['init']]
-                resp = id_by_addr[d['resp']]
-                dist = int(d['dist'])
+def report(data, nodes, bin_m):
+    ranges = add_errors(data["ranges"], nodes)
+    results = {}
+    pd.set_option("display.width", 200)
+    pd.set_option("display.max_columns", 20)
 
-                # Retrieve coordinates
-                init_coords = coord_by_id[init]
-                resp_coords = coord_by_id[resp]
+    if not ranges.empty:
+        pairs = error_stats(ranges.groupby("pair"))
+        pairs.insert(0, "true", ranges.groupby("pair")["true"].first())
+        total = error_stats(ranges.assign(pair="all").groupby("pair"))
+        results["pairs"] = pd.concat([pairs, total])
+        results["distance"] = distance_bins(ranges, bin_m)
+        results["cdf"] = error_cdf(ranges)
+        print(f"Raw ranges, errors in mm ({len(ranges)} ranges, {len(pairs)} pairs):")
+        print(results["pairs"].round(1).to_string())
+        print("\nBy true distance:")
+        print(results["distance"].round(1).to_string())
 
-                # Compute the error
-                true_dist = int(distance(init_coords, resp_coords) * 1000) # mm
-                err = int(dist - true_dist)
-                print(f"Ranging error [{init}->{resp}] {err} (dist {dist} true dist {true_dist})")
+    if not data["attempts"].empty or not data["fails"].empty:
+        results["success"] = success_rates(data)
+        print("\nRanging attempts per responder:")
+        print(results["success"].round(1).to_string())
+
+    filtered = add_errors(data["filtered"], nodes)
+    if not filtered.empty:
+        print(f"\nMean absolute error: raw {ranges['err'].abs().mean():.0f} mm ({len(ranges)} ranges), "
+              f"filtered {filtered['err'].abs().mean():.0f} mm ({len(filtered)} ranges)")
+
+    diags = data["diags"]
+    if not diags.empty:
+        diags = diags.assign(abs_err=ranges["err"].abs().reindex(diags["range"]).to_numpy()).dropna()
+        for los, errors in diags.groupby("los")["abs_err"]:
+            print(f"Channel {los}: {len(errors)} ranges ({100 * len(errors) / len(diags):.0f}%), "
+                  f"mean absolute error {errors.mean():.0f} mm, max {errors.max():.0f} mm")
+        with np.errstate(divide="ignore", invalid="ignore"): # nan for a constant column
+            corr = diags[["rx-fp", "fp", "fp/noise"]].corrwith(diags["abs_err"])
+        print("Correlation with the absolute error: " +
+              ", ".join(f"{k} {v:+.2f}" for k, v in corr.items()))
+
+    fixes = data["fixes"]
+    if not fixes.empty:
+        true = nodes.reindex(fixes["node"]).to_numpy()
+        errors = np.hypot(fixes["x"] - true[:, 1], fixes["y"] - true[:, 2]) * 1000
+        duration = (fixes["ms"].iloc[-1] - fixes["ms"].iloc[0]) / 1000
+        rate = f"{(len(fixes) - 1) / duration:.2f} fixes/s" if duration > 0 else "-"
+        print(f"Position: {len(fixes)} fixes, {rate}, error mean {errors.mean():.0f} mm "
+              f"median {errors.median():.0f} mm, solver {fixes['cycles'].mean():.0f} cycles per fix")
+
+    latencies = data["ranges"]["lat"]
+    latencies = latencies[latencies >= 0]
+    if not latencies.empty:
+        print(f"Exchange latency: mean {latencies.mean():.0f} us, "
+              f"min {latencies.min()} us, max {latencies.max()} us ({len(latencies)} exchanges)")
+    return ranges, results
+
+
+def write_csv(results, prefix):
+    if os.path.dirname(prefix):
+        os.makedirs(os.path.dirname(prefix), exist_ok=True)
+    for name, df in results.items():
+        df.to_csv(f"{prefix}_{name}.csv", float_format="%.1f", index=name != "cdf")
+        print(f"Written {prefix}_{name}.csv")
+
+
+def plot(ranges, results, out_file):
+    import matplotlib
+    matplotlib.use("Agg")
+    import matplotlib.pyplot as plt
+
+    fig, ax = plt.subplots(2, 2, figsize=(12, 9))
+    for pair, df in results["cdf"].groupby("pair"):
+        ax[0, 0].plot(df["abs_err"], df["fraction"], label=pair)
+    ax[0, 0].set(xlabel="absolute error (mm)", ylabel="fraction of ranges", title="Error CDF")
+    ax[0, 0].legend(fontsize="small")
+    ax[0, 0].grid(True)
+
+    sample = ranges.sample(min(len(ranges), 20000), random_state=0)
+    ax[0, 1].scatter(sample["true"] / 1000, sample["err"], s=2, alpha=0.3)
+    ax[0, 1].set(xlabel="true distance (m)", ylabel="error (mm)", title="Error vs true distance")
+    ax[0, 1].grid(True)
+
+    pairs = results["pairs"].drop(index="all")
+    ax[1, 0].errorbar(range(len(pairs)), pairs["bias"], yerr=pairs["std"], fmt="o")
+    ax[1, 0].set_xticks(range(len(pairs)), pairs.index, rotation=45, ha="right", fontsize="small")
+    ax[1, 0].set(ylabel="bias +- std (mm)", title="Error per pair")
+    ax[1, 0].grid(True)
+
+    if "success" in results:
+        success = results["success"]
+        ax[1, 1].bar(success.index, success["success %"])
+        ax[1, 1].set_xticks(range(len(success)), success.index, rotation=45, ha="right", fontsize="small")
+    ax[1, 1].set(ylabel="success (%)", ylim=(0, 100), title="Ranging success per responder")
+    ax[1, 1].grid(True, axis="y")
+
+    fig.tight_layout()
+    fig.savefig(out_file, dpi=120)
+    print(f"Written {out_file}")
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Ranging error analytics of a log against the deployment map.")
+    parser.add_argument("log", help="ranging log")
+    parser.add_argument("-m", "--map", default="DEPT_evb1000_map.csv", help="deployment map (default: %(default)s)")
+    parser.add_argument("--csv", metavar="PREFIX", help="write the tables to PREFIX_{pairs,distance,cdf,success}.csv")
+    parser.add_argument("--plot", metavar="FILE", help="plot the error CDF, error vs distance and success rates")
+    parser.add_argument("--bin", type=float, default=2, help="true distance bin width in m (default: %(default)s)")
+    parser.add_argument("--native", action="store_true", help="parse the log with tools/logscan, for multi-GB logs")
+    return parser.parse_args()
 
 
 if __name__ == '__main__':
+    args = parse_args()
 
-    if len(sys.argv) < 2:
-        print("Error: Missing log file.")
+    # Check that the log exists
+    if not os.path.isfile(args.log):
+        print("Error: Log file not found.")
         sys.exit(1)
 
-    # Get the log path and check that it exists
-    log_file = sys.argv[1]
-    if not os.path.isfile(log_file) or not os.path.exists(log_file):
-        print("Error: Log file not found.")
+    if args.native and not os.access(LOGSCAN, os.X_OK):
+        print(f"Error: {os.path.normpath(LOGSCAN)} not built (make -C tools/logscan).")
         sys.exit(1)
 
-    # Parse file
-    parse_file(log_file)
+    nodes = load_map(args.map)
+    data = parse_file_native(args.log) if args.native else parse_file(args.log)
+    ranges, results = report(data, nodes, args.bin)
+    if args.csv and results:
+        write_csv(results, args.csv)
+    if args.plot and not ranges.empty:
+        plot(ranges, results, args.plot)
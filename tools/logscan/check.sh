@@ -0,0 +1,58 @@
+#!/bin/sh
+# Diffs the reports and CSV files of logscan against those of the lab scripts
+# (make check): connectivity.py on the Lab5 job.log and samples/sweep.log,
+# parse-stats.py on samples/collect-*.log, rng_eval.py with and without
+# --native on samples/ranging.log. logscan.cpp mirrors the scripts' parsing
+# and printing, a change to a script must pass this check.
+#
+# Usage: ./check.sh
+cd "$(dirname "$0")" || exit 1
+here=$(pwd)
+top=$(cd ../.. && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+fails=0
+
+# run NAME SIDE LOG CMD...: runs CMD on a copy of LOG in $tmp/NAME/SIDE, where
+# the CSV files land next to it, the output in the out file
+run() {
+  name=$1 side=$2 log=$3
+  shift 3
+  mkdir -p "$tmp/$name/$side"
+  cp "$log" "$tmp/$name/$side/"
+  (cd "$tmp/$name/$side" && "$@" > out 2>&1)
+}
+
+compare() {
+  if diff -r "$tmp/$1/py" "$tmp/$1/ls" > "$tmp/diff"; then
+    echo "OK   $1"
+  else
+    echo "FAIL $1"
+    head -20 "$tmp/diff"
+    fails=$((fails + 1))
+  fi
+}
+
+for log in "$top/Lab5 - The CLOVES testbed/connectivity-template/job.log" "$here/samples/sweep.log"; do
+  name=conn-$(basename "$log" .log)
+  run $name py "$log" python3 "$top/Lab5 - The CLOVES testbed/connectivity-template/connectivity.py" "$(basename "$log")"
+  run $name ls "$log" "$here/logscan" conn "$(basename "$log")"
+  compare $name
+done
+
+for mode in testbed cooja; do
+  name=stats-$mode
+  opt=
+  [ $mode = testbed ] && opt=-t
+  run $name py samples/collect-$mode.log python3 "$top/Lab7-exercise/data-collection-template-Lab7/parse-stats.py" $opt collect-$mode.log
+  sed -i 1d "$tmp/$name/py/out" # Echo of the arguments
+  run $name ls samples/collect-$mode.log "$here/logscan" stats $opt collect-$mode.log
+  compare $name
+done
+
+lab9=$top/Lab9-exercise/uwb-rng-radio-exercise
+run rng py samples/ranging.log python3 "$lab9/rng_eval.py" -m "$lab9/DEPT_evb1000_map.csv" --csv ranging ranging.log
+run rng ls samples/ranging.log python3 "$lab9/rng_eval.py" -m "$lab9/DEPT_evb1000_map.csv" --csv ranging --native ranging.log
+compare rng
+
+[ $fails -eq 0 ] || exit 1
@@ -0,0 +1,1737 @@
+/*
+ * Native scanner of the lab logs (make; see README.md): maps the log in
+ * memory, parses chunks of it on several threads in a single pass and merges
+ * the chunk results in log order, so that the reports and CSV files are those
+ * of the lab scripts, at a fraction of their runtime on multi-GB logs.
+ *
+ *   logscan conn LOG             connectivity.py LOG (Lab5)
+ *   logscan stats [-t] LOG       parse-stats.py [-t] LOG (Lab7), without the
+ *                                echo of the arguments and the plot
+ *   logscan rng -o DIR LOG       the tables rng_eval.py (Lab9) computes its
+ *                                report from, as TSV files in DIR: run by
+ *                                rng_eval.py --native
+ *
+ * The regular expressions of the scripts are matched by hand, with the same
+ * leftmost-match and backtracking results. Logs are taken as ASCII: \d and \w
+ * only match ASCII digits and word characters.
+ * Changes to the scripts must be mirrored here: make check diffs both on the
+ * bundled logs (see check.sh).
+ *
+ * Usage: ./logscan [-j THREADS] conn|stats|rng ...
+ */
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using std::string;
+using std::string_view;
+using std::vector;
+static const size_t npos = string_view::npos;
+/*---------------------------------------------------------------------------*/
+static void
+fail(const char *fmt, ...)
+{
+  va_list ap;
+
+  fflush(stdout);
+  va_start(ap, fmt);
+  fprintf(stderr, "logscan: ");
+  vfprintf(stderr, fmt, ap);
+  fprintf(stderr, "\n");
+  va_end(ap);
+  exit(1);
+}
+/*---------------------------------------------------------------------------*/
+/****** Pieces of the scripts' regular expressions ******/
+
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+static inline bool is_word(char c)
+{
+  return is_digit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+/* Python's \s, ASCII part */
+static inline bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r') || (c >= '\x1c' && c <= '\x1f'); }
+
+/* Each matcher advances i past its match and returns true, or returns false */
+static bool
+lit(string_view s, size_t &i, string_view l)
+{
+  if(s.size() - i < l.size() || memcmp(s.data() + i, l.data(), l.size()) != 0) {
+    return false;
+  }
+  i += l.size();
+  return true;
+}
+
+/* Greedy run of characters of a class, at least one: the regexes always
+ * follow one with a character out of the class, so backtracking never helps */
+template<class F> static bool
+run(string_view s, size_t &i, F in_class, string_view *out)
+{
+  size_t j = i;
+
+  while(j < s.size() && in_class(s[j])) {
+    j++;
+  }
+  if(j == i) {
+    return false;
+  }
+  if(out) {
+    *out = s.substr(i, j - i);
+  }
+  i = j;
+  return true;
+}
+
+static bool digits(string_view s, size_t &i, string_view *out = nullptr) { return run(s, i, is_digit, out); }
+static bool words(string_view s, size_t &i, string_view *out = nullptr) { return run(s, i, is_word, out); }
+
+/* -?\d+ */
+static bool
+sdigits(string_view s, size_t &i, string_view *out = nullptr)
+{
+  size_t j = i + (i < s.size() && s[i] == '-');
+
+  if(!digits(s, j)) {
+    return false;
+  }
+  if(out) {
+    *out = s.substr(i, j - i);
+  }
+  i = j;
+  return true;
+}
+
+/* \w\w:\w\w */
+static bool
+addr(string_view s, size_t &i, string_view *out)
+{
+  if(s.size() - i < 5 || !is_word(s[i]) || !is_word(s[i + 1]) || s[i + 2] != ':'
+     || !is_word(s[i + 3]) || !is_word(s[i + 4])) {
+    return false;
+  }
+  *out = s.substr(i, 5);
+  i += 5;
+  return true;
+}
+
+/* [0-9a-f]{4} */
+static bool
+hex4(string_view s, size_t &i, string_view *out)
+{
+  if(s.size() - i < 4) {
+    return false;
+  }
+  for(size_t j = i; j < i + 4; j++) {
+    if(!is_digit(s[j]) && !(s[j] >= 'a' && s[j] <= 'f')) {
+      return false;
+    }
+  }
+  *out = s.substr(i, 4);
+  i += 4;
+  return true;
+}
+
+static int64_t
+to_int(string_view s)
+{
+  int64_t v = 0;
+
+  std::from_chars(s.data(), s.data() + s.size(), v);
+  return v;
+}
+
+static double
+to_double(string_view s)
+{
+  string tmp(s);
+
+  return strtod(tmp.c_str(), nullptr);
+}
+
+/* Search of " (\d+)\.firefly < b'MSG" followed by what rest() matches at the
+ * index after MSG: the node ID of the leftmost match */
+template<class F> static bool
+firefly_msg(string_view s, string_view msg, string_view *node, F rest)
+{
+  static const string_view firefly = ".firefly < b'";
+
+  for(size_t p = s.find(firefly); p != npos; p = s.find(firefly, p + 1)) {
+    size_t d = p, i = p + firefly.size();
+
+    while(d > 0 && is_digit(s[d - 1])) {
+      d--;
+    }
+    if(d == p || d == 0 || s[d - 1] != ' ' || !lit(s, i, msg) || !rest(i)) {
+      continue;
+    }
+    *node = s.substr(d, p - d);
+    return true;
+  }
+  return false;
+}
+/*---------------------------------------------------------------------------*/
+/****** Python number formatting ******/
+
+/* repr() of a float: shortest round-trip digits, fixed notation for
+ * decimal exponents in [-4, 16) */
+static string
+py_repr(double x)
+{
+  char buf[64];
+  string digits, out;
+  int exp;
+
+  if(std::isnan(x)) {
+    return "nan";
+  }
+  if(std::isinf(x)) {
+    return x > 0 ? "inf" : "-inf";
+  }
+  /* d[.ddd]e[+-]xx */
+  char *end = std::to_chars(buf, buf + sizeof(buf), x, std::chars_format::scientific).ptr;
+  string_view s(buf, end - buf);
+  if(s[0] == '-') {
+    out = "-";
+    s.remove_prefix(1);
+  }
+  size_t e = s.find('e');
+  digits = s[0];
+  if(e > 1) {
+    digits += s.substr(2, e - 2);
+  }
+  exp = atoi(string(s.substr(e + 1)).c_str());
+
+  int decpt = exp + 1; // Digits before the decimal point
+  if(decpt > -4 && decpt <= 16) {
+    if(decpt <= 0) {
+      out += "0." + string(-decpt, '0') + digits;
+    }
+    else if((size_t)decpt >= digits.size()) {
+      out += digits + string(decpt - digits.size(), '0') + ".0";
+    }
+    else {
+      out += digits.substr(0, decpt) + "." + digits.substr(decpt);
+    }
+  }
+  else {
+    snprintf(buf, sizeof(buf), "e%c%02d", exp < 0 ? '-' : '+', std::abs(exp));
+    out += digits.substr(0, 1) + (digits.size() > 1 ? "." + digits.substr(1) : "") + buf;
+  }
+  return out;
+}
+
+/* round(x, 2): correctly rounded like printf, then back to a float */
+static double
+py_round2(double x)
+{
+  char buf[512];
+
+  snprintf(buf, sizeof(buf), "%.2f", x);
+  return strtod(buf, nullptr);
+}
+
+/* os.path.splitext(path)[0] */
+static string
+py_splitext0(const string &path)
+{
+  size_t sep = path.rfind('/'), base = sep == npos ? 0 : sep + 1, dot = path.rfind('.');
+
+  if(dot == npos || dot < base) {
+    return path;
+  }
+  for(size_t i = base; i < dot; i++) {
+    if(path[i] != '.') {
+      return path.substr(0, dot); // Not a leading dot of the file name
+    }
+  }
+  return path;
+}
+/*---------------------------------------------------------------------------*/
+/* Dict with the insertion order of Python's */
+template<class K, class V, class H = std::hash<K>>
+struct omap {
+  std::unordered_map<K, size_t, H> index;
+  vector<std::pair<K, V>> items;
+
+  V *find(const K &k)
+  {
+    auto it = index.find(k);
+    return it == index.end() ? nullptr : &items[it->second].second;
+  }
+  const V *find(const K &k) const
+  {
+    auto it = index.find(k);
+    return it == index.end() ? nullptr : &items[it->second].second;
+  }
+  V &operator[](const K &k)
+  {
+    auto res = index.emplace(k, items.size());
+    if(res.second) {
+      items.emplace_back(k, V());
+    }
+    return items[res.first->second].second;
+  }
+};
+/*---------------------------------------------------------------------------*/
+/****** Log mapping and chunked parsing ******/
+
+struct log_file {
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+static log_file
+map_log(const char *path)
+{
+  log_file log;
+  struct stat st;
+  int fd = open(path, O_RDONLY);
+
+  if(fd < 0 || fstat(fd, &st) < 0) {
+    fail("cannot open %s: %s", path, strerror(errno));
+  }
+  log.size = st.st_size;
+  if(log.size > 0) {
+    void *p = mmap(nullptr, log.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(p == MAP_FAILED) {
+      fail("cannot map %s: %s", path, strerror(errno));
+    }
+    madvise(p, log.size, MADV_SEQUENTIAL);
+    log.data = (const char *)p;
+  }
+  close(fd);
+  return log;
+}
+
+/* Lines split on \n, \r\n and \r, like Python text files */
+template<class F> static void
+for_lines(string_view chunk, F line_cb)
+{
+  const char *p = chunk.data(), *end = p + chunk.size();
+
+  while(p < end) {
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    const char *eol = nl ? nl : end;
+    for(const char *cr; (cr = (const char *)memchr(p, '\r', eol - p)) != nullptr; p = cr + 1) {
+      line_cb(string_view(p, cr - p));
+    }
+    line_cb(string_view(p, eol - p));
+    p = eol + 1;
+  }
+}
+
+/* Log bytes parsed by each thread before the results are handed over, which
+ * bounds the memory of the per-line results on multi-GB logs */
+#define SCAN_WINDOW (64 << 20)
+
+/* Parse the log window by window, each window in one chunk per thread ending
+ * at a line break: consume() gets one Chunk result per chunk, in log order.
+ * The pages of a window are dropped once consumed, results must not keep
+ * views of the lines. */
+template<class Chunk, class F, class G> static void
+scan(const log_file &log, unsigned threads, F parse_line, G consume)
+{
+  size_t start = 0, page = sysconf(_SC_PAGESIZE);
+
+  while(start < log.size) {
+    size_t first = start / page * page;
+    vector<string_view> chunks;
+    size_t size = std::min<size_t>(SCAN_WINDOW, (log.size - start + threads - 1) / threads);
+    for(unsigned k = 0; k < threads && start < log.size; k++) {
+      size_t end = std::min(log.size, start + size);
+      const char *nl = (const char *)memchr(log.data + end, '\n', log.size - end);
+      end = nl ? nl - log.data + 1 : log.size;
+      chunks.emplace_back(log.data + start, end - start);
+      start = end;
+    }
+
+    vector<Chunk> results(chunks.size());
+    auto work = [&](size_t k) {
+      for_lines(chunks[k], [&](string_view line) { parse_line(line, results[k]); });
+    };
+    vector<std::thread> workers;
+    for(size_t k = 1; k < chunks.size(); k++) {
+      workers.emplace_back(work, k);
+    }
+    work(0);
+    for(auto &w : workers) {
+      w.join();
+    }
+    for(auto &r : results) {
+      consume(r);
+    }
+    madvise((void *)(log.data + first), start - first, MADV_DONTNEED);
+  }
+}
+
+static FILE *
+open_out(const string &path)
+{
+  FILE *f = fopen(path.c_str(), "w");
+
+  if(!f) {
+    fail("cannot write %s: %s", path.c_str(), strerror(errno));
+  }
+  setvbuf(f, nullptr, _IOFBF, 1 << 20);
+  return f;
+}
+
+/* CSV fields as printf("%lld") and printf("%.6f") would write them, followed by
+ * sep, without parsing a format for each of the millions of fields */
+static void
+put_int(FILE *f, int64_t v, char sep)
+{
+  char buf[32], *end = std::to_chars(buf, buf + sizeof(buf) - 1, v).ptr;
+
+  *end++ = sep;
+  fwrite(buf, 1, end - buf, f);
+}
+
+static void
+put_fixed6(FILE *f, double v, char sep)
+{
+  char buf[400], *end = std::to_chars(buf, buf + sizeof(buf) - 1, v, std::chars_format::fixed, 6).ptr;
+
+  *end++ = sep;
+  fwrite(buf, 1, end - buf, f);
+}
+/*---------------------------------------------------------------------------*/
+/****** connectivity.py ******/
+
+/* Sweep configuration of a record, untagged records first */
+struct config {
+  bool tagged;
+  int64_t ch, pw;
+
+  bool operator<(const config &o) const
+  {
+    return std::make_tuple(tagged, ch, pw) < std::make_tuple(o.tagged, o.ch, o.pw);
+  }
+  bool operator==(const config &o) const { return tagged == o.tagged && ch == o.ch && pw == o.pw; }
+};
+
+/* (?:,? CH (\d+) PW (-?\d+))? at the end of the TX/RX/STAT records */
+static config
+tag(string_view s, size_t i)
+{
+  string_view ch, pw;
+  size_t j = i + (i < s.size() && s[i] == ',');
+
+  if(lit(s, j, " CH ") && digits(s, j, &ch) && lit(s, j, " PW ") && sdigits(s, j, &pw)) {
+    return {true, to_int(ch), to_int(pw)};
+  }
+  return {false, 0, 0};
+}
+
+/* Per-link counters: received, RSSI sum, min RSSI, max RSSI */
+struct link_stats {
+  int64_t count, total, low, high;
+};
+typedef omap<string, int64_t> tx_counts;
+typedef omap<string, omap<string, link_stats>> rx_counts;
+
+static void
+count_rx(rx_counts &rx, const string &from, const string &to, const link_stats &v)
+{
+  auto &links = rx[from];
+  link_stats *link = links.find(to);
+
+  if(!link) {
+    links[to] = v;
+  }
+  else {
+    link->count += v.count;
+    link->total += v.total;
+    link->low = std::min(link->low, v.low);
+    link->high = std::max(link->high, v.high);
+  }
+}
+
+struct drop_key {
+  string node;
+  config cfg;
+
+  bool operator==(const drop_key &o) const { return node == o.node && cfg == o.cfg; }
+};
+struct drop_hash {
+  size_t operator()(const drop_key &k) const
+  {
+    return std::hash<string>()(k.node) ^ (k.cfg.tagged ? std::hash<int64_t>()(k.cfg.ch * 1000 + k.cfg.pw) : 0);
+  }
+};
+
+/* Counters of a chunk: the last value of a key wins for the cumulative
+ * counters, the others are summed */
+struct conn_chunk {
+  std::map<config, tx_counts> tx;
+  std::map<config, rx_counts> rx;
+  omap<string, int64_t> stat_tx;
+  omap<string, link_stats> stat_rx;            // "fromto"
+  omap<drop_key, int64_t, drop_hash> stat_drop;
+  std::map<int64_t, std::unordered_map<string, std::pair<int64_t, int64_t>>> rounds;
+  omap<string, string> ids;
+};
+
+static void
+conn_line(string_view s, conn_chunk &c)
+{
+  string_view node, a, b, n1, n2, n3, n4;
+  size_t pos, i;
+
+  if(s.find("ROUND ") != npos) {
+    if(firefly_msg(s, "ROUND ", &node, [&](size_t j) {
+         return digits(s, j, &n1) && lit(s, j, " TX ") && digits(s, j, &n2) && lit(s, j, " RX ") && digits(s, j, &n3);
+       })) {
+      c.rounds[to_int(n1)][string(node)] = {to_int(n2), to_int(n3)};
+      return;
+    }
+  }
+
+  if((pos = s.find("STAT ")) != npos) {
+    i = pos;
+    if(lit(s, i, "STAT RX ") && addr(s, i, &a) && lit(s, i, "->") && addr(s, i, &b) && lit(s, i, " ")
+       && digits(s, i, &n1) && lit(s, i, " ") && sdigits(s, i, &n2) && lit(s, i, " ")
+       && sdigits(s, i, &n3) && lit(s, i, " ") && sdigits(s, i, &n4)) {
+      config cfg = tag(s, i);
+      link_stats v = {to_int(n1), to_int(n2), to_int(n3), to_int(n4)};
+      if(!cfg.tagged) {
+        c.stat_rx[string(a) + string(b)] = v;
+      }
+      else {
+        count_rx(c.rx[cfg], string(a), string(b), v);
+      }
+      return;
+    }
+    i = pos;
+    if(lit(s, i, "STAT TX ") && addr(s, i, &a) && lit(s, i, " ") && digits(s, i, &n1)) {
+      config cfg = tag(s, i);
+      if(!cfg.tagged) {
+        c.stat_tx[string(a)] = to_int(n1);
+      }
+      else {
+        c.tx[cfg][string(a)] += to_int(n1);
+      }
+      return;
+    }
+    config cfg;
+    if(firefly_msg(s, "STAT DROP ", &node, [&](size_t j) {
+         if(!digits(s, j, &n1)) {
+           return false;
+         }
+         cfg = tag(s, j);
+         return true;
+       })) {
+      int64_t &drops = c.stat_drop[{string(node), cfg}];
+      drops = cfg.tagged ? drops + to_int(n1) : to_int(n1);
+      return;
+    }
+  }
+
+  /* Reception strings, by far the most frequent record */
+  if((pos = s.find("RX ")) != npos) {
+    i = pos;
+    if(lit(s, i, "RX ") && addr(s, i, &a) && lit(s, i, "->") && addr(s, i, &b) && lit(s, i, ", RSSI = ")
+       && sdigits(s, i, &n1) && lit(s, i, "dBm")) {
+      int64_t rssi = to_int(n1);
+      count_rx(c.rx[tag(s, i)], string(a), string(b), {1, rssi, rssi, rssi});
+      return;
+    }
+  }
+
+  if((pos = s.find("TX ")) != npos) {
+    i = pos;
+    if(lit(s, i, "TX ") && addr(s, i, &a)) {
+      c.tx[tag(s, i)][string(a)] += 1;
+      return;
+    }
+  }
+
+  if(s.find("Rime configured") != npos) {
+    if(firefly_msg(s, "Rime configured with address ", &node, [&](size_t j) { return addr(s, j, &a); })) {
+      c.ids[string(a)] = string(node);
+    }
+  }
+}
+
+/* Keys of the later chunk come after those of the earlier one, its values
+ * replace them (last) or add up (sum) */
+template<class M> static void
+merge_last(M &into, const M &from)
+{
+  for(auto &kv : from.items) {
+    into[kv.first] = kv.second;
+  }
+}
+
+static void
+merge_sum(tx_counts &into, const tx_counts &from)
+{
+  for(auto &kv : from.items) {
+    into[kv.first] += kv.second;
+  }
+}
+
+static void
+merge_sum(rx_counts &into, const rx_counts &from)
+{
+  for(auto &links : from.items) {
+    for(auto &link : links.second.items) {
+      count_rx(into, links.first, link.first, link.second);
+    }
+  }
+}
+
+static void
+merge_conn(conn_chunk &all, conn_chunk &c)
+{
+  for(auto &kv : c.tx) {
+    merge_sum(all.tx[kv.first], kv.second);
+  }
+  for(auto &kv : c.rx) {
+    merge_sum(all.rx[kv.first], kv.second);
+  }
+  merge_last(all.stat_tx, c.stat_tx);
+  merge_last(all.stat_rx, c.stat_rx);
+  for(auto &kv : c.stat_drop.items) {
+    int64_t &drops = all.stat_drop[kv.first];
+    drops = kv.first.cfg.tagged ? drops + kv.second : kv.second;
+  }
+  for(auto &r : c.rounds) {
+    for(auto &n : r.second) {
+      all.rounds[r.first][n.first] = n.second;
+    }
+  }
+  merge_last(all.ids, c.ids);
+}
+
+/* Counters of a configuration, by testbed ID */
+struct conn_result {
+  config cfg;
+  tx_counts tx;
+  rx_counts rx;
+};
+
+static double
+ratio(int64_t num, int64_t den)
+{
+  if(den == 0) {
+    fail("division by zero"); // Where the script raises ZeroDivisionError
+  }
+  return (double)num / (double)den;
+}
+
+static void
+print_results(const tx_counts &tx, const rx_counts &rx)
+{
+  for(auto &t : tx.items) {
+    printf("FROM: %-5s\t\t# PKT SENT: %lld\n", t.first.c_str(), (long long)t.second);
+    if(const auto *links = rx.find(t.first)) {
+      for(auto &l : links->items) {
+        const link_stats &v = l.second;
+        printf("\tTO: %-5s\t# PKT RCVD: %lld\tPRR: %s%%\tAverage RSSI: %sdBm\tMin/Max RSSI: %lld/%llddBm\n",
+               l.first.c_str(), (long long)v.count, py_repr(py_round2(ratio(v.count, t.second) * 100)).c_str(),
+               py_repr(py_round2(ratio(v.total, v.count))).c_str(), (long long)v.low, (long long)v.high);
+      }
+    }
+    printf("\n\n");
+  }
+}
+
+static void
+write_matrices(const string &log_path, const conn_result &r)
+{
+  vector<string> ids;
+  std::unordered_set<string> seen;
+  auto add = [&](const string &id) {
+    if(seen.insert(id).second) {
+      ids.push_back(id);
+    }
+  };
+  for(auto &t : r.tx.items) {
+    add(t.first);
+  }
+  for(auto &links : r.rx.items) {
+    add(links.first);
+    for(auto &l : links.second.items) {
+      add(l.first);
+    }
+  }
+  std::stable_sort(ids.begin(), ids.end(), [](const string &a, const string &b) { return to_int(a) < to_int(b); });
+
+  char suffix[64];
+  snprintf(suffix, sizeof(suffix), "-ch%lld-pw%lld", (long long)r.cfg.ch, (long long)r.cfg.pw);
+  string common = py_splitext0(log_path) + suffix;
+  FILE *fprr = open_out(common + "-prr.csv"), *frssi = open_out(common + "-rssi.csv");
+  string header = "from/to";
+  for(auto &id : ids) {
+    header += "," + id;
+  }
+  fprintf(fprr, "%s\n", header.c_str());
+  fprintf(frssi, "%s\n", header.c_str());
+  for(auto &tx_id : ids) {
+    const int64_t *sent = r.tx.find(tx_id);
+    const auto *links = r.rx.find(tx_id);
+    fprintf(fprr, "%s", tx_id.c_str());
+    fprintf(frssi, "%s", tx_id.c_str());
+    for(auto &rx_id : ids) {
+      const link_stats *link = links ? links->find(rx_id) : nullptr;
+      if(!link || !sent || !*sent) {
+        fprintf(fprr, ",%s", sent && *sent ? "0" : "");
+        fprintf(frssi, ",");
+      }
+      else {
+        fprintf(fprr, ",%.2f", ratio(link->count, *sent) * 100);
+        fprintf(frssi, ",%.2f", ratio(link->total, link->count));
+      }
+    }
+    fprintf(fprr, "\n");
+    fprintf(frssi, "\n");
+  }
+  fclose(fprr);
+  fclose(frssi);
+}
+
+static void
+print_configs(const string &log_path, const vector<conn_result> &results)
+{
+  printf("Sweep summary\n");
+  for(auto &r : results) {
+    if(!r.cfg.tagged) {
+      continue;
+    }
+    vector<double> prrs;
+    for(auto &links : r.rx.items) {
+      const int64_t *sent = r.tx.find(links.first);
+      if(sent && *sent) {
+        for(auto &l : links.second.items) {
+          prrs.push_back(ratio(l.second.count, *sent) * 100);
+        }
+      }
+    }
+    double sum = 0; // Left to right, like sum()
+    for(double p : prrs) {
+      sum += p;
+    }
+    printf("CHANNEL: %-3lld\tTX POWER: %3llddBm\t# LINKS: %zu\tAverage PRR: %s%%\n",
+           (long long)r.cfg.ch, (long long)r.cfg.pw, prrs.size(),
+           prrs.empty() ? "0" : py_repr(py_round2(sum / prrs.size())).c_str());
+    write_matrices(log_path, r);
+  }
+  printf("\n\n");
+}
+
+static void
+print_rounds(const rx_counts &rx, const conn_chunk &c)
+{
+  vector<double> prrs;
+
+  printf("Per-round statistics\n");
+  for(auto &r : c.rounds) {
+    int64_t tx_round = 0, rx_round = 0, expected = 0;
+    for(auto &n : r.second) {
+      const auto *links = rx.find(n.first);
+      tx_round += n.second.first;
+      rx_round += n.second.second;
+      expected += n.second.first * (links ? (int64_t)links->items.size() : 0);
+    }
+    string prr = "0";
+    if(expected) {
+      prrs.push_back(ratio(rx_round, expected) * 100);
+      prr = py_repr(py_round2(prrs.back()));
+    }
+    printf("ROUND: %-5lld\tNODES: %zu\t# PKT SENT: %lld\t# PKT RCVD: %lld\tPRR: %s%%\n", (long long)r.first,
+           r.second.size(), (long long)tx_round, (long long)rx_round, prr.c_str());
+  }
+  if(!prrs.empty()) {
+    double sum = 0;
+    for(double p : prrs) {
+      sum += p;
+    }
+    printf("Average PRR over %zu rounds: %s%%\n", prrs.size(), py_repr(py_round2(sum / prrs.size())).c_str());
+  }
+  printf("\n\n");
+}
+
+static int
+run_conn(int argc, char **argv, unsigned threads)
+{
+  struct stat st;
+
+  if(argc < 2) {
+    printf("Error: Missing log file.\n");
+    return 1;
+  }
+  string log_path = argv[1];
+  if(stat(log_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+    printf("Error: Log file not found.\n");
+    return 1;
+  }
+
+  log_file log = map_log(log_path.c_str());
+  conn_chunk all;
+  scan<conn_chunk>(log, threads, conn_line, [&all](conn_chunk &c) { merge_conn(all, c); });
+
+  /* Merge the latest on-node counters with the per-packet ones */
+  config none = {false, 0, 0};
+  for(auto &kv : all.stat_tx.items) {
+    all.tx[none][kv.first] += kv.second;
+  }
+  for(auto &kv : all.stat_rx.items) {
+    count_rx(all.rx[none], kv.first.substr(0, 5), kv.first.substr(5), kv.second);
+  }
+
+  /* Map Rime addresses to testbed IDs */
+  omap<string, bool> unknown;
+  auto to_id = [&](const string &a) -> const string * {
+    const string *id = all.ids.find(a);
+    if(!id) {
+      unknown[a] = true;
+    }
+    return id;
+  };
+  std::map<config, conn_result> by_cfg;
+  for(auto &kv : all.tx) {
+    by_cfg[kv.first].cfg = kv.first;
+  }
+  for(auto &kv : all.rx) {
+    by_cfg[kv.first].cfg = kv.first;
+  }
+  vector<conn_result> results;
+  for(auto &kv : by_cfg) {
+    conn_result r;
+    r.cfg = kv.first;
+    auto txc = all.tx.find(kv.first);
+    if(txc != all.tx.end()) {
+      for(auto &t : txc->second.items) {
+        if(const string *id = to_id(t.first)) {
+          r.tx[*id] += t.second;
+        }
+      }
+    }
+    auto rxc = all.rx.find(kv.first);
+    if(rxc != all.rx.end()) {
+      for(auto &links : rxc->second.items) {
+        const string *from = to_id(links.first);
+        for(auto &l : links.second.items) {
+          const string *to = to_id(l.first);
+          if(from && to) {
+            count_rx(r.rx, *from, *to, l.second);
+          }
+        }
+      }
+    }
+    results.push_back(std::move(r));
+  }
+
+  for(auto &kv : unknown.items) {
+    printf("ID not found for address %s\n", kv.first.c_str());
+  }
+  for(auto &kv : all.stat_drop.items) {
+    char setting[96] = "";
+    if(kv.first.cfg.tagged) {
+      snprintf(setting, sizeof(setting), " on channel %lld, TX power %llddBm",
+               (long long)kv.first.cfg.ch, (long long)kv.first.cfg.pw);
+    }
+    printf("Node %s: neighbour table full, %lld receptions not counted%s\n", kv.first.node.c_str(),
+           (long long)kv.second, setting);
+  }
+
+  bool sweep = false;
+  for(auto &r : results) {
+    if(r.cfg.tagged) {
+      printf("########## CHANNEL %lld, TX POWER %llddBm ##########\n\n", (long long)r.cfg.ch, (long long)r.cfg.pw);
+      sweep = true;
+    }
+    print_results(r.tx, r.rx);
+  }
+  if(sweep) {
+    print_configs(log_path, results);
+  }
+  if(!all.rounds.empty() && !results.empty() && !results[0].cfg.tagged) {
+    print_rounds(results[0].rx, all);
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/****** parse-stats.py ******/
+
+#define SINK_ID 1
+
+/* Firefly addresses -- DISI Povo 2 topology */
+static const std::unordered_map<string_view, int> addr_id_map = {
+  {"f7:9c",  1}, {"d9:76",  2}, {"f3:84",  3}, {"f3:ee",  4}, {"d8:f1",  5},
+  {"f3:9a",  6}, {"de:21",  7}, {"f2:a1",  8}, {"d8:b5",  9}, {"f2:1e", 10},
+  {"d9:5f", 11}, {"f2:33", 12}, {"de:0c", 13}, {"f2:0e", 14}, {"d9:49", 15},
+  {"f3:dc", 16}, {"d9:23", 17}, {"f3:8b", 18}, {"f3:c2", 19}, {"f3:b7", 20},
+  {"de:e4", 21}, {"f3:88", 22}, {"f7:9a", 23}, {"f7:e7", 24}, {"f2:85", 25},
+  {"f2:27", 26}, {"f2:64", 27}, {"f3:d3", 28}, {"f3:8d", 29}, {"f7:e1", 30},
+  {"de:af", 31}, {"f2:91", 32}, {"f2:d7", 33}, {"f3:a3", 34}, {"f2:d9", 35},
+  {"d9:9f", 36}
+};
+
+/* Seconds since the epoch of a broken-down local time, solved the way
+ * datetime.timestamp() does for naive datetimes (fold 0) */
+static int64_t
+days_from_civil(int64_t y, unsigned m, unsigned d)
+{
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int64_t)doe - 719468;
+}
+
+static int64_t
+local(int64_t u)
+{
+  time_t t = u;
+  struct tm tm;
+
+  localtime_r(&t, &tm);
+  return days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) * 86400
+         + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+}
+
+static int64_t
+local_to_seconds(int64_t t)
+{
+  int64_t a = local(t) - t, u1 = t - a, t1 = local(u1), b, u2, t2;
+
+  if(t1 == t) {
+    u2 = u1 - 24 * 3600;
+    b = local(u2) - u2;
+    if(a == b) {
+      return u1;
+    }
+  }
+  else {
+    b = t1 - u1;
+  }
+  u2 = t - b;
+  t2 = local(u2);
+  if(t2 == t) {
+    return u2;
+  }
+  if(t1 == t) {
+    return u1;
+  }
+  return std::max(u1, u2); // In a gap
+}
+
+static bool
+two_digits(string_view s, size_t i, int lo, int hi, int *v)
+{
+  if(!is_digit(s[i]) || !is_digit(s[i + 1])) {
+    return false;
+  }
+  *v = (s[i] - '0') * 10 + s[i + 1] - '0';
+  return *v >= lo && *v <= hi;
+}
+
+/* Testbed timestamps look like "2025-10-28 16:22:11,761": the whole second
+ * (converted once per second, as strptime is slow), then the fraction */
+struct testbed_clock {
+  string second;
+  double base = 0;
+
+  const char *timestamp(string_view time_str, double *secs)
+  {
+    string_view sec = time_str.substr(0, 19), frac = time_str.substr(std::min<size_t>(20, time_str.size()));
+
+    if(sec != second) {
+      int y, mo, d, h, mi, s;
+      static const int mdays[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+      if(sec.size() != 19 || !two_digits(sec, 0, 0, 99, &y) || !two_digits(sec, 2, 0, 99, &s) || sec[4] != '-'
+         || !two_digits(sec, 5, 1, 12, &mo) || sec[7] != '-' || !two_digits(sec, 8, 1, 31, &d) || sec[10] != ' '
+         || !two_digits(sec, 11, 0, 23, &h) || sec[13] != ':' || !two_digits(sec, 14, 0, 59, &mi) || sec[16] != ':') {
+        return "time data does not match format '%Y-%m-%d %H:%M:%S'";
+      }
+      y = y * 100 + s; // Both halves of the year
+      if(!two_digits(sec, 17, 0, 59, &s)) {
+        return "time data does not match format '%Y-%m-%d %H:%M:%S'";
+      }
+      if(d > mdays[mo - 1] || (mo == 2 && d == 29 && !(y % 4 == 0 && (y % 100 != 0 || y % 400 == 0)))) {
+        return "day is out of range for month";
+      }
+      second = string(sec);
+      base = (double)local_to_seconds(days_from_civil(y, mo, d) * 86400 + h * 3600 + mi * 60 + s);
+    }
+    if(frac.empty()) {
+      *secs = base;
+      return nullptr;
+    }
+    for(char c : frac) {
+      if(!is_digit(c)) {
+        return "invalid literal for int() with base 10";
+      }
+    }
+    *secs = base + (double)to_int(frac) / std::pow(10.0, (double)frac.size());
+    return nullptr;
+  }
+};
+
+/* Cooja timestamps are either microseconds ("1234567", headless runs) or
+ * formatted as "[hh:]mm:ss.mmm" */
+static const char *
+cooja_timestamp(string_view time_str, double *secs)
+{
+  if(time_str.find(':') == npos) {
+    for(char c : time_str) {
+      if(!is_digit(c)) {
+        return "invalid literal for int() with base 10";
+      }
+    }
+    *secs = (double)to_int(time_str) / 1000000;
+    return nullptr;
+  }
+  double seconds = 0;
+  size_t start = 0;
+  for(size_t end; start <= time_str.size(); start = end + 1) {
+    end = time_str.find(':', start);
+    end = end == npos ? time_str.size() : end;
+    string field(time_str.substr(start, end - start));
+    char *stop;
+    double v = strtod(field.c_str(), &stop);
+    if(field.empty() || *stop || field.find_first_of("xX_") != npos) {
+      return "could not convert string to float";
+    }
+    seconds = seconds * 60 + v;
+  }
+  *secs = seconds;
+  return nullptr;
+}
+
+/* Python's int(s, 16) */
+static bool
+py_hex(string_view s, int64_t *v)
+{
+  string hex;
+
+  if(s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+    s.remove_prefix(s[2] == '_' ? 3 : 2);
+  }
+  for(size_t i = 0; i < s.size(); i++) {
+    if(s[i] == '_' && i > 0 && i + 1 < s.size() && s[i - 1] != '_') {
+      continue;
+    }
+    if(!isxdigit((unsigned char)s[i])) {
+      return false;
+    }
+    hex += s[i];
+  }
+  if(hex.empty()) {
+    return false;
+  }
+  *v = strtoll(hex.c_str(), nullptr, 16);
+  return true;
+}
+
+struct stats_event {
+  enum { NODE, RECV, SENT, BEACON } type;
+  int64_t self_id, seqn, hops, src;
+  bool src_known;
+  double secs;                 // Time in s, when the script converts it
+  string_view time;            // As in the log
+  string ts;                   // Time as written to the CSV files, testbed
+  string_view addr;            // Source address of a testbed reception
+  const char *error;           // The script raises an exception on this record
+};
+
+struct stats_chunk {
+  vector<stats_event> events;
+  testbed_clock clock;
+};
+
+/* (\d+).(\d+) then a quote if quoted: the script only uses the node IDs of
+ * the address lines, what matters is whether there is a match */
+static bool
+boot_addr(string_view s, size_t i, bool quoted)
+{
+  size_t r = i;
+
+  while(r < s.size() && is_digit(s[r])) {
+    r++;
+  }
+  for(size_t k = i + 1; k <= r && k < s.size(); k++) {
+    size_t j = k + 1;
+    if(digits(s, j) && (!quoted || lit(s, j, "'"))) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void
+stats_line(string_view s, stats_chunk &c, bool testbed)
+{
+  stats_event ev = {};
+  size_t i = 0;
+  string_view self_id, n1, n2, n3, src1, src2;
+
+  bool app = s.find("App: ") != npos, rime = s.find("Rime ") != npos;
+  bool beacon = !app && !rime && s.find("sending beacon") != npos;
+  if(!app && !rime && !beacon) {
+    return; // Parent selections only count for the sweep summaries
+  }
+
+  /* Record prefix of the lines of a node */
+  if(testbed) {
+    if(!lit(s, i, "[") || s.size() - i < 23) {
+      return;
+    }
+    ev.time = s.substr(1, 23);
+    i += 23;
+    if(!lit(s, i, "] INFO:firefly.") || !digits(s, i, &self_id) || !lit(s, i, ": ") || !digits(s, i)
+       || !lit(s, i, ".firefly < b'")) {
+      return;
+    }
+  }
+  else {
+    if(!run(s, i, [](char ch) { return is_word(ch) || ch == ':' || ch == '.'; }, &ev.time)
+       || !run(s, i, is_space, nullptr) || !lit(s, i, "ID:") || !digits(s, i, &self_id)
+       || !run(s, i, is_space, nullptr)) {
+      return;
+    }
+  }
+  ev.self_id = to_int(self_id);
+  auto to_seconds = [&]() {
+    ev.error = testbed ? c.clock.timestamp(ev.time, &ev.secs) : cooja_timestamp(ev.time, &ev.secs);
+  };
+  const char *q = testbed ? "'" : "";
+
+  if(beacon) {
+    if(lit(s, i, "my_collect: sending beacon: seqn ") && digits(s, i, &n1)) {
+      ev.type = stats_event::BEACON;
+      ev.seqn = to_int(n1);
+      if(ev.self_id == SINK_ID) {
+        to_seconds();
+        c.events.push_back(std::move(ev));
+      }
+    }
+    return;
+  }
+
+  size_t j = i;
+  if(lit(s, j, testbed ? "Rime configured with address " : "Rime started with address ")
+     && boot_addr(s, j, testbed)) {
+    ev.type = stats_event::NODE;
+    c.events.push_back(std::move(ev));
+    return;
+  }
+  j = i;
+  if(lit(s, j, "App: Recv from ") && words(s, j, &src1) && lit(s, j, ":") && words(s, j, &src2)
+     && lit(s, j, " seqn ") && digits(s, j, &n1) && lit(s, j, " hops ") && digits(s, j, &n2) && lit(s, j, q)) {
+    ev.type = stats_event::RECV;
+    ev.seqn = to_int(n1);
+    ev.hops = to_int(n2);
+    if(testbed) {
+      to_seconds();
+      ev.ts = py_repr(ev.secs);
+      ev.addr = s.substr(src1.data() - s.data(), src2.data() + src2.size() - src1.data());
+      auto id = addr_id_map.find(ev.addr);
+      ev.src_known = id != addr_id_map.end();
+      ev.src = ev.src_known ? id->second : 0;
+    }
+    else {
+      int64_t lo, hi;
+      if(!py_hex(src1, &lo) || !py_hex(src2, &hi)) {
+        ev.error = "invalid literal for int() with base 16";
+      }
+      else {
+        ev.src = lo + (hi << 8); // Node IDs are stored little endian in the Rime address
+      }
+      ev.src_known = true;
+      if(!ev.error && ev.self_id == SINK_ID) {
+        to_seconds();
+      }
+    }
+    c.events.push_back(std::move(ev));
+    return;
+  }
+  j = i;
+  if(lit(s, j, "App: Send seqn ") && digits(s, j, &n1) && lit(s, j, q)) {
+    ev.type = stats_event::SENT;
+    ev.seqn = to_int(n1);
+    to_seconds();
+    if(testbed) {
+      ev.ts = py_repr(ev.secs);
+    }
+    c.events.push_back(std::move(ev));
+  }
+}
+
+static double
+percentile(const vector<double> &values, int p)
+{
+  if(values.size() == 1) {
+    return values[0];
+  }
+  double k = (double)((int64_t)(values.size() - 1) * p) / 100;
+  size_t f = (size_t)k, c = std::min(f + 1, values.size() - 1);
+  return values[f] + (values[c] - values[f]) * (k - f);
+}
+
+template<class K> static void
+print_latency_table(const char *title, const std::map<K, vector<double>> &groups)
+{
+  printf("%8s %7s %9s %9s %9s %9s %9s\n", title, "Packets", "Mean", "p50", "p95", "p99", "Max");
+  for(auto &g : groups) {
+    vector<double> lat = g.second;
+    double sum = 0;
+    std::sort(lat.begin(), lat.end());
+    for(double l : lat) {
+      sum += l;
+    }
+    string key;
+    if constexpr(std::is_same<K, string>::value) {
+      key = g.first;
+    }
+    else {
+      key = std::to_string(g.first);
+    }
+    printf("%8s %7zu %9.2f %9.2f %9.2f %9.2f %9.2f\n", key.c_str(), lat.size(), 1000 * sum / lat.size(),
+           1000 * percentile(lat, 50), 1000 * percentile(lat, 95), 1000 * percentile(lat, 99), 1000 * lat.back());
+  }
+}
+
+static int
+run_stats(int argc, char **argv, unsigned threads)
+{
+  bool testbed = false;
+  static const struct option opts[] = {{"testbed", no_argument, nullptr, 't'}, {nullptr, 0, nullptr, 0}};
+  struct stat st;
+  int opt;
+
+  optind = 0;
+  while((opt = getopt_long(argc, argv, "t", opts, nullptr)) != -1) {
+    if(opt != 't') {
+      fprintf(stderr, "Usage: logscan stats [-t] LOG\n");
+      return 2;
+    }
+    testbed = true;
+  }
+  if(optind >= argc) {
+    fprintf(stderr, "Usage: logscan stats [-t] LOG\n");
+    return 2;
+  }
+  string log_path = argv[optind];
+  if(stat(log_path.c_str(), &st) != 0) {
+    printf("The logfile argument %s does not exist.\n", log_path.c_str());
+    return 1;
+  }
+  if(!S_ISREG(st.st_mode)) {
+    printf("The logfile argument %s is not a file.\n", log_path.c_str());
+    return 1;
+  }
+  printf("Logfile: %s\n", log_path.c_str());
+  printf("%s\n", testbed ? "Testbed experiment" : "Cooja simulation");
+
+  /* CSV files next to the log */
+  size_t sep = log_path.rfind('/');
+  string dir = sep == npos ? "" : log_path.substr(0, sep + 1);
+  string common = py_splitext0(sep == npos ? log_path : log_path.substr(sep + 1));
+  FILE *frecv = open_out(dir + common + "-recv.csv"), *fsent = open_out(dir + common + "-sent.csv");
+  fprintf(frecv, "time\tdest\tsrc\tseqn\thops\n");
+  fprintf(fsent, "time\tdest\tsrc\tseqn\n");
+
+  /* Records replayed in log order, window by window */
+  vector<int64_t> nodes;
+  std::unordered_set<int64_t> booted;
+  std::map<int64_t, std::unordered_map<int64_t, double>> lsent;
+  std::map<int64_t, std::unordered_map<int64_t, std::pair<double, int64_t>>> lrecv; // (time, hops)
+  vector<std::pair<double, int64_t>> beacons;
+  int64_t src = 0;
+  bool have_src = false;
+  auto replay = [&](stats_chunk &c) {
+    for(auto &ev : c.events) {
+      if(ev.error) {
+        fail("%s (as parse-stats.py)", ev.error);
+      }
+      switch(ev.type) {
+      case stats_event::NODE:
+        if(booted.insert(ev.self_id).second) {
+          nodes.push_back(ev.self_id);
+        }
+        break;
+      case stats_event::RECV:
+        if(ev.src_known) {
+          src = ev.src;
+          have_src = true;
+        }
+        else {
+          printf("KeyError Exception: key %.*s not found in addr_id_map\n", (int)ev.addr.size(), ev.addr.data());
+          if(!have_src) {
+            fail("no source for the reception from %.*s (UnboundLocalError in parse-stats.py)",
+                 (int)ev.addr.size(), ev.addr.data());
+          }
+        }
+        if(testbed) {
+          fputs(ev.ts.c_str(), frecv);
+        }
+        else {
+          fwrite(ev.time.data(), 1, ev.time.size(), frecv);
+        }
+        fputc('\t', frecv);
+        put_int(frecv, ev.self_id, '\t');
+        put_int(frecv, src, '\t');
+        put_int(frecv, ev.seqn, '\t');
+        put_int(frecv, ev.hops, '\n');
+        if(ev.self_id == SINK_ID) {
+          lrecv[src][ev.seqn] = {ev.secs, ev.hops};
+        }
+        break;
+      case stats_event::SENT:
+        src = ev.self_id;
+        have_src = true;
+        if(testbed) {
+          fputs(ev.ts.c_str(), fsent);
+        }
+        else {
+          fwrite(ev.time.data(), 1, ev.time.size(), fsent);
+        }
+        fputc('\t', fsent);
+        put_int(fsent, SINK_ID, '\t');
+        put_int(fsent, src, '\t');
+        put_int(fsent, ev.seqn, '\n');
+        lsent[src][ev.seqn] = ev.secs;
+        break;
+      case stats_event::BEACON:
+        beacons.emplace_back(ev.secs, ev.seqn);
+        break;
+      }
+    }
+  };
+  log_file log = map_log(log_path.c_str());
+  scan<stats_chunk>(log, threads, [testbed](string_view line, stats_chunk &c) {
+    stats_line(line, c, testbed);
+  }, replay);
+  fclose(frecv);
+  fclose(fsent);
+
+  if(lsent.empty()) {
+    printf("No sent messages could be parsed. Exiting...\n");
+    return 1;
+  }
+  if(lrecv.empty()) {
+    printf("No received messages could be parsed. Exiting...\n");
+    return 1;
+  }
+
+  /* Nodes that did not manage to send data */
+  std::sort(nodes.begin(), nodes.end());
+  vector<int64_t> fails;
+  for(int64_t id : nodes) {
+    if(id != SINK_ID && !lsent.count(id)) {
+      fails.push_back(id);
+    }
+  }
+  if(!fails.empty()) {
+    printf("----- WARNING -----\n");
+    for(int64_t id : fails) {
+      printf("Warning: node %lld did not send any data.\n", (long long)id);
+    }
+    printf("\n");
+  }
+
+  printf("\n########## Node Statistics ##########\n\n");
+  int64_t tsent = 0, trecv = 0;
+  for(auto &s : lsent) {
+    int64_t nsent = s.second.size(), nrecv = 0;
+    auto r = lrecv.find(s.first);
+    if(r != lrecv.end()) {
+      nrecv = r->second.size();
+    }
+    double pdr = (double)(100 * nrecv) / nsent;
+    printf("Node %lld: TX Packets = %lld, RX Packets = %lld, PDR = %.2f%%, PLR = %.2f%%\n",
+           (long long)s.first, (long long)nsent, (long long)nrecv, pdr, 100 - pdr);
+    tsent += nsent;
+    trecv += nrecv;
+  }
+  printf("\n########## Overall Statistics ##########\n\n");
+  printf("Total Number of Packets Sent: %lld\n", (long long)tsent);
+  printf("Total Number of Packets Received: %lld\n", (long long)trecv);
+  double opdr = (double)(100 * trecv) / tsent;
+  printf("Overall PDR = %.2f%%\n", opdr);
+  printf("Overall PLR = %.2f%%\n\n", 100 - opdr);
+
+  /* End-to-end latency of every packet received by the sink, with the beacon
+   * round during which it was sent and the offset into the round */
+  struct record {
+    double tsent;
+    int64_t src, seqn, hops;
+    double latency;
+    int64_t round;
+    double offset;
+  };
+  vector<record> records;
+  std::sort(beacons.begin(), beacons.end());
+  for(auto &r : lrecv) {
+    auto s = lsent.find(r.first);
+    for(auto &p : r.second) {
+      if(s == lsent.end() || !s->second.count(p.first)) {
+        continue;
+      }
+      double t = s->second[p.first];
+      auto b = std::upper_bound(beacons.begin(), beacons.end(), t,
+                                [](double v, const std::pair<double, int64_t> &e) { return v < e.first; });
+      record rec = {t, r.first, p.first, p.second.second, p.second.first - t, -1, NAN};
+      if(b != beacons.begin()) {
+        rec.round = (b - 1)->second;
+        rec.offset = t - (b - 1)->first;
+      }
+      records.push_back(rec);
+    }
+  }
+  if(records.empty()) {
+    printf("No packet could be matched to its transmission, no latency statistics.\n\n");
+    return 0;
+  }
+  std::sort(records.begin(), records.end(), [](const record &a, const record &b) {
+    return std::make_tuple(a.tsent, a.src, a.seqn) < std::make_tuple(b.tsent, b.src, b.seqn);
+  });
+
+  FILE *flat = open_out(py_splitext0(log_path) + "-latency.csv");
+  fprintf(flat, "time\tsrc\tseqn\thops\tlatency\tround\tround_offset\n");
+  std::map<int64_t, vector<double>> per_node, per_hops;
+  std::map<string, vector<double>> overall;
+  vector<double> &all = overall["all"];
+  for(auto &r : records) {
+    put_fixed6(flat, r.tsent, '\t');
+    put_int(flat, r.src, '\t');
+    put_int(flat, r.seqn, '\t');
+    put_int(flat, r.hops, '\t');
+    put_fixed6(flat, r.latency, '\t');
+    put_int(flat, r.round, '\t');
+    if(std::isnan(r.offset)) {
+      fputs("nan\n", flat);
+    }
+    else {
+      put_fixed6(flat, r.offset, '\n');
+    }
+    per_node[r.src].push_back(r.latency);
+    per_hops[r.hops].push_back(r.latency);
+    all.push_back(r.latency);
+  }
+  fclose(flat);
+
+  printf("########## Latency Statistics (ms) ##########\n\n");
+  print_latency_table("Node", per_node);
+  printf("\n");
+  print_latency_table("Hops", per_hops);
+  printf("\n");
+  print_latency_table("Overall", overall);
+  printf("\n");
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+/****** rng_eval.py ******/
+
+struct rng_event {
+  enum { RANGE, TRY, FAIL, FILTERED, DIAG, POSITION } type;
+  string_view a, b;            // Addresses, or sequence number and responder of TRY and FAIL
+  string_view why;             // Cause of FAIL, empty for a wrong peer
+  int64_t v1, v2, v3, v4;
+  double d1, d2, d3;
+};
+
+struct rng_chunk {
+  vector<rng_event> events;
+};
+
+static void
+rng_line(string_view s, rng_chunk &c)
+{
+  rng_event ev = {};
+  string_view n1, n2, n3, n4;
+  size_t pos, i;
+
+  if((pos = s.find("RANGING OK")) != npos) {
+    /* RANGING OK [11:0c->19:15] 169 mm 812 us (exchange latency, optional) */
+    i = pos;
+    if(lit(s, i, "RANGING OK [") && addr(s, i, &ev.a) && lit(s, i, "->") && addr(s, i, &ev.b) && lit(s, i, "] ")
+       && sdigits(s, i, &n1) && lit(s, i, " mm")) {
+      ev.type = rng_event::RANGE;
+      ev.v1 = to_int(n1);
+      ev.v2 = lit(s, i, " ") && digits(s, i, &n2) && lit(s, i, " us") ? to_int(n2) : -1;
+      c.events.push_back(ev);
+    }
+  }
+  else if(s.find("ranging with") != npos) {
+    /* [12] ranging with 1915 ... */
+    for(pos = s.find('['); pos != npos; pos = s.find('[', pos + 1)) {
+      i = pos + 1;
+      if(digits(s, i, &ev.a) && lit(s, i, "] ranging with ") && hex4(s, i, &ev.b)) {
+        ev.type = rng_event::TRY;
+        c.events.push_back(ev);
+        break;
+      }
+    }
+  }
+  else if(s.find("] fail") != npos) {
+    /* [12] fail (RX err), [12] fail (RX err) 1915, [12] fail [1915->139a] */
+    for(pos = s.find('['); pos != npos; pos = s.find('[', pos + 1)) {
+      i = pos + 1;
+      if(!digits(s, i, &ev.a) || !lit(s, i, "] fail ")) {
+        continue;
+      }
+      size_t j = i, close;
+      if(lit(s, j, "(") && (close = s.find(')', j)) != npos && close > j) {
+        ev.why = s.substr(j, close - j);
+        j = close + 1;
+        size_t k = j;
+        if(!(lit(s, k, " ") && hex4(s, k, &ev.b))) {
+          ev.b = string_view();
+        }
+      }
+      else if(!lit(s, i, "[")) {
+        continue;
+      }
+      ev.type = rng_event::FAIL;
+      c.events.push_back(ev);
+      break;
+    }
+  }
+  else if((pos = s.find("FILTERED")) != npos) {
+    /* FILTERED [11:0c->19:15] 172 mm std 88 mm speed 3 mm/s */
+    i = pos;
+    if(lit(s, i, "FILTERED [") && addr(s, i, &ev.a) && lit(s, i, "->") && addr(s, i, &ev.b) && lit(s, i, "] ")
+       && sdigits(s, i, &n1) && lit(s, i, " mm std ") && digits(s, i) && lit(s, i, " mm")) {
+      ev.type = rng_event::FILTERED;
+      ev.v1 = to_int(n1);
+      c.events.push_back(ev);
+    }
+  }
+  else if((pos = s.find("DIAG")) != npos) {
+    /* DIAG [13:9a->19:15] rx -79.3 dBm fp -81.0 dBm noise 52 fp/noise 31.2 LOS */
+    auto decimal = [&](bool sign, string_view *out) {
+      size_t start = i;
+      if(!(sign ? sdigits(s, i) : digits(s, i)) || !lit(s, i, ".") || i >= s.size() || !is_digit(s[i])) {
+        return false;
+      }
+      *out = s.substr(start, ++i - start);
+      return true;
+    };
+    i = pos;
+    if(lit(s, i, "DIAG [") && addr(s, i, &ev.a) && lit(s, i, "->") && addr(s, i, &ev.b) && lit(s, i, "] rx ")
+       && decimal(true, &n1) && lit(s, i, " dBm fp ") && decimal(true, &n2) && lit(s, i, " dBm noise ")
+       && digits(s, i) && lit(s, i, " fp/noise ") && decimal(false, &n3) && lit(s, i, " ") && words(s, i, &ev.why)) {
+      ev.type = rng_event::DIAG;
+      ev.d1 = to_double(n1) - to_double(n2);
+      ev.d2 = to_double(n2);
+      ev.d3 = to_double(n3);
+      c.events.push_back(ev);
+    }
+  }
+  else if((pos = s.find("POSITION")) != npos) {
+    /* POSITION [13:9a] 75968 3966 mm res 23 mm it 4 5210 cycles 120500 ms */
+    i = pos;
+    if(lit(s, i, "POSITION [") && addr(s, i, &ev.a) && lit(s, i, "] ") && sdigits(s, i, &n1) && lit(s, i, " ")
+       && sdigits(s, i, &n2) && lit(s, i, " mm res ") && digits(s, i) && lit(s, i, " mm it ") && digits(s, i)
+       && lit(s, i, " ") && digits(s, i, &n3) && lit(s, i, " cycles ") && digits(s, i, &n4) && lit(s, i, " ms")) {
+      ev.type = rng_event::POSITION;
+      ev.d1 = (double)to_int(n1) / 1000;
+      ev.d2 = (double)to_int(n2) / 1000;
+      ev.v3 = to_int(n3);
+      ev.v4 = to_int(n4);
+      c.events.push_back(ev);
+    }
+  }
+}
+
+/* Fields of the TSV tables: strings quoted if need be, floats in their
+ * shortest round-trip form with a decimal point so that they load as floats */
+static void
+tsv_str(FILE *f, string_view s, bool last = false)
+{
+  if(s.find_first_of("\t\"") != npos) {
+    fputc('"', f);
+    for(char ch : s) {
+      if(ch == '"') {
+        fputc('"', f);
+      }
+      fputc(ch, f);
+    }
+    fputc('"', f);
+  }
+  else {
+    fwrite(s.data(), 1, s.size(), f);
+  }
+  fputc(last ? '\n' : '\t', f);
+}
+
+static void
+tsv_float(FILE *f, double v, bool last = false)
+{
+  fprintf(f, "%s%c", py_repr(v).c_str(), last ? '\n' : '\t');
+}
+
+static string
+resp_addr(string_view hex)
+{
+  return string(hex.substr(0, 2)) + ":" + string(hex.substr(2));
+}
+
+static int
+run_rng(int argc, char **argv, unsigned threads)
+{
+  string dir;
+  int opt;
+
+  optind = 0;
+  while((opt = getopt(argc, argv, "o:")) != -1) {
+    if(opt != 'o') {
+      optind = argc;
+      break;
+    }
+    dir = optarg;
+  }
+  if(dir.empty() || optind != argc - 1) {
+    fprintf(stderr, "Usage: logscan rng -o DIR LOG\n");
+    return 2;
+  }
+  log_file log = map_log(argv[optind]);
+
+  FILE *ranges = open_out(dir + "/ranges.tsv"), *filtered = open_out(dir + "/filtered.tsv");
+  FILE *diags = open_out(dir + "/diags.tsv"), *fixes = open_out(dir + "/fixes.tsv");
+  FILE *attempts = open_out(dir + "/attempts.tsv"), *fails = open_out(dir + "/fails.tsv");
+  fprintf(ranges, "init\tresp\tdist\tlat\n");
+  fprintf(filtered, "init\tresp\tdist\n");
+  fprintf(diags, "los\trx-fp\tfp\tfp/noise\trange\n");
+  fprintf(fixes, "node\tx\ty\tcycles\tms\n");
+  fprintf(attempts, "resp\n");
+  fprintf(fails, "resp\tcause\n");
+
+  /* Replay the records in log order: DIAG lines go with the last range of
+   * their pair, failures with the attempts of the same round */
+  std::unordered_map<string, int64_t> last_range;
+  int64_t num_ranges = 0;
+  string pending_seqn;
+  bool pending = false;
+  vector<string> pending_resp;
+  scan<rng_chunk>(log, threads, rng_line, [&](rng_chunk &c) {
+    for(auto &ev : c.events) {
+      switch(ev.type) {
+      case rng_event::RANGE:
+        last_range[string(ev.a) + string(ev.b)] = num_ranges++;
+        tsv_str(ranges, ev.a);
+        tsv_str(ranges, ev.b);
+        fprintf(ranges, "%lld\t%lld\n", (long long)ev.v1, (long long)ev.v2);
+        break;
+      case rng_event::TRY:
+        if(!pending || pending_seqn != ev.a) {
+          pending = true;
+          pending_seqn = string(ev.a);
+          pending_resp.clear();
+        }
+        pending_resp.push_back(resp_addr(ev.b));
+        tsv_str(attempts, pending_resp.back(), true);
+        break;
+      case rng_event::FAIL:
+        if(pending && pending_seqn == ev.a) {
+          string_view why = ev.why.empty() ? "wrong peer" : ev.why;
+          if(!ev.b.empty()) {
+            tsv_str(fails, resp_addr(ev.b));
+            tsv_str(fails, why, true);
+          }
+          else {
+            for(auto &r : pending_resp) {
+              tsv_str(fails, r);
+              tsv_str(fails, why, true);
+            }
+          }
+        }
+        break;
+      case rng_event::FILTERED:
+        tsv_str(filtered, ev.a);
+        tsv_str(filtered, ev.b);
+        fprintf(filtered, "%lld\n", (long long)ev.v1);
+        break;
+      case rng_event::DIAG: {
+        auto it = last_range.find(string(ev.a) + string(ev.b));
+        if(it != last_range.end()) {
+          tsv_str(diags, ev.why);
+          tsv_float(diags, ev.d1);
+          tsv_float(diags, ev.d2);
+          tsv_float(diags, ev.d3);
+          fprintf(diags, "%lld\n", (long long)it->second);
+          last_range.erase(it);
+        }
+        break;
+      }
+      case rng_event::POSITION:
+        tsv_str(fixes, ev.a);
+        tsv_float(fixes, ev.d1);
+        tsv_float(fixes, ev.d2);
+        fprintf(fixes, "%lld\t%lld\n", (long long)ev.v3, (long long)ev.v4);
+        break;
+      }
+    }
+  });
+  for(FILE *f : {ranges, filtered, diags, fixes, attempts, fails}) {
+    if(fclose(f) != 0) {
+      fail("cannot write the tables to %s", dir.c_str());
+    }
+  }
+  return 0;
+}
+/*---------------------------------------------------------------------------*/
+int
+main(int argc, char **argv)
+{
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  int opt;
+
+  while((opt = getopt(argc, argv, "+j:")) != -1) {
+    if(opt != 'j' || atoi(optarg) < 1) {
+      optind = argc;
+      break;
+    }
+    threads = atoi(optarg);
+  }
+  if(optind >= argc) {
+    fprintf(stderr, "Usage: %s [-j THREADS] conn LOG | stats [-t] LOG | rng -o DIR LOG\n", argv[0]);
+    return 2;
+  }
+  setvbuf(stdout, nullptr, _IOFBF, 1 << 16);
+  string cmd = argv[optind];
+  argc -= optind;
+  argv += optind;
+  if(cmd == "conn") {
+    return run_conn(argc, argv, threads);
+  }
+  if(cmd == "stats") {
+    return run_stats(argc, argv, threads);
+  }
+  if(cmd == "rng") {
+    return run_rng(argc, argv, threads);
+  }
+  fprintf(stderr, "Unknown command %s\n", cmd.c_str());
+  return 2;
+}
+/*---------------------------------------------------------------------------*/